@@ -0,0 +1,208 @@
+#include "Arduino.h"
+
+#include <errno.h>
+#include <time.h>
+
+static uint64_t monotonicMicros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return static_cast<uint64_t>(now.tv_sec) * 1000000ULL + now.tv_nsec / 1000;
+}
+
+static const uint64_t bootMicros = monotonicMicros();
+
+unsigned long millis() {
+    return static_cast<unsigned long>((monotonicMicros() - bootMicros) / 1000);
+}
+
+unsigned long micros() {
+    return static_cast<unsigned long>(monotonicMicros() - bootMicros);
+}
+
+void delay(unsigned long ms) {
+    struct timespec request;
+    request.tv_sec = ms / 1000;
+    request.tv_nsec = (ms % 1000) * 1000000L;
+
+    while (nanosleep(&request, &request) == -1 && errno == EINTR) {
+    }
+}
+
+static std::string formatNumber(unsigned long value, unsigned char base, bool negative) {
+    if (base < 2) {
+        base = DEC;
+    }
+
+    char buffer[8 * sizeof(long) + 2];
+    char* p = &buffer[sizeof(buffer) - 1];
+    *p = '\0';
+
+    do {
+        char digit = value % base;
+        *--p = digit < 10 ? digit + '0' : digit + 'A' - 10;
+        value /= base;
+    } while (value);
+
+    if (negative) {
+        *--p = '-';
+    }
+
+    return std::string(p);
+}
+
+String::String(int value, unsigned char base) : value(formatNumber(value < 0 && base == DEC ? -(long)value : (unsigned int)value, base, value < 0 && base == DEC)) {}
+String::String(unsigned int value, unsigned char base) : value(formatNumber(value, base, false)) {}
+String::String(long value, unsigned char base) : value(formatNumber(value < 0 && base == DEC ? -value : value, base, value < 0 && base == DEC)) {}
+String::String(unsigned long value, unsigned char base) : value(formatNumber(value, base, false)) {}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        if (!write(*buffer++)) {
+            break;
+        }
+        n++;
+    }
+
+    return n;
+}
+
+size_t Print::printNumber(unsigned long value, uint8_t base) {
+    return write(formatNumber(value, base, false).c_str());
+}
+
+size_t Print::print(const __FlashStringHelper* value) {
+    return write(reinterpret_cast<const char*>(value));
+}
+
+size_t Print::print(const String& value) {
+    return write(value.c_str(), value.length());
+}
+
+size_t Print::print(const char* value) {
+    return write(value);
+}
+
+size_t Print::print(char value) {
+    return write(static_cast<uint8_t>(value));
+}
+
+size_t Print::print(unsigned char value, int base) {
+    return print(static_cast<unsigned long>(value), base);
+}
+
+size_t Print::print(int value, int base) {
+    return print(static_cast<long>(value), base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return print(static_cast<unsigned long>(value), base);
+}
+
+size_t Print::print(long value, int base) {
+    if (base == 0) {
+        return write(static_cast<uint8_t>(value));
+    }
+
+    if (base == DEC && value < 0) {
+        size_t n = print('-');
+        return n + printNumber(-value, DEC);
+    }
+
+    return printNumber(value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    if (base == 0) {
+        return write(static_cast<uint8_t>(value));
+    }
+
+    return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+
+    return write(buffer);
+}
+
+size_t Print::print(const Printable& value) {
+    return value.printTo(*this);
+}
+
+size_t Print::println(const __FlashStringHelper* value) { size_t n = print(value); return n + println(); }
+size_t Print::println(const String& value) { size_t n = print(value); return n + println(); }
+size_t Print::println(const char* value) { size_t n = print(value); return n + println(); }
+size_t Print::println(char value) { size_t n = print(value); return n + println(); }
+size_t Print::println(unsigned char value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(int value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(unsigned int value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(long value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(unsigned long value, int base) { size_t n = print(value, base); return n + println(); }
+size_t Print::println(double value, int digits) { size_t n = print(value, digits); return n + println(); }
+size_t Print::println(const Printable& value) { size_t n = print(value); return n + println(); }
+
+size_t Print::println(void) {
+    return write("\r\n");
+}
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+
+    do {
+        int c = read();
+        if (c >= 0) {
+            return c;
+        }
+    } while (millis() - start < timeout);
+
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) {
+            break;
+        }
+
+        *buffer++ = static_cast<char>(c);
+        count++;
+    }
+
+    return count;
+}
+
+bool IPAddress::fromString(const char* address) {
+    unsigned int parts[4];
+    char trailing;
+
+    if (sscanf(address, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &trailing) != 4) {
+        return false;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (parts[i] > 255) {
+            return false;
+        }
+
+        bytes[i] = parts[i];
+    }
+
+    return true;
+}
+
+String IPAddress::toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+
+    return String(buffer);
+}
+
+size_t IPAddress::printTo(Print& p) const {
+    return p.print(toString());
+}
@@ -0,0 +1,137 @@
+#ifndef SARA_N200_POSIX_ARDUINO_H
+#define SARA_N200_POSIX_ARDUINO_H
+
+// Minimal subset of the Arduino core used by the SARA-N200 driver, so the
+// library builds and runs natively on Linux gateways.
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+// CLOCK_MONOTONIC based, unaffected by wall clock changes
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+class String {
+public:
+    String(const char* value = "") : value(value ? value : "") {}
+    String(const std::string& value) : value(value) {}
+    String(char c) : value(1, c) {}
+    explicit String(int value, unsigned char base = DEC);
+    explicit String(unsigned int value, unsigned char base = DEC);
+    explicit String(long value, unsigned char base = DEC);
+    explicit String(unsigned long value, unsigned char base = DEC);
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.size(); }
+
+    String& operator+=(const String& rhs) { value += rhs.value; return *this; }
+    String& operator+=(const char* rhs) { value += rhs; return *this; }
+    String& operator+=(char rhs) { value += rhs; return *this; }
+    bool operator==(const String& rhs) const { return value == rhs.value; }
+    bool operator!=(const String& rhs) const { return value != rhs.value; }
+    char operator[](unsigned int index) const { return index < value.size() ? value[index] : 0; }
+
+private:
+    std::string value;
+};
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return str ? write(reinterpret_cast<const uint8_t*>(str), strlen(str)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+
+    size_t print(const __FlashStringHelper* value);
+    size_t print(const String& value);
+    size_t print(const char* value);
+    size_t print(char value);
+    size_t print(unsigned char value, int base = DEC);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+    size_t print(const Printable& value);
+
+    size_t println(const __FlashStringHelper* value);
+    size_t println(const String& value);
+    size_t println(const char* value);
+    size_t println(char value);
+    size_t println(unsigned char value, int base = DEC);
+    size_t println(int value, int base = DEC);
+    size_t println(unsigned int value, int base = DEC);
+    size_t println(long value, int base = DEC);
+    size_t println(unsigned long value, int base = DEC);
+    size_t println(double value, int digits = 2);
+    size_t println(const Printable& value);
+    size_t println(void);
+
+private:
+    size_t printNumber(unsigned long value, uint8_t base);
+};
+
+class Stream : public Print {
+public:
+    Stream() : timeout(1000) {}
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+
+    void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+    size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes(reinterpret_cast<char*>(buffer), length); }
+
+protected:
+    unsigned long timeout;
+
+    int timedRead();
+};
+
+class IPAddress : public Printable {
+public:
+    IPAddress() { memset(bytes, 0, sizeof(bytes)); }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { bytes[0] = a; bytes[1] = b; bytes[2] = c; bytes[3] = d; }
+    IPAddress(uint32_t address) { memcpy(bytes, &address, sizeof(bytes)); }
+
+    operator uint32_t() const { uint32_t address; memcpy(&address, bytes, sizeof(address)); return address; }
+    bool operator==(const IPAddress& rhs) const { return memcmp(bytes, rhs.bytes, sizeof(bytes)) == 0; }
+    bool operator!=(const IPAddress& rhs) const { return !(*this == rhs); }
+    uint8_t operator[](int index) const { return bytes[index]; }
+    uint8_t& operator[](int index) { return bytes[index]; }
+
+    bool fromString(const char* address);
+    String toString() const;
+    virtual size_t printTo(Print& p) const;
+
+private:
+    uint8_t bytes[4];
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "PosixSerial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// B0 (hang up) doubles as "not supported"
+static speed_t toSpeed(uint32_t baudrate) {
+    switch (baudrate) {
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return B0;
+    }
+}
+
+PosixSerial::PosixSerial():
+ fd(-1),
+ epollFd(-1),
+ readTimeout(20),
+ rxHead(0),
+ rxLength(0),
+ txLength(0) {}
+
+PosixSerial::~PosixSerial() {
+    end();
+}
+
+bool PosixSerial::begin(const char* device, uint32_t baudrate) {
+    end();
+
+    speed_t speed = toSpeed(baudrate);
+    if (speed == B0) {
+        return false;
+    }
+
+    int handle = open(device, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (handle < 0) {
+        return false;
+    }
+
+    struct termios options;
+    if (tcgetattr(handle, &options) != 0) {
+        close(handle);
+        return false;
+    }
+
+    cfmakeraw(&options);
+    options.c_cflag |= CLOCAL | CREAD;
+    options.c_cflag &= ~CRTSCTS;
+    options.c_cc[VMIN] = 0;
+    options.c_cc[VTIME] = 0;
+
+    if (cfsetispeed(&options, speed) != 0 || cfsetospeed(&options, speed) != 0) {
+        close(handle);
+        return false;
+    }
+
+    if (tcsetattr(handle, TCSANOW, &options) != 0) {
+        close(handle);
+        return false;
+    }
+
+    tcflush(handle, TCIOFLUSH);
+
+    return attach(handle);
+}
+
+bool PosixSerial::openPty(char* slaveName, size_t size) {
+    end();
+
+    int handle = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (handle < 0) {
+        return false;
+    }
+
+    if (grantpt(handle) != 0 || unlockpt(handle) != 0 || ptsname_r(handle, slaveName, size) != 0) {
+        close(handle);
+        return false;
+    }
+
+    struct termios options;
+    if (tcgetattr(handle, &options) == 0) {
+        cfmakeraw(&options);
+        tcsetattr(handle, TCSANOW, &options);
+    }
+
+    return attach(handle);
+}
+
+bool PosixSerial::attach(int handle) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        close(handle);
+        return false;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = handle;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, handle, &event) != 0) {
+        close(epollFd);
+        close(handle);
+        epollFd = -1;
+        return false;
+    }
+
+    fd = handle;
+    rxHead = 0;
+    rxLength = 0;
+    txLength = 0;
+
+    return true;
+}
+
+void PosixSerial::end() {
+    flushOutput();
+
+    if (epollFd >= 0) {
+        close(epollFd);
+        epollFd = -1;
+    }
+
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+
+    rxHead = 0;
+    rxLength = 0;
+}
+
+bool PosixSerial::waitReadable(uint32_t timeout) {
+    if (rxLength > 0) {
+        return true;
+    }
+
+    return fill(timeout);
+}
+
+bool PosixSerial::fill(uint32_t timeout) {
+    if (fd < 0) {
+        return false;
+    }
+
+    // a response can only follow a command that has actually been sent
+    flushOutput();
+
+    struct epoll_event event;
+    int ready;
+
+    do {
+        ready = epoll_wait(epollFd, &event, 1, static_cast<int>(timeout));
+    } while (ready < 0 && errno == EINTR);
+
+    if (ready <= 0 || !(event.events & EPOLLIN)) {
+        return false;
+    }
+
+    ssize_t count = ::read(fd, rxBuffer, sizeof(rxBuffer));
+    if (count <= 0) {
+        return false;
+    }
+
+    rxHead = 0;
+    rxLength = count;
+
+    return true;
+}
+
+int PosixSerial::available() {
+    if (rxLength == 0) {
+        fill(0);
+    }
+
+    return rxLength;
+}
+
+int PosixSerial::read() {
+    if (rxLength == 0 && !fill(readTimeout)) {
+        return -1;
+    }
+
+    rxLength--;
+    return rxBuffer[rxHead++];
+}
+
+int PosixSerial::peek() {
+    if (rxLength == 0 && !fill(readTimeout)) {
+        return -1;
+    }
+
+    return rxBuffer[rxHead];
+}
+
+void PosixSerial::flush() {
+    if (fd >= 0) {
+        flushOutput();
+        tcdrain(fd);
+    }
+}
+
+size_t PosixSerial::write(uint8_t value) {
+    if (fd < 0) {
+        return 0;
+    }
+
+    if (txLength == sizeof(txBuffer) && !flushOutput()) {
+        return 0;
+    }
+
+    txBuffer[txLength++] = value;
+
+    if (value == '\r' || value == '\n') {
+        flushOutput();
+    }
+
+    return 1;
+}
+
+size_t PosixSerial::write(const uint8_t* buffer, size_t size) {
+    size_t i;
+    for (i = 0; i < size; i++) {
+        if (!write(buffer[i])) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+bool PosixSerial::flushOutput() {
+    size_t written = 0;
+
+    while (written < txLength) {
+        ssize_t count = ::write(fd, txBuffer + written, txLength - written);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            txLength = 0;
+            return false;
+        }
+
+        written += count;
+    }
+
+    txLength = 0;
+    return true;
+}
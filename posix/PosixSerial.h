@@ -0,0 +1,72 @@
+#ifndef SARA_N200_POSIX_SERIAL_H
+#define SARA_N200_POSIX_SERIAL_H
+
+#include "Arduino.h"
+
+// termios based Stream over a serial device or a PTY. read() sleeps in
+// epoll_wait for up to the read timeout when nothing is buffered, so the
+// driver's polling loops block in the kernel instead of spinning a core.
+class PosixSerial : public Stream {
+public:
+    PosixSerial();
+    virtual ~PosixSerial();
+
+    // Fails, leaving the port closed, for a baud rate toSpeed() does not
+    // know (4800 to 921600).
+    bool begin(const char* device, uint32_t baudrate = 9600);
+    // Opens a new PTY master, e.g. for a modem simulator. The driver side
+    // opens the returned slave path with begin().
+    bool openPty(char* slaveName, size_t size);
+    void end();
+
+    bool isOpen() const { return fd >= 0; }
+    int getFd() const { return fd; }
+
+    void setReadTimeout(uint32_t ms) { readTimeout = ms; }
+    bool waitReadable(uint32_t timeout);
+
+    virtual int available();
+    virtual int read();
+    virtual int peek();
+    virtual void flush();
+    virtual size_t write(uint8_t value);
+    virtual size_t write(const uint8_t* buffer, size_t size);
+
+    using Print::write;
+
+private:
+    int fd;
+    int epollFd;
+    uint32_t readTimeout;
+    uint8_t rxBuffer[256];
+    size_t rxHead;
+    size_t rxLength;
+    // the driver prints commands a character at a time, batch them into
+    // one write(2) per line
+    uint8_t txBuffer[256];
+    size_t txLength;
+
+    bool attach(int fd);
+    bool fill(uint32_t timeout);
+    bool flushOutput();
+};
+
+// Write-only Stream over stdio, handy as the driver's debug stream.
+class PosixFileStream : public Stream {
+public:
+    PosixFileStream(FILE* file) : file(file) {}
+
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    virtual void flush() { fflush(file); }
+    virtual size_t write(uint8_t value) { return fputc(value, file) == EOF ? 0 : 1; }
+    virtual size_t write(const uint8_t* buffer, size_t size) { return fwrite(buffer, 1, size, file); }
+
+    using Print::write;
+
+private:
+    FILE* file;
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SARA_N200_POSIX_STREAM_H
+#define SARA_N200_POSIX_STREAM_H
+
+#include "Arduino.h"
+
+#endif
@@ -15,7 +15,7 @@
 #define HIGH_NIBBLE(i) ((i >> 4) & 0x0F)
 #define LOW_NIBBLE(i) (i & 0x0F)
 
-#define HEX_CHAR_TO_NIBBLE(c) ((c >= 'A') ? (c - 'A' + 0x0A) : (c - '0'))
+#define HEX_CHAR_TO_NIBBLE(c) ((c >= 'a') ? (c - 'a' + 0x0A) : (c >= 'A') ? (c - 'A' + 0x0A) : (c - '0'))
 #define HEX_PAIR_TO_BYTE(h, l) ((HEX_CHAR_TO_NIBBLE(h) << 4) + HEX_CHAR_TO_NIBBLE(l))
 
 #define STR_HELPER(x) #x
@@ -27,10 +27,31 @@
 
 #define SOCKET_FAIL -1
 
-#define SOCKET_COUNT 7
-
 #define NOW (uint32_t)millis()
 
+// Numeric +CME ERROR codes of the SARA-N2 firmware and what they call for.
+static const SaraN200::RetryRule retryPolicy[] = {
+    { 3, SaraN200::RetryWithBackoff },      // operation not allowed
+    { 4, SaraN200::RetryGiveUp },           // operation not supported
+    { 23, SaraN200::RetryWithBackoff },     // memory failure
+    { 30, SaraN200::RetryReattach },        // no network service
+    { 50, SaraN200::RetryGiveUp },          // incorrect parameters
+    { 100, SaraN200::RetryWithBackoff },    // unknown
+    { 159, SaraN200::RetryWithBackoff },    // uplink busy/flow control
+    { 512, SaraN200::RetryGiveUp },         // required parameter not configured
+    { 514, SaraN200::RetryImmediately },    // AT internal error
+    { 516, SaraN200::RetryWithBackoff },    // incorrect state for command
+    { 517, SaraN200::RetryGiveUp },         // CID is invalid
+    { 518, SaraN200::RetryReattach },       // CID is not active
+    { 521, SaraN200::RetryReattach },       // CID is not defined
+    { 524, SaraN200::RetryReattach },       // MT not powered on
+    { 526, SaraN200::RetryImmediately },    // AT command aborted
+    { 527, SaraN200::RetryImmediately },    // command interrupted
+    { 528, SaraN200::RetryGiveUp },         // configuration conflicts
+    { 529, SaraN200::RetryWithBackoff },    // FOTA is updating
+    { 530, SaraN200::RetryRecreateSocket }, // not an allocated socket
+};
+
 
 static const int nConfigCount = 6;
 static SaraN200::NameValuePair nConfig[nConfigCount] = {
@@ -48,26 +69,488 @@ static inline bool is_timedout(uint32_t from, uint32_t nr_ms)
     return (millis() - from) > nr_ms;
 }
 
-SaraN200::SaraN200(): SaraN200AT() {
+// what is left of `timeout` ms started at `from`, 0 once it has passed
+static uint32_t time_left(uint32_t from, uint32_t timeout)
+{
+    uint32_t elapsed = millis() - from;
+    return (elapsed < timeout) ? timeout - elapsed : 0;
+}
+
+// Decodes datagram tails nobody has room for straight off the UART.
+class DiscardSink : public SaraN200RecvSink {
+public:
+    virtual size_t capacity() { return SARA_N200_MAX_DATAGRAM_SIZE; }
+    virtual void write(const uint8_t* data, size_t size) {}
+};
+
+SaraN200::SaraN200():
+ SaraN200(NULL, 0, NULL, SARA_N200_SOCKET_COUNT) {}
+
+SaraN200::SaraN200(char* inputBuffer, size_t inputBufferSize, SocketInfo* sockets, size_t socketCount):
+ SaraN200AT(),
+ sockets(sockets),
+ socketCount(socketCount),
+ isSocketTableOwned(false),
+ commandClass(CommandGeneric),
+ accounting(0),
+ radioConnected(false),
+ pingStats(0),
+ pingPending(false),
+ pingSentAt(0),
+ pingTimeout(0),
+ pingInterval(0),
+ lastPingAt(0),
+ signalQualityTtl(SARA_N200_SIGNAL_QUALITY_TTL),
+ signalRefreshInterval(0),
+ networkHintEnabled(true),
+ networkHintTimeout(20000),
+ attachAttemptCount(0),
+ timeSource(TimeSourceNone),
+ timeEpoch(0),
+ timeEpochAt(0),
+ timeZone(0),
+ pendingSendHead(0),
+ pendingSendCount(0),
+ nextTicket(0),
+ sendResultCallback(0),
+ sendResultContext(0),
+ nonIpUrcEnabled(false),
+ nonIpPending(0),
+ retryRules(0),
+ retryRuleCount(0),
+ registrationMode(0),
+ registrationQuery(false),
+ registrationCallback(0),
+ registrationContext(0),
+ echoManaged(true),
+ echoPending(false),
+ echoCount(0) {
+    memset(&signalQuality, 0, sizeof(signalQuality));
+    memset(&bootTimings, 0, sizeof(bootTimings));
+    memset(&networkHint, 0, sizeof(networkHint));
+    memset(&lastError, 0, sizeof(lastError));
+    memset(&registration, 0, sizeof(registration));
+    registration.accessTechnology = -1;
+    registration.activeTime = -1;
+    registration.periodicTau = -1;
+
+    // without a buffer init() allocates one of the default size
+    if (inputBuffer) {
+        setInputBuffer(inputBuffer, inputBufferSize);
+    }
+}
+
+SaraN200::~SaraN200() {
+    if (isSocketTableOwned) {
+        free(sockets);
+    }
 }
 
 uint32_t SaraN200::getDefaultBaudrate() {
     return 9600;
 }
 
+void SaraN200::beginCommand(CommandClass commandClass) {
+    // results of fire-and-forget sends come first on the UART
+    while (pendingSendCount > 0) {
+        reapSend();
+    }
+
+    if (echoPending) {
+        echoPending = false;
+        setEchoEnabled(false);
+    }
+
+    this->commandClass = commandClass;
+    lastError.type = ErrorNone;
+    lastError.code = 0;
+}
+
+bool SaraN200::setErrorCodesEnabled(bool enabled) {
+    beginCommand(CommandConfig);
+    print("AT+CMEE=");
+    println(enabled ? "1" : "0");
+
+    return readResponse() == ResponseOK;
+}
+
+bool SaraN200::setRegistrationUrcEnabled(bool enabled, bool psmTimers) {
+    uint8_t mode = enabled ? (psmTimers ? 4 : 2) : 0;
+
+    beginCommand(CommandConfig);
+    print("AT+CEREG=");
+    println(mode);
+
+    if (readResponse() != ResponseOK) {
+        return false;
+    }
+
+    registrationMode = mode;
+    return !enabled || refreshRegistration();
+}
+
+bool SaraN200::refreshRegistration() {
+    beginCommand(CommandQuery);
+    println("AT+CEREG?");
+
+    registrationQuery = true;
+    bool result = readResponse() == ResponseOK;
+    registrationQuery = false;
+
+    return result;
+}
+
+// GPRS Timer 2 (3GPP TS 24.008 10.5.7.4), as sent for T3324
+static int32_t decodeActiveTime(uint8_t timer) {
+    uint32_t value = timer & 0x1F;
+
+    switch (timer >> 5) {
+    case 0: return value * 2;
+    case 1: return value * 60;
+    case 2: return value * 360;
+    default: return -1; // deactivated
+    }
+}
+
+// GPRS Timer 3 (3GPP TS 24.008 10.5.7.4a), as sent for T3412 extended
+static int32_t decodePeriodicTau(uint8_t timer) {
+    uint32_t value = timer & 0x1F;
+
+    switch (timer >> 5) {
+    case 0: return value * 600;
+    case 1: return value * 3600;
+    case 2: return value * 36000;
+    case 3: return value * 2;
+    case 4: return value * 30;
+    case 5: return value * 60;
+    case 6: return value * 1152000;
+    default: return -1; // deactivated
+    }
+}
+
+void SaraN200::updateRegistration(const char* fields) {
+    // <stat>[,"<tac>","<ci>",<AcT>[,<cause_type>,<reject_cause>[,"<Active-Time>","<Periodic-TAU>"]]]
+    char values[8][12];
+    size_t count = 0;
+    size_t length = 0;
+    bool quoted = false;
+
+    for (const char* p = fields; count < 8; p++) {
+        if (*p == '\0' || (*p == ',' && !quoted)) {
+            values[count++][length] = '\0';
+            length = 0;
+
+            if (*p == '\0') {
+                break;
+            }
+        } else if (*p == '"') {
+            quoted = !quoted;
+        } else if (*p != ' ' && length < sizeof(values[0]) - 1) {
+            values[count][length++] = *p;
+        }
+    }
+
+    if (count == 0 || values[0][0] == '\0') {
+        return;
+    }
+
+    RegistrationState state = registration;
+    state.valid = true;
+    state.status = static_cast<RegistrationStatus>(atoi(values[0]));
+
+    // the cell fields only come while registered or searching on one
+    if (count >= 4 && values[1][0] != '\0' && values[2][0] != '\0') {
+        state.tac = strtoul(values[1], NULL, 16);
+        state.cellId = strtoul(values[2], NULL, 16);
+        state.accessTechnology = (values[3][0] != '\0') ? atoi(values[3]) : -1;
+    }
+
+    if (count >= 8) {
+        state.activeTime = (values[6][0] != '\0') ? decodeActiveTime(strtoul(values[6], NULL, 2)) : -1;
+        state.periodicTau = (values[7][0] != '\0') ? decodePeriodicTau(strtoul(values[7], NULL, 2)) : -1;
+    } else if (registrationMode == 4 && count == 1) {
+        // nothing granted without a registration
+        state.activeTime = -1;
+        state.periodicTau = -1;
+    }
+
+    uint8_t changes = 0;
+
+    if (!registration.valid || state.status != registration.status) {
+        changes |= RegistrationChangeStatus;
+        state.changedAt = NOW;
+    }
+
+    if (state.tac != registration.tac || state.cellId != registration.cellId || state.accessTechnology != registration.accessTechnology) {
+        changes |= RegistrationChangeCell;
+    }
+
+    if (state.activeTime != registration.activeTime || state.periodicTau != registration.periodicTau) {
+        changes |= RegistrationChangeTimers;
+    }
+
+    registration = state;
+
+    if (changes && registrationCallback) {
+        registrationCallback(registration, changes, registrationContext);
+    }
+}
+
+bool SaraN200::sendBlocked() {
+    // only trust the state while the URCs keep it current
+    if (!registrationMode || !registration.valid || isRegistered()) {
+        return false;
+    }
+
+    debugPrintln("[send] not registered");
+    lastError.type = ErrorNotRegistered;
+    lastError.code = 0;
+
+    return true;
+}
+
+void SaraN200::recordError(const char* line) {
+    unsigned int code;
+
+    if (sscanf(line, STR_RESPONSE_CME_ERROR " %u", &code) == 1) {
+        lastError.type = ErrorCme;
+        lastError.code = code;
+    } else if (sscanf(line, STR_RESPONSE_CMS_ERROR " %u", &code) == 1) {
+        lastError.type = ErrorCms;
+        lastError.code = code;
+    } else {
+        lastError.type = ErrorGeneric;
+        lastError.code = 0;
+    }
+}
+
+SaraN200::RetryAction SaraN200::getRetryAction(const ModemError& error) const {
+    // only the CME codes are specific enough to act on
+    if (error.type == ErrorCme) {
+        for (size_t i = 0; i < retryRuleCount; i++) {
+            if (retryRules[i].code == error.code) {
+                return retryRules[i].action;
+            }
+        }
+
+        for (size_t i = 0; i < ARRAY_SIZE(retryPolicy); i++) {
+            if (retryPolicy[i].code == error.code) {
+                return retryPolicy[i].action;
+            }
+        }
+    }
+
+    return RetryWithBackoff;
+}
+
+bool SaraN200::setEchoEnabled(bool enabled) {
+    if (enabled) {
+        echoManaged = false;
+    }
+
+    echoPending = false;
+    beginCommand(CommandConfig);
+    println(enabled ? "ATE1" : "ATE0");
+
+    return readResponse() == ResponseOK;
+}
+
+void SaraN200::discardEcho(const char* line) {
+    // an AT+NSOST echo carries the hex payload and is far longer than the
+    // input buffer, drop the rest of it instead of parsing the fragments
+    if (lineTruncated) {
+        skipLine(250);
+    }
+
+    // ATE0 itself is still echoed
+    if (!startsWith("ATE", line)) {
+        echoCount++;
+        echoPending = echoManaged;
+    }
+}
+
 bool SaraN200::isAlive() {
+    beginCommand(CommandProbe);
     println(STR_AT);
 
-    return readResponse(NULL, 450) == ResponseOK;
+    return readResponse() == ResponseOK;
 }
 
 void SaraN200::init(Stream* stream) {
     debugPrintln("[init] started");
     initBuffer();
+
+    if (!sockets) {
+        sockets = static_cast<SocketInfo*>(malloc(socketCount * sizeof(SocketInfo)));
+        isSocketTableOwned = true;
+    }
+
+    resetSockets();
     setModemStream(stream);
 }
 
+void SaraN200::resetSockets() {
+    for (size_t i = 0; i < socketCount; i++) {
+        sockets[i].socket = SOCKET_FAIL;
+        sockets[i].localPort = 0;
+        sockets[i].urcEnabled = false;
+        sockets[i].pendingDatagrams = 0;
+        sockets[i].partialBytes = 0;
+        sockets[i].connected = false;
+    }
+}
+
+SaraN200::SocketInfo* SaraN200::findSocket(int socket) {
+    for (size_t i = 0; i < socketCount; i++) {
+        if (sockets[i].socket == socket) {
+            return &sockets[i];
+        }
+    }
+
+    return NULL;
+}
+
+bool SaraN200::handleUrc(const char* line) {
+    int socket;
+    unsigned int length;
+
+    if (sscanf(line, "+NSONMI: %d,%u", &socket, &length) == 2) {
+        SocketInfo* slot = findSocket(socket);
+        if (slot && slot->pendingDatagrams < 0xFFFF) {
+            slot->pendingDatagrams++;
+        }
+
+        return true;
+    }
+
+    // AT+NNMI=2 indication, the message itself waits for AT+NMGR
+    if (strcmp(line, "+NNMI") == 0) {
+        if (nonIpPending < 0xFFFF) {
+            nonIpPending++;
+        }
+
+        return true;
+    }
+
+    int quarters;
+    int dst;
+    int offset = 0;
+
+    // +CTZEU: <tz>,<dst>[,<utime>], with the UTC time when the network sent it
+    if (sscanf(line, "+CTZEU: %d,%d%n", &quarters, &dst, &offset) == 2) {
+        uint32_t epoch;
+        timeZone = quarters * 15;
+
+        if (line[offset] == ',' && parseClock(line + offset + 1, &epoch, NULL)) {
+            setTime(epoch, NOW, TimeSourceNitz);
+        }
+
+        return true;
+    }
+
+    if (sscanf(line, "+CTZV: %d", &quarters) == 1) {
+        timeZone = quarters * 15;
+        return true;
+    }
+
+    // the AT+CEREG? response is handled here too, it only adds <n> up front
+    if (startsWith("+CEREG:", line)) {
+        const char* fields = line + strlen("+CEREG:");
+
+        if (registrationQuery) {
+            fields = strchr(fields, ',');
+            if (!fields) {
+                return true;
+            }
+            fields++;
+        }
+
+        updateRegistration(fields);
+        return true;
+    }
+
+    int mode;
+
+    // the query response "+CSCON: n,mode" has a comma, the URC does not
+    if (!strchr(line, ',') && sscanf(line, "+CSCON: %d", &mode) == 1) {
+        radioConnected = (mode == 1);
+        if (accounting) {
+            accounting->onConnectionState(radioConnected);
+        }
+
+        return true;
+    }
+
+    char address[16];
+    int ttl;
+    unsigned int rtt;
+
+    if (sscanf(line, "+NPING: %15[^,],%d,%u", address, &ttl, &rtt) == 3) {
+        pingPending = false;
+        if (pingStats) {
+            pingStats->addSample(rtt);
+        }
+
+        return true;
+    }
+
+    int error;
+
+    // 1: no reply within the timeout, 2: could not be sent
+    if (sscanf(line, "+NPINGERR: %d", &error) == 1) {
+        pingPending = false;
+        if (pingStats) {
+            pingStats->addLoss();
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void SaraN200::poll() {
+    pollUrcs();
+
+    // the module always answers with +NPING or +NPINGERR, this only
+    // covers a URC lost to a reboot or a full input buffer
+    if (pingPending && is_timedout(pingSentAt, pingTimeout + 5000)) {
+        pingPending = false;
+        if (pingStats) {
+            pingStats->addLoss();
+        }
+    }
+
+    if (pingInterval && !pingPending && radioConnected && is_timedout(lastPingAt, pingInterval)) {
+        if (!ping(pingTarget)) {
+            // try again at the next interval
+            lastPingAt = NOW;
+        }
+    }
+
+    // the command engine is idle, a good moment to refresh stale values
+    if (signalRefreshInterval && (!signalQuality.valid || is_timedout(signalQuality.updatedAt, signalRefreshInterval))) {
+        refreshSignalQuality();
+    }
+}
+
+void SaraN200::pollUrcs() {
+    while (pendingSendCount > 0 && modemStream->available() > 0) {
+        reapSend();
+    }
+
+    while (modemStream->available() > 0) {
+        size_t count = readln(inputBuffer, inputBufferSize, 250);
+
+        if (count > 0 && !handleUrc(inputBuffer)) {
+            debugPrint("[poll] unexpected: ");
+            debugPrintln(inputBuffer);
+        }
+    }
+}
+
 bool SaraN200::setRadioActive(bool on) {
+    beginCommand(CommandRadio);
     print("AT+CFUN=");
     println(on ? "1" : "0");
 
@@ -78,6 +561,12 @@ ResponseType SaraN200::readResponse(char* buffer, size_t size, CallbackMethodPtr
     ResponseType response = ResponseNotFound;
     uint32_t from = NOW;
 
+    // only commands running on the class timeout feed the estimator
+    bool autoTimeout = (timeout == SARA_N200_TIMEOUT_AUTO);
+    if (autoTimeout) {
+        timeout = timeouts.getTimeout(commandClass);
+    }
+
     do {
         int count = readln(buffer, size, 250);
 
@@ -90,21 +579,30 @@ ResponseType SaraN200::readResponse(char* buffer, size_t size, CallbackMethodPtr
             debugPrintln(buffer);
 
             if (startsWith(STR_AT, buffer)) {
+                discardEcho(buffer);
+                continue;
+            }
+
+            if (handleUrc(buffer)) {
                 continue;
             }
 
             if (startsWith(STR_RESPONSE_OK, buffer)) {
-                return ResponseOK;
+                response = ResponseOK;
+                break;
             }
 
             if (startsWith(STR_RESPONSE_ERROR, buffer) || startsWith(STR_RESPONSE_CME_ERROR, buffer) || startsWith(STR_RESPONSE_CMS_ERROR, buffer)) {
-                return ResponseError;
+                recordError(buffer);
+                response = ResponseError;
+                break;
             }
 
             if (parserMethod) {
                 ResponseType parserResponse = parserMethod(response, buffer, count, callbackParameter, callbackParameter2);
                 if ((parserResponse != ResponseEmpty) && (parserResponse != ResponsePendingExtra)) {
-                    return parserResponse;
+                    response = parserResponse;
+                    break;
                 }
 
                 if (parserResponse != ResponsePendingExtra) {
@@ -115,13 +613,31 @@ ResponseType SaraN200::readResponse(char* buffer, size_t size, CallbackMethodPtr
             if (response != ResponseNotFound) {
                 debugPrintln("**Response != ResponseNotFound**");
 
-                return response;
+                break;
             }
+
+            // more lines may already be waiting, don't sleep between them
+            continue;
         }
 
         delay(10);
     } while(!is_timedout(from, timeout));
 
+    if (response != ResponseNotFound) {
+        if (autoTimeout) {
+            timeouts.addSample(commandClass, NOW - commandSentAt);
+        }
+
+        return response;
+    }
+
+    if (autoTimeout) {
+        timeouts.addTimeout(commandClass);
+    }
+
+    lastError.type = ErrorTimeout;
+    lastError.code = 0;
+
     if (outSize) {
         *outSize = 0;
     }
@@ -130,8 +646,11 @@ ResponseType SaraN200::readResponse(char* buffer, size_t size, CallbackMethodPtr
     return ResponseTimeout;
 }
 
-bool SaraN200::createContext(const char* apn) {
-    print("AT+CGDCONT=" DEFAULT_CID ",\"IP\",\"");
+bool SaraN200::createContext(const char* apn, bool nonIp) {
+    beginCommand(CommandConfig);
+    print("AT+CGDCONT=" DEFAULT_CID ",\"");
+    print(nonIp ? "NONIP" : "IP");
+    print("\",\"");
     print(apn);
     println("\"");
 
@@ -140,6 +659,7 @@ bool SaraN200::createContext(const char* apn) {
 
 bool SaraN200::isConnected() {
     uint8_t value = 0;
+    beginCommand(CommandQuery);
     println("AT+CGATT?");
 
     if (readResponse<uint8_t, uint8_t>(cgAttParser, &value, NULL) == ResponseOK) {
@@ -164,248 +684,1443 @@ ResponseType SaraN200::cgAttParser(ResponseType& response, const char* buffer, s
 }
 
 bool SaraN200::disconnect() {
+    beginCommand(CommandDetach);
     println("AT+CGATT=0");
 
-    return readResponse(NULL, 40 * 1000) == ResponseOK;
+    return readResponse() == ResponseOK;
 }
 
 bool SaraN200::autoconnect(bool turnOffRadioFirst) {
-    if (!on()) {
+    uint32_t start = NOW;
+    memset(&bootTimings, 0, sizeof(bootTimings));
+
+    bool result = autoconnectPhases(turnOffRadioFirst);
+    bootTimings.total = NOW - start;
+
+    // NITZ normally arrives with the attach, no radio traffic needed
+    if (result) {
+        rememberNetwork();
+        syncNetworkTime();
+    }
+
+    return result;
+}
+
+bool SaraN200::autoconnectPhases(bool turnOffRadioFirst) {
+    if (!detect()) {
         return false;
     }
 
     if (turnOffRadioFirst) {
+        uint32_t phase = NOW;
         if (!checkAndApplyNconfig()) {
             return false;
         }
 
-        disconnect();
-        reboot();
+        disconnect();
+        bootTimings.configure += NOW - phase;
+
+        if (!reboot() && !detect()) {
+            return false;
+        }
+    }
+
+    uint32_t phase = NOW;
+    bool result = isConnected() || attachHinted(true);
+
+    if (!result) {
+        uint32_t start = NOW;
+        result = waitForSignalQuality(60 * 1000) && waitForGprs(60 * 1000);
+        addAttachAttempt(NOW - start, false, result);
+    }
+
+    bootTimings.attach += NOW - phase;
+
+    return result;
+}
+
+bool SaraN200::connect(const char* apn, bool noAutoconnect) {
+    uint32_t start = NOW;
+    memset(&bootTimings, 0, sizeof(bootTimings));
+
+    bool result = connectPhases(apn, noAutoconnect);
+    bootTimings.total = NOW - start;
+
+    // NITZ normally arrives with the attach, no radio traffic needed
+    if (result) {
+        rememberNetwork();
+        syncNetworkTime();
+    }
+
+    return result;
+}
+
+bool SaraN200::connectPhases(const char* apn, bool noAutoconnect) {
+    if (!detect()) {
+        return false;
+    }
+
+    uint32_t phase = NOW;
+    bool changed = false;
+
+    if (!setRadioActive(false)) {
+        return false;
+    }
+
+    if (!checkAndApplyNconfig(noAutoconnect, &changed)) {
+        return false;
+    }
+
+    bootTimings.configure += NOW - phase;
+
+    // NCONFIG only takes effect after a reboot, skip it when nothing changed
+    if (changed) {
+        if (!reboot() && !detect()) {
+            return false;
+        }
+    }
+
+    phase = NOW;
+    bool result = isConnected();
+
+    if (!result && createContext(apn)) {
+        result = attachHinted(false);
+
+        if (!result) {
+            uint32_t start = NOW;
+            result = setRadioActive(true) && attachGprs();
+            addAttachAttempt(NOW - start, false, result);
+        }
+    }
+
+    bootTimings.attach += NOW - phase;
+
+    return result;
+}
+
+bool SaraN200::attachHinted(bool automatic) {
+    if (!networkHintEnabled || !networkHint.valid) {
+        return false;
+    }
+
+    uint32_t start = NOW;
+    bool bandLocked = false;
+    bool earfcnLocked = false;
+
+    bool ready = setRadioActive(false);
+
+    if (ready && networkHint.band) {
+        if (networkHint.searchBandCount == 0) {
+            networkHint.searchBandCount = getBands(networkHint.searchBands, SARA_N200_MAX_BANDS);
+        }
+
+        ready = networkHint.searchBandCount > 0 && setBands(&networkHint.band, 1);
+        bandLocked = ready;
+    }
+
+    // older firmware has no AT+NEARFCN, the band lock still helps
+    if (ready && networkHint.earfcn) {
+        earfcnLocked = setEarfcnHint(networkHint.earfcn, networkHint.pci);
+    }
+
+    bool plmnLocked = networkHint.plmn[0] != '\0';
+    bool attached = ready && setRadioActive(true) &&
+                    (!plmnLocked || selectOperator(networkHint.plmn, time_left(start, networkHintTimeout)));
+
+    // with AUTOCONNECT the module attaches on its own
+    if (attached && !automatic) {
+        attached = attachGprs(time_left(start, networkHintTimeout));
+    }
+
+    if (attached) {
+        attached = waitForGprs(time_left(start, networkHintTimeout));
+    }
+
+    // The locks stay in the module's NVM, while searchBands is lost with an
+    // MCU reset: undo them right away. The module comes back on the cell it
+    // has just used.
+    if (attached && (bandLocked || earfcnLocked)) {
+        uint32_t restart = NOW;
+
+        setRadioActive(false);
+        unlockNetwork(bandLocked, earfcnLocked);
+        bandLocked = false;
+        earfcnLocked = false;
+
+        attached = setRadioActive(true) &&
+                   (automatic || attachGprs(time_left(restart, networkHintTimeout))) &&
+                   waitForGprs(time_left(restart, networkHintTimeout));
+    }
+
+    if (attached && plmnLocked && !selectOperator(NULL, networkHintTimeout)) {
+        debugPrintln("[attach] could not go back to automatic operator selection");
+    }
+
+    if (!attached) {
+        debugPrintln("[attach] last known network failed, searching all");
+
+        // undo the locks for the full search
+        setRadioActive(false);
+        unlockNetwork(bandLocked, earfcnLocked);
+
+        // the search that follows needs the radio on either way
+        if (setRadioActive(true) && plmnLocked) {
+            selectOperator(NULL);
+        }
+
+        networkHint.valid = false;
+    }
+
+    uint32_t duration = NOW - start;
+    addAttachAttempt(duration, true, attached);
+    bootTimings.hintedAttach += duration;
+    bootTimings.hinted = attached;
+
+    return attached;
+}
+
+void SaraN200::unlockNetwork(bool bandLocked, bool earfcnLocked) {
+    if (bandLocked) {
+        setBands(networkHint.searchBands, networkHint.searchBandCount);
+    }
+
+    if (earfcnLocked) {
+        setEarfcnHint(0);
+    }
+}
+
+void SaraN200::addAttachAttempt(uint32_t duration, bool hinted, bool success) {
+    if (attachAttemptCount == SARA_N200_ATTACH_HISTORY) {
+        memmove(attachAttempts, attachAttempts + 1, (SARA_N200_ATTACH_HISTORY - 1) * sizeof(AttachAttempt));
+        attachAttemptCount--;
+    }
+
+    AttachAttempt* attempt = &attachAttempts[attachAttemptCount++];
+    attempt->duration = duration;
+    attempt->hinted = hinted;
+    attempt->success = success;
+}
+
+size_t SaraN200::getAttachAttempts(AttachAttempt* attempts, size_t maxAttempts) const {
+    size_t count = (attachAttemptCount > maxAttempts) ? maxAttempts : attachAttemptCount;
+
+    // the latest ones when they don't all fit
+    memcpy(attempts, attachAttempts + attachAttemptCount - count, count * sizeof(AttachAttempt));
+
+    return count;
+}
+
+void SaraN200::rememberNetwork() {
+    if (!networkHintEnabled) {
+        return;
+    }
+
+    NetworkHint hint;
+    memset(&hint, 0, sizeof(hint));
+    hint.pci = -1;
+
+    if (!getOperator(hint.plmn, sizeof(hint.plmn))) {
+        hint.plmn[0] = '\0';
+    }
+
+    RadioStats stats;
+    if (getRadioStats(&stats) && stats.earfcn > 0) {
+        hint.earfcn = stats.earfcn;
+        hint.pci = stats.pci;
+        hint.band = getBandForEarfcn(stats.earfcn);
+    }
+
+    // the bands from before the lock still are the ones to search
+    memcpy(hint.searchBands, networkHint.searchBands, sizeof(hint.searchBands));
+    hint.searchBandCount = networkHint.searchBandCount;
+
+    hint.valid = hint.plmn[0] != '\0' || hint.band != 0;
+    if (hint.valid) {
+        networkHint = hint;
+    }
+}
+
+bool SaraN200::setBands(const uint8_t* bands, size_t count) {
+    if (count == 0) {
+        return false;
+    }
+
+    beginCommand(CommandConfig);
+    print("AT+NBAND=");
+
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            print(",");
+        }
+        print(bands[i]);
+    }
+    println();
+
+    return readResponse() == ResponseOK;
+}
+
+size_t SaraN200::getBands(uint8_t* bands, size_t maxBands) {
+    size_t count = maxBands;
+
+    beginCommand(CommandQuery);
+    println("AT+NBAND?");
+
+    if (readResponse<uint8_t, size_t>(bandParser, bands, &count) == ResponseOK) {
+        return count;
+    }
+
+    return 0;
+}
+
+ResponseType SaraN200::bandParser(ResponseType& response, const char* buffer, size_t size, uint8_t* bands, size_t* count) {
+    if (!startsWith("+NBAND:", buffer)) {
+        return ResponseError;
+    }
+
+    size_t maxBands = *count;
+    const char* p = buffer + strlen("+NBAND:");
+    *count = 0;
+
+    while (*count < maxBands) {
+        char* end;
+        long band = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+
+        bands[(*count)++] = band;
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    return ResponseEmpty;
+}
+
+bool SaraN200::selectOperator(const char* plmn, uint32_t timeout) {
+    beginCommand(CommandAttach);
+
+    if (!plmn) {
+        println("AT+COPS=0");
+    } else {
+        print("AT+COPS=1,2,\"");
+        print(plmn);
+        println("\"");
+    }
+
+    return readResponse(static_cast<size_t*>(NULL), timeout) == ResponseOK;
+}
+
+bool SaraN200::getOperator(char* plmn, size_t size) {
+    size_t plmnSize = size;
+
+    beginCommand(CommandQuery);
+    println("AT+COPS?");
+
+    if (readResponse<char, size_t>(operatorParser, plmn, &plmnSize) == ResponseOK) {
+        return plmnSize > 0;
+    }
+
+    return false;
+}
+
+ResponseType SaraN200::operatorParser(ResponseType& response, const char* buffer, size_t size, char* plmn, size_t* plmnSize) {
+    int mode;
+    char oper[7];
+
+    // +COPS: <mode>[,<format>,"<oper>"], the operator only while registered
+    if (sscanf(buffer, "+COPS: %d,%*d,\"%6[0-9]\"", &mode, oper) == 2 && strlen(oper) < *plmnSize) {
+        strcpy(plmn, oper);
+        *plmnSize = strlen(oper);
+        return ResponseEmpty;
+    }
+
+    if (sscanf(buffer, "+COPS: %d", &mode) == 1) {
+        *plmnSize = 0;
+        return ResponseEmpty;
+    }
+
+    return ResponseError;
+}
+
+bool SaraN200::setEarfcnHint(uint32_t earfcn, int16_t pci) {
+    beginCommand(CommandConfig);
+    print("AT+NEARFCN=0,");
+    print(earfcn);
+
+    // the PCI goes in hex
+    if (earfcn && pci >= 0) {
+        print(",");
+        print(pci, HEX);
+    }
+    println();
+
+    return readResponse() == ResponseOK;
+}
+
+uint8_t SaraN200::getBandForEarfcn(uint32_t earfcn) {
+    // downlink EARFCN ranges from 3GPP TS 36.101 for the NB-IoT bands
+    static const struct {
+        uint32_t first;
+        uint32_t last;
+        uint8_t band;
+    } ranges[] = {
+        {0, 599, 1},
+        {600, 1199, 2},
+        {1200, 1949, 3},
+        {1950, 2399, 4},
+        {2400, 2649, 5},
+        {3450, 3799, 8},
+        {5010, 5179, 12},
+        {5180, 5279, 13},
+        {5730, 5849, 17},
+        {5850, 5999, 18},
+        {6000, 6149, 19},
+        {6150, 6449, 20},
+        {8040, 8689, 25},
+        {8690, 9039, 26},
+        {9210, 9659, 28},
+        {66436, 67335, 66},
+        {68586, 68935, 71},
+        {70366, 70545, 85},
+    };
+
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        if (earfcn >= ranges[i].first && earfcn <= ranges[i].last) {
+            return ranges[i].band;
+        }
+    }
+
+    return 0;
+}
+
+bool SaraN200::detect() {
+    uint32_t start = NOW;
+    bool alive = on();
+
+    if (alive && echoManaged) {
+        setEchoEnabled(false);
+    }
+
+    if (alive) {
+        setErrorCodesEnabled(true);
+    }
+
+    if (alive && registrationMode) {
+        setRegistrationUrcEnabled(true, registrationMode == 4);
+    }
+
+    bootTimings.detect += NOW - start;
+    bootTimings.probes += probeCount;
+
+    return alive;
+}
+
+bool SaraN200::getRSSIAndBER(int8_t* rssi, uint8_t* ber) {
+    if (!signalQuality.valid || is_timedout(signalQuality.updatedAt, signalQualityTtl)) {
+        if (!querySignalQuality()) {
+            return false;
+        }
+    }
+
+    *rssi = signalQuality.rssi;
+    *ber = signalQuality.ber;
+
+    return true;
+}
+
+bool SaraN200::querySignalQuality() {
+    static char berValues[] = { 49, 43, 37, 25, 19, 13, 7, 0 };
+    int csqRaw = 0;
+    int berRaw = 0;
+
+    beginCommand(CommandQuery);
+    println("AT+CSQ");
+
+    if (readResponse<int, int>(csqParser, &csqRaw, &berRaw) == ResponseOK) {
+        signalQuality.rssi = (csqRaw == 99) ? 0 : convertCSQ2RSSI(csqRaw);
+        signalQuality.ber = (berRaw == 99 || static_cast<size_t>(berRaw) >= sizeof(berValues)) ? 0 : berValues[berRaw];
+        signalQuality.updatedAt = NOW;
+        signalQuality.valid = true;
+
+        return true;
+    }
+
+    return false;
+}
+
+bool SaraN200::getSignalQuality(SignalQuality* quality, uint32_t* age) const {
+    *quality = signalQuality;
+
+    if (age) {
+        *age = signalQuality.valid ? NOW - signalQuality.updatedAt : 0;
+    }
+
+    return signalQuality.valid;
+}
+
+bool SaraN200::refreshSignalQuality(bool extended) {
+    if (!querySignalQuality()) {
+        return false;
+    }
+
+    if (!extended) {
+        return true;
+    }
+
+    RadioStats stats;
+    return getRadioStats(&stats);
+}
+
+ResponseType SaraN200::csqParser(ResponseType& response, const char* buffer, size_t size, int* csqResult, int* berResult) {
+    if (!csqResult || !berResult) {
+        return ResponseError;
+    }
+
+    if (sscanf(buffer, "+CSQ: %d,%d", csqResult, berResult) == 2) {
+        return ResponseEmpty;
+    }
+
+    return ResponseError;
+}
+
+bool SaraN200::getRadioStats(RadioStats* stats) {
+    memset(stats, 0, sizeof(RadioStats));
+    stats->txPower = SARA_TX_POWER_UNKNOWN;
+
+    beginCommand(CommandQuery);
+    println("AT+NUESTATS=\"RADIO\"");
+
+    if (readResponse<RadioStats, uint8_t>(radioStatsParser, stats, NULL) == ResponseOK) {
+        signalQuality.rsrp = stats->signalPower;
+        signalQuality.rsrq = stats->rsrq;
+        signalQuality.snr = stats->snr;
+        signalQuality.ecl = stats->ecl;
+        signalQuality.extendedAt = NOW;
+        signalQuality.extended = true;
+
+        if (accounting) {
+            accounting->onRadioStats(*stats);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+ResponseType SaraN200::radioStatsParser(ResponseType& response, const char* buffer, size_t size, RadioStats* stats, uint8_t* unused) {
+    if (!stats) {
+        return ResponseError;
+    }
+
+    char name[20];
+    long value;
+
+    // newer firmware: NUESTATS: "RADIO","Signal power",-1029
+    // older firmware: Signal power:-1029
+    if (sscanf(buffer, "NUESTATS: \"RADIO\",\"%19[^\"]\",%ld", name, &value) != 2 &&
+        sscanf(buffer, "%19[^:]:%ld", name, &value) != 2) {
+        return ResponsePendingExtra;
+    }
+
+    if (strcmp(name, "Signal power") == 0) {
+        stats->signalPower = value;
+    } else if (strcmp(name, "Total power") == 0) {
+        stats->totalPower = value;
+    } else if (strcmp(name, "TX power") == 0) {
+        stats->txPower = value;
+    } else if (strcmp(name, "TX time") == 0) {
+        stats->txTime = value;
+    } else if (strcmp(name, "RX time") == 0) {
+        stats->rxTime = value;
+    } else if (strcmp(name, "Cell ID") == 0) {
+        stats->cellId = value;
+    } else if (strcmp(name, "ECL") == 0) {
+        stats->ecl = value;
+    } else if (strcmp(name, "SNR") == 0) {
+        stats->snr = value;
+    } else if (strcmp(name, "EARFCN") == 0) {
+        stats->earfcn = value;
+    } else if (strcmp(name, "PCI") == 0) {
+        stats->pci = value;
+    } else if (strcmp(name, "RSRQ") == 0) {
+        stats->rsrq = value;
+    }
+
+    return ResponsePendingExtra;
+}
+
+bool SaraN200::ping(IPAddress ip, uint16_t size, uint32_t timeout) {
+    char address[16];
+    formatIp(address, ip);
+
+    beginCommand(CommandQuery);
+    print("AT+NPING=\"");
+    print(address);
+    print("\",");
+    print(size);
+    print(",");
+    println(timeout);
+
+    if (readResponse() != ResponseOK) {
+        return false;
+    }
+
+    pingPending = true;
+    pingSentAt = NOW;
+    pingTimeout = timeout;
+    lastPingAt = pingSentAt;
+
+    return true;
+}
+
+void SaraN200::setPingSchedule(IPAddress ip, uint32_t interval) {
+    pingTarget = ip;
+    pingInterval = interval;
+}
+
+bool SaraN200::setConnectionUrcEnabled(bool enabled) {
+    beginCommand(CommandConfig);
+    print("AT+CSCON=");
+    println(enabled ? "1" : "0");
+
+    return readResponse() == ResponseOK;
+}
+
+int8_t SaraN200::convertCSQ2RSSI(uint8_t csq) const {
+    return -113 + 2 * csq;
+}
+
+uint8_t SaraN200::convertRSSI2CSQ(int8_t rssi) const {
+    return (rssi + 113) / 2;
+}
+
+int SaraN200::createSocket(uint16_t localPort, bool enableURC) {
+    SocketInfo* slot = findSocket(SOCKET_FAIL);
+    if (!slot) {
+        debugPrintln(DEBUG_STR_ERROR "socket table is full");
+        return -1;
+    }
+
+    beginCommand(CommandSocket);
+    print("AT+NSOCR=\"DGRAM\",17,");
+    print(localPort);
+    print(",");
+    println(enableURC ? "1" : "0");
+
+    int fd = -1;
+
+    if (readResponse<int, int>(createSocketParser, &fd, NULL) == ResponseOK) {
+        slot->socket = fd;
+        slot->localPort = localPort;
+        slot->urcEnabled = enableURC;
+        slot->pendingDatagrams = 0;
+        slot->partialBytes = 0;
+        slot->connected = false;
+
+        return fd;
+    }
+
+    return -1;
+}
+
+ResponseType SaraN200::createSocketParser(ResponseType& response, const char* buffer, size_t size, int* socketFd, int* unused) {
+    if (!socketFd) {
+        return ResponseError;
+    }
+
+    if (sscanf(buffer, "%d\r", socketFd) == 1) {
+        return ResponseEmpty;
+    }
+
+    return ResponseError;
+}
+
+int SaraN200::socketSendTo(int socket, IPAddress ip, uint16_t port, uint8_t* buffer, size_t size) {
+    char ipText[16];
+    char prefix[SARA_N200_SEND_PREFIX_SIZE];
+
+    formatIp(ipText, ip);
+    formatSendPrefix(prefix, socket, ipText, port);
+
+    return sendCommand(prefix, socket, buffer, size);
+}
+
+uint32_t SaraN200::socketSendToAsync(int socket, IPAddress ip, uint16_t port, const uint8_t* buffer, size_t size) {
+    char ipText[16];
+    char prefix[SARA_N200_SEND_PREFIX_SIZE];
+
+    formatIp(ipText, ip);
+    formatSendPrefix(prefix, socket, ipText, port);
+
+    return sendCommandAsync(prefix, socket, buffer, size);
+}
+
+bool SaraN200::socketConnect(int socket, IPAddress ip, uint16_t port) {
+    SocketInfo* slot = findSocket(socket);
+    if (socket == SOCKET_FAIL || !slot) {
+        return false;
+    }
+
+    formatIp(slot->peerIp, ip);
+    slot->peerPort = port;
+    formatSendPrefix(slot->sendPrefix, socket, slot->peerIp, port);
+    slot->connected = true;
+
+    return true;
+}
+
+void SaraN200::socketDisconnect(int socket) {
+    SocketInfo* slot = findSocket(socket);
+    if (socket != SOCKET_FAIL && slot) {
+        slot->connected = false;
+    }
+}
+
+int SaraN200::socketSend(int socket, const uint8_t* buffer, size_t size) {
+    SocketInfo* slot = findSocket(socket);
+    if (socket == SOCKET_FAIL || !slot || !slot->connected) {
+        return -1;
+    }
+
+    return sendCommand(slot->sendPrefix, socket, buffer, size);
+}
+
+uint32_t SaraN200::socketSendAsync(int socket, const uint8_t* buffer, size_t size) {
+    SocketInfo* slot = findSocket(socket);
+    if (socket == SOCKET_FAIL || !slot || !slot->connected) {
+        return 0;
+    }
+
+    return sendCommandAsync(slot->sendPrefix, socket, buffer, size);
+}
+
+int SaraN200::sendCommand(const char* prefix, int socket, const uint8_t* buffer, size_t size) {
+    if (sendBlocked()) {
+        return -1;
+    }
+
+    beginCommand(CommandSend);
+    writeSendCommand(prefix, buffer, size);
+
+    int usedSocket = -1;
+    int sendLength = -1;
+
+    if (readResponse<int, int>(socketSendToParser, &usedSocket, &sendLength) == ResponseOK) {
+        if (accounting) {
+            accounting->onSend(socket, sendLength);
+        }
+
+        return sendLength;
+    }
+
+    return -1;
+}
+
+uint32_t SaraN200::sendCommandAsync(const char* prefix, int socket, const uint8_t* buffer, size_t size) {
+    if (sendBlocked()) {
+        return 0;
+    }
+
+    // bounded: block on the oldest result rather than flood the module
+    while (pendingSendCount == SARA_N200_MAX_PENDING_SENDS) {
+        reapSend();
+    }
+
+    // not beginCommand(), that would wait for the sends already in flight;
+    // only an echo to turn off does, since ATE0 reads its own OK
+    if (echoPending) {
+        echoPending = false;
+        setEchoEnabled(false);
+    }
+
+    commandClass = CommandSend;
+    lastError.type = ErrorNone;
+    lastError.code = 0;
+    writeSendCommand(prefix, buffer, size);
+
+    if (++nextTicket == 0) {
+        nextTicket = 1;
+    }
+
+    PendingSend& pending = pendingSends[(pendingSendHead + pendingSendCount) % SARA_N200_MAX_PENDING_SENDS];
+    pending.ticket = nextTicket;
+    pending.socket = socket;
+    pendingSendCount++;
+
+    return nextTicket;
+}
+
+void SaraN200::setSendResultCallback(SendResultCallback callback, void* context) {
+    sendResultCallback = callback;
+    sendResultContext = context;
+}
+
+bool SaraN200::flushSends() {
+    bool result = true;
+
+    while (pendingSendCount > 0) {
+        result = reapSend() && result;
+    }
+
+    return result;
+}
+
+bool SaraN200::reapSend() {
+    PendingSend pending = pendingSends[pendingSendHead];
+    pendingSendHead = (pendingSendHead + 1) % SARA_N200_MAX_PENDING_SENDS;
+    pendingSendCount--;
+
+    int usedSocket = -1;
+    int sendLength = -1;
+
+    // an explicit timeout: commandSentAt belongs to a later command, so the
+    // response time must not feed the estimator
+    ResponseType response = readResponse<int, int>(socketSendToParser, &usedSocket, &sendLength, NULL, timeouts.getTimeout(CommandSend));
+    int result = (response == ResponseOK) ? sendLength : -1;
+
+    if (result >= 0 && accounting) {
+        accounting->onSend(pending.socket, result);
+    }
+
+    if (sendResultCallback) {
+        sendResultCallback(pending.ticket, pending.socket, result, sendResultContext);
+    }
+
+    return result >= 0;
+}
+
+void SaraN200::formatIp(char* out, IPAddress ip) {
+    sprintf(out, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
+size_t SaraN200::formatSendPrefix(char* prefix, int socket, const char* ip, uint16_t port) {
+    return snprintf(prefix, SARA_N200_SEND_PREFIX_SIZE, "AT+NSOST=%d,\"%s\",%u,", socket, ip, port);
+}
+
+void SaraN200::writeSendCommand(const char* prefix, const uint8_t* buffer, size_t size) {
+    print(prefix);
+    print(size);
+    print(",\"");
+    writeHex(buffer, size);
+    print("\"");
+    println();
+}
+
+void SaraN200::writeHex(const uint8_t* buffer, size_t size) {
+    // hex goes out in chunks, one print() per byte costs more than the UART
+    char hex[65];
+    size_t used = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        hex[used++] = NIBBLE_TO_HEX_CHAR(HIGH_NIBBLE(buffer[i]));
+        hex[used++] = NIBBLE_TO_HEX_CHAR(LOW_NIBBLE(buffer[i]));
+
+        if (used == sizeof(hex) - 1 || i == size - 1) {
+            hex[used] = '\0';
+            print(hex);
+            used = 0;
+        }
+    }
+}
+
+ResponseType SaraN200::socketSendToParser(ResponseType& response, const char* buffer, size_t size, int* socketFd, int* length) {
+    if (!socketFd || !length) {
+        return ResponseError;
+    }
+
+    if (sscanf(buffer, "%d,%d", socketFd, length) == 2) {
+        return ResponseEmpty;
+    }
+
+    return ResponseError;
+}
+
+int SaraN200::socketRecvFrom(int socket, uint8_t* buffer, size_t size, IPAddress* remoteIp, uint16_t* remotePort) {
+    SocketInfo* slot = findSocket(socket);
+    UdpDownlinkMesssage downlink;
+
+    while (recvChunk(socket, buffer, size, &downlink)) {
+        bool fromPeer = !slot || !slot->connected || (downlink.fromPort == slot->peerPort && strcmp(downlink.fromIp, slot->peerIp) == 0);
+
+        if (!fromPeer) {
+            debugPrint("[recv] dropped datagram from ");
+            debugPrintln(downlink.fromIp);
+            discardDatagram(socket, downlink.remaining);
+            continue;
+        }
+
+        if (remoteIp) {
+            remoteIp->fromString(downlink.fromIp);
+        }
+
+        if (remotePort) {
+            *remotePort = downlink.fromPort;
+        }
+
+        // AT+NSORF is capped by the input buffer, keep reading until the
+        // datagram or the caller's buffer is done
+        size_t used = downlink.dataLength;
+        while (downlink.remaining > 0 && used < size) {
+            if (!recvChunk(socket, buffer + used, size - used, &downlink)) {
+                return used;
+            }
+
+            used += downlink.dataLength;
+        }
+
+        // the rest would come back as a datagram of its own next time
+        discardDatagram(socket, downlink.remaining);
+
+        return used;
+    }
+
+    return -1;
+}
+
+int SaraN200::socketRecvBatch(int socket, uint8_t* buffer, size_t size, UdpPacket* packets, size_t maxPackets, RecvBatchStats* stats) {
+    SocketInfo* slot = findSocket(socket);
+    size_t packetCount = 0;
+    size_t used = 0;
+    size_t commands = 0;
+    size_t truncated = 0;
+    bool inDatagram = false;
+    bool morePending = false;
+
+    while (true) {
+        bool pending = inDatagram || !slot || !slot->urcEnabled || slot->pendingDatagrams > 0;
+        if (!pending) {
+            break;
+        }
+
+        if (used == size || (!inDatagram && packetCount == maxPackets)) {
+            morePending = true;
+            break;
+        }
+
+        UdpDownlinkMesssage downlink;
+        commands++;
+
+        if (!recvChunk(socket, buffer + used, size - used, &downlink)) {
+            // nothing (more) queued on the modem
+            if (slot) {
+                slot->pendingDatagrams = 0;
+            }
+            break;
+        }
+
+        if (!inDatagram) {
+            UdpPacket* packet = &packets[packetCount++];
+            packet->remoteIp.fromString(downlink.fromIp);
+            packet->remotePort = downlink.fromPort;
+            packet->data = buffer + used;
+            packet->length = 0;
+            packet->truncated = false;
+        }
+
+        packets[packetCount - 1].length += downlink.dataLength;
+        used += downlink.dataLength;
+        inDatagram = downlink.remaining > 0;
+
+        if (inDatagram && used == size) {
+            // the rest would come back as a packet of its own next time
+            packets[packetCount - 1].truncated = true;
+            truncated++;
+            commands += discardDatagram(socket, downlink.remaining);
+            inDatagram = false;
+        }
+    }
+
+    if (stats) {
+        stats->packets = packetCount;
+        stats->bytes = used;
+        stats->commands = commands;
+        stats->truncated = truncated;
+        stats->morePending = morePending;
+    }
+
+    debugPrint("[recv batch] packets: ");
+    debugPrint(packetCount);
+    debugPrint(", bytes: ");
+    debugPrint(used);
+    debugPrint(", commands: ");
+    debugPrintln(commands);
+
+    return packetCount;
+}
+
+size_t SaraN200::discardDatagram(int socket, size_t remaining) {
+    DiscardSink sink;
+    size_t commands = 0;
+
+    while (remaining > 0) {
+        size_t length = (remaining > SARA_N200_MAX_DATAGRAM_SIZE) ? SARA_N200_MAX_DATAGRAM_SIZE : remaining;
+        commands++;
+
+        if (recvStreamChunk(socket, sink, length, &remaining) <= 0) {
+            break;
+        }
+    }
+
+    return commands;
+}
+
+uint16_t SaraN200::getPendingDatagrams(int socket) {
+    SocketInfo* slot = findSocket(socket);
+
+    return slot ? slot->pendingDatagrams : 0;
+}
+
+size_t SaraN200::getMaxRecvChunk(size_t size) const {
+    // the whole +NSORF line has to fit in the input buffer
+    size_t fit = (inputBufferSize > SARA_N200_RECV_LINE_SIZE(0)) ? (inputBufferSize - SARA_N200_RECV_LINE_SIZE(0)) / 2 : 1;
+
+    if (size > fit) {
+        size = fit;
+    }
+
+    if (size > SARA_N200_MAX_DATAGRAM_SIZE) {
+        size = SARA_N200_MAX_DATAGRAM_SIZE;
+    }
+
+    return size;
+}
+
+bool SaraN200::recvChunk(int socket, uint8_t* buffer, size_t size, UdpDownlinkMesssage* downlink) {
+    beginCommand(CommandReceive);
+    print("AT+NSORF=");
+    print(socket);
+    print(",");
+    println(getMaxRecvChunk(size));
+
+    downlink->data = buffer;
+    downlink->dataSize = size;
+
+    bool gotMessage = 0;
+    if (readResponse<UdpDownlinkMesssage, bool>(socketRecvFromParser, downlink, &gotMessage) == ResponseOK) {
+        if (!gotMessage) {
+            return false;
+        }
+
+        if (downlink->socket != socket) {
+            debugPrintln("Socket mismatch.");
+            debugPrint("Expected: ");
+            debugPrint(socket);
+            debugPrint(". Actual: ");
+            debugPrintln(downlink->socket);
+
+            return false;
+        }
+
+        if (downlink->truncated) {
+            debugPrintln(DEBUG_STR_ERROR "NSORF response longer than requested, tail dropped");
+        }
+
+        chunkReceived(socket, downlink->dataLength, downlink->remaining);
+
+        return true;
+    }
+
+    return false;
+}
+
+int SaraN200::socketRecvStream(int socket, SaraN200RecvSink& sink, size_t maxBytes) {
+    SocketInfo* slot = findSocket(socket);
+    size_t total = 0;
+    size_t remaining = 0;
+
+    while (maxBytes == 0 || total < maxBytes) {
+        bool pending = (remaining > 0) || !slot || !slot->urcEnabled || slot->pendingDatagrams > 0;
+        if (!pending) {
+            break;
+        }
+
+        size_t capacity = sink.capacity();
+        if (capacity == 0) {
+            debugPrintln("[recv stream] sink busy");
+            break;
+        }
+
+        if (capacity > SARA_N200_MAX_DATAGRAM_SIZE) {
+            capacity = SARA_N200_MAX_DATAGRAM_SIZE;
+        }
+
+        if (maxBytes && capacity > maxBytes - total) {
+            capacity = maxBytes - total;
+        }
+
+        int count = recvStreamChunk(socket, sink, capacity, &remaining);
+        if (count < 0) {
+            return total ? static_cast<int>(total) : -1;
+        }
+
+        if (count == 0 && remaining == 0) {
+            // nothing (more) queued on the modem
+            if (slot) {
+                slot->pendingDatagrams = 0;
+            }
+            break;
+        }
+
+        total += count;
+    }
+
+    return total;
+}
+
+int SaraN200::recvStreamChunk(int socket, SaraN200RecvSink& sink, size_t length, size_t* remaining) {
+    beginCommand(CommandReceive);
+    print("AT+NSORF=");
+    print(socket);
+    print(",");
+    println(length);
+
+    uint32_t timeout = timeouts.getTimeout(CommandReceive);
+    uint32_t from = NOW;
+    int received = 0;
+    *remaining = 0;
+
+    while (!is_timedout(from, timeout)) {
+        int c = timedRead(250);
+        if (c < 0 || c == '\r' || c == '\n') {
+            continue;
+        }
+
+        if (isdigit(c)) {
+            received = recvStreamDatagram(c, socket, sink, remaining);
+            if (received < 0) {
+                readResponse();
+                return -1;
+            }
+            continue;
+        }
+
+        ResponseType response = finishLine(c);
+
+        if (response == ResponseOK) {
+            timeouts.addSample(CommandReceive, NOW - commandSentAt);
+            return received;
+        }
+
+        if (response == ResponseError) {
+            return -1;
+        }
+    }
+
+    timeouts.addTimeout(CommandReceive);
+    lastError.type = ErrorTimeout;
+    lastError.code = 0;
+    debugPrintln("[recv stream]: timed out");
+    return -1;
+}
+
+int SaraN200::recvStreamDatagram(char first, int socket, SaraN200RecvSink& sink, size_t* remaining) {
+    // header up to the opening quote of the payload: socket,"ip",port,length,"
+    size_t n = 0;
+    uint8_t quotes = 0;
+    inputBuffer[n++] = first;
+
+    while (quotes < 3 && n < inputBufferSize - 1) {
+        int c = timedRead(250);
+        if (c < 0) {
+            return -1;
+        }
+
+        inputBuffer[n++] = c;
+        if (c == '"') {
+            quotes++;
+        }
+    }
+    inputBuffer[n] = '\0';
+
+    int fromSocket;
+    char fromIp[16];
+    unsigned int fromPort;
+    unsigned int length;
+
+    if (sscanf(inputBuffer, "%d,\"%15[0-9.]\",%u,%u,\"", &fromSocket, fromIp, &fromPort, &length) != 4 || fromSocket != socket) {
+        return -1;
+    }
+
+    sink.begin(fromSocket, fromIp, fromPort, length);
+
+    uint8_t chunk[32];
+    size_t used = 0;
+
+    for (size_t count = 0; count < length; count++) {
+        int h = timedRead(250);
+        int l = timedRead(250);
+        if (h < 0 || l < 0) {
+            return -1;
+        }
+
+        chunk[used++] = static_cast<uint8_t>(HEX_PAIR_TO_BYTE(h, l));
+        if (used == sizeof(chunk)) {
+            sink.write(chunk, used);
+            used = 0;
+        }
+    }
+
+    if (used > 0) {
+        sink.write(chunk, used);
     }
 
-    if (!waitForSignalQuality(60 * 1000)) {
-        return false;
+    unsigned int left = 0;
+    readln(inputBuffer, inputBufferSize, 250);
+    if (sscanf(inputBuffer, "\",%u", &left) != 1) {
+        return -1;
     }
 
-    return waitForGprs(60 * 1000);
+    *remaining = left;
+    sink.end(left);
+    chunkReceived(socket, length, left);
+
+    return length;
 }
 
-bool SaraN200::connect(const char* apn, bool noAutoconnect) {
-    if (!on()) {
-        return false;
-    }
+void SaraN200::chunkReceived(int socket, size_t length, size_t remaining) {
+    SocketInfo* slot = findSocket(socket);
 
-    if (!setRadioActive(false)) {
-        return false;
+    if (slot) {
+        length += slot->partialBytes;
+        slot->partialBytes = (remaining > 0) ? length : 0;
     }
 
-    if (!checkAndApplyNconfig(noAutoconnect)) {
-        return false;
+    if (remaining > 0) {
+        return;
     }
 
-    reboot();
+    if (slot && slot->pendingDatagrams > 0) {
+        slot->pendingDatagrams--;
+    }
 
-    if (!on()) {
-        return false;
+    if (accounting) {
+        accounting->onReceive(socket, length);
     }
+}
 
-    if (isConnected()) {
-        return true;
+ResponseType SaraN200::finishLine(char first) {
+    // the receive paths decode payloads straight off the UART and only
+    // hand the other lines here, with their first character already read
+    inputBuffer[0] = first;
+    readln(inputBuffer + 1, inputBufferSize - 1, 250);
+
+    debugPrint("[read response]: ");
+    debugPrintln(inputBuffer);
+
+    if (startsWith(STR_AT, inputBuffer)) {
+        discardEcho(inputBuffer);
+        return ResponseEmpty;
     }
 
-    if (!createContext(apn)) {
-        return false;
+    if (handleUrc(inputBuffer)) {
+        return ResponseEmpty;
     }
 
-    if (!setRadioActive(true)) {
-        return false;
+    if (startsWith(STR_RESPONSE_OK, inputBuffer)) {
+        return ResponseOK;
     }
 
-    if (!attachGprs()) {
-        return false;
+    if (startsWith(STR_RESPONSE_ERROR, inputBuffer) || startsWith(STR_RESPONSE_CME_ERROR, inputBuffer) || startsWith(STR_RESPONSE_CMS_ERROR, inputBuffer)) {
+        recordError(inputBuffer);
+        return ResponseError;
     }
 
-    return true;
+    return ResponseEmpty;
 }
 
-bool SaraN200::getRSSIAndBER(int8_t* rssi, uint8_t* ber) {
-    static char berValues[] = { 49, 43, 37, 25, 19, 13, 7, 0 };
-    int csqRaw = 0;
-    int berRaw = 0;
+bool SaraN200::nonIpSend(const uint8_t* buffer, size_t size) {
+    if (size == 0 || size > SARA_N200_MAX_DATAGRAM_SIZE || sendBlocked()) {
+        return false;
+    }
 
-    println("AT+CSQ");
+    // AT+NMGS=<length>,<hex>, the data is not quoted
+    beginCommand(CommandSend);
+    print("AT+NMGS=");
+    print(size);
+    print(",");
+    writeHex(buffer, size);
+    println();
 
-    if (readResponse<int, int>(csqParser, &csqRaw, &berRaw) == ResponseOK) {
-        *rssi = (csqRaw == 99) ? 0 : convertCSQ2RSSI(csqRaw);
-        *ber = (berRaw == 99 || static_cast<size_t>(berRaw) >= sizeof(berValues)) ? 0 : berValues[berRaw];
+    if (readResponse() != ResponseOK) {
+        return false;
+    }
 
-        return true;
+    if (accounting) {
+        accounting->onSend(-1, size, false);
     }
 
-    return false;
+    return true;
 }
 
-ResponseType SaraN200::csqParser(ResponseType& response, const char* buffer, size_t size, int* csqResult, int* berResult) {
-    if (!csqResult || !berResult) {
-        return ResponseError;
-    }
+int SaraN200::nonIpRecv(uint8_t* buffer, size_t size) {
+    beginCommand(CommandReceive);
+    println("AT+NMGR");
 
-    if (sscanf(buffer, "+CSQ: %d,%d", csqResult, berResult) == 2) {
-        return ResponseEmpty;
-    }
+    uint32_t timeout = timeouts.getTimeout(CommandReceive);
+    uint32_t from = NOW;
+    int received = 0;
 
-    return ResponseError;
-}
+    // "<length>,<hex>" then OK, or a bare OK when nothing is buffered
+    while (!is_timedout(from, timeout)) {
+        int c = timedRead(250);
+        if (c < 0 || c == '\r' || c == '\n') {
+            continue;
+        }
 
-int8_t SaraN200::convertCSQ2RSSI(uint8_t csq) const {
-    return -113 + 2 * csq;
-}
+        if (isdigit(c)) {
+            received = recvNonIpMessage(c, buffer, size);
+            if (received < 0) {
+                readResponse();
+                return -1;
+            }
+            continue;
+        }
 
-uint8_t SaraN200::convertRSSI2CSQ(int8_t rssi) const {
-    return (rssi + 113) / 2;
-}
+        ResponseType response = finishLine(c);
 
-int SaraN200::createSocket(uint16_t localPort, bool enableURC) {
-    print("AT+NSOCR=\"DGRAM\",17,");
-    print(localPort);
-    print(",");
-    println(enableURC ? "1" : "0");
+        if (response == ResponseOK) {
+            timeouts.addSample(CommandReceive, NOW - commandSentAt);
 
-    int fd = -1;
+            if (received == 0) {
+                nonIpPending = 0;
+            } else if (nonIpPending > 0) {
+                nonIpPending--;
+            }
 
-    if (readResponse<int, int>(createSocketParser, &fd, NULL) == ResponseOK) {
-        return fd;
+            return received;
+        }
+
+        if (response == ResponseError) {
+            return -1;
+        }
     }
 
+    timeouts.addTimeout(CommandReceive);
+    lastError.type = ErrorTimeout;
+    lastError.code = 0;
+    debugPrintln("[nidd recv]: timed out");
     return -1;
 }
 
-ResponseType SaraN200::createSocketParser(ResponseType& response, const char* buffer, size_t size, int* socketFd, int* unused) {
-    if (!socketFd) {
-        return ResponseError;
-    }
+int SaraN200::recvNonIpMessage(char first, uint8_t* buffer, size_t size) {
+    size_t length = first - '0';
+    int c;
 
-    if (sscanf(buffer, "%d\r", socketFd) == 1) {
-        return ResponseEmpty;
+    while ((c = timedRead(250)) >= 0 && isdigit(c)) {
+        length = length * 10 + (c - '0');
     }
 
-    return ResponseError;
-}
+    if (c != ',' || length > SARA_N200_MAX_DATAGRAM_SIZE) {
+        return -1;
+    }
 
-int SaraN200::socketSendTo(int socket, IPAddress ip, uint16_t port, uint8_t* buffer, size_t size) {
-    print("AT+NSOST=");
-    print(socket);
-    print(",\"");
-    print(ip.toString());
-    print("\",");
-    print(port);
-    print(",");
-    print(size);
-    print(",");
-    print("\"");
+    for (size_t count = 0; count < length; count++) {
+        int h = timedRead(250);
+        int l = timedRead(250);
+        if (h < 0 || l < 0) {
+            return -1;
+        }
 
-    for (size_t i = 0; i < size; i++) {
-        print(static_cast<char>(NIBBLE_TO_HEX_CHAR(HIGH_NIBBLE(buffer[i]))));
-        print(static_cast<char>(NIBBLE_TO_HEX_CHAR(LOW_NIBBLE(buffer[i]))));
+        if (count < size) {
+            buffer[count] = static_cast<uint8_t>(HEX_PAIR_TO_BYTE(h, l));
+        }
     }
-    print("\"");
-    println();
 
-    int usedSocket = -1;
-    int sendLength = -1;
+    // the rest of the line is only the terminator
+    skipLine(250);
 
-    if (readResponse<int, int>(socketSendToParser, &usedSocket, &sendLength) == ResponseOK) {
-        return sendLength;
+    if (length > size) {
+        debugPrintln("[nidd recv] message truncated");
     }
 
-    return -1;
+    if (accounting) {
+        accounting->onReceive(-1, length, false);
+    }
+
+    return (length > size) ? size : length;
 }
 
-ResponseType SaraN200::socketSendToParser(ResponseType& response, const char* buffer, size_t size, int* socketFd, int* length) {
-    if (!socketFd || !length) {
-        return ResponseError;
-    }
+bool SaraN200::setNonIpUrcEnabled(bool enabled) {
+    beginCommand(CommandConfig);
+    print("AT+NNMI=");
+    println(enabled ? "2" : "0");
 
-    if (sscanf(buffer, "%d,%d", socketFd, length) == 2) {
-        return ResponseEmpty;
+    if (readResponse() != ResponseOK) {
+        return false;
     }
 
-    return ResponseError;
+    nonIpUrcEnabled = enabled;
+    return true;
 }
 
-int SaraN200::socketRecvFrom(int socket, uint8_t* buffer, size_t size) {
-    print("AT+NSORF=");
-    print(socket);
-    print(",");
-    println(size);
+ResponseType SaraN200::socketRecvFromParser(ResponseType& response, const char* buffer, size_t size, UdpDownlinkMesssage* result, bool* gotResponse) {
+    if (!result) {
+        return ResponseError;
+    }
 
-    UdpDownlinkMesssage downlink;
-    bool gotMessage = 0;
-    if (readResponse<UdpDownlinkMesssage, bool>(socketRecvFromParser, &downlink, &gotMessage) == ResponseOK) {
-        if (!gotMessage) {
-            return -1;
-        }
+    *gotResponse = false;
 
-        if (downlink.socket != socket) {
-            debugPrintln("Socket mismatch.");
-            debugPrint("Expected: ");
-            debugPrint(socket);
-            debugPrint(". Actual: ");
-            debugPrintln(downlink.socket);
+    unsigned int length = 0;
+    unsigned int remaining = 0;
+    int offset = 0;
 
-            return -1;
-        }
+    if (sscanf(buffer, "%d,\"%15[0-9.]\",%hu,%u,\"%n", &result->socket, result->fromIp, &result->fromPort, &length, &offset) != 4 || offset == 0) {
+        return ResponseError;
+    }
 
-        for (int i = 0; i < downlink.dataLength * 2; i += 2) {
-            char h = downlink.data[i];
-            char l = downlink.data[i + 1];
+    const char* hex = buffer + offset;
+    size_t count = 0;
 
-            char convertedByte = HEX_PAIR_TO_BYTE(h, l);
-            *buffer++ = static_cast<uint8_t>(convertedByte);
+    while (count < length && isxdigit(hex[0]) && isxdigit(hex[1])) {
+        if (count < result->dataSize) {
+            result->data[count] = static_cast<uint8_t>(HEX_PAIR_TO_BYTE(hex[0], hex[1]));
         }
 
-        return downlink.dataLength;
+        count++;
+        hex += 2;
     }
 
-    return -1;
-}
-
-ResponseType SaraN200::socketRecvFromParser(ResponseType& response, const char* buffer, size_t size, UdpDownlinkMesssage* result, bool* gotResponse) {
-    if (!result) {
+    // a short payload means the line did not fit in the input buffer
+    if (count != length || sscanf(hex, "\",%u", &remaining) != 1) {
         return ResponseError;
     }
 
-    if (sscanf(buffer, "%d,\"%[0-9.]\",%hu,%d,\"%[0-9a-fA-F]\",%u", &result->socket, result->fromIp, &result->fromPort, &result->dataLength, result->data, &result->remaining) == 6) {
-        *gotResponse = true;
-        return ResponseEmpty;
-    }
+    result->truncated = count > result->dataSize;
+    result->dataLength = result->truncated ? result->dataSize : count;
+    result->remaining = remaining;
+    *gotResponse = true;
 
-    *gotResponse = false;
-    return ResponseError;
+    return ResponseEmpty;
 }
 
 bool SaraN200::closeSocket(int socket) {
+    beginCommand(CommandSocket);
     print("AT+NSOCL=");
     println(socket);
 
-    return readResponse() == ResponseOK;
+    // a socket the module no longer knows is closed all the same
+    if (readResponse() != ResponseOK && getRetryAction() != RetryRecreateSocket) {
+        return false;
+    }
+
+    SocketInfo* slot = findSocket(socket);
+    if (slot) {
+        slot->socket = SOCKET_FAIL;
+    }
+
+    return true;
 }
 
 bool SaraN200::waitForSignalQuality(uint32_t timeout) {
     uint32_t start = millis();
-    int8_t rssi;
-    uint8_t ber;
-
     uint32_t interval = 2000;
 
     while (!is_timedout(start, timeout)) {
-        if (millis() % interval == 0) {
-            if (getRSSIAndBER(&rssi, &ber)) {
-                if (rssi != 0) {
-                    return true;
-                }
-            }
+        if (querySignalQuality() && signalQuality.rssi != 0) {
+            return true;
         }
+
+        delay(interval);
     }
 
     return false;
@@ -416,21 +2131,41 @@ bool SaraN200::attachGprs(uint32_t timeout) {
     uint32_t delayCount = 500;
 
     while (!is_timedout(start, timeout)) {
+        beginCommand(CommandAttach);
         println("AT+CGATT=1");
 
         if (readResponse() == ResponseOK) {
+            if (accounting) {
+                accounting->onAttach(millis() - start, true);
+            }
+
             return true;
         }
 
+        RetryAction action = getRetryAction();
+        if (action == RetryGiveUp) {
+            break;
+        }
+
+        if (action == RetryImmediately) {
+            continue;
+        }
+
+        delay(delayCount);
         if (delayCount < 5000) {
             delayCount += 1000;
         }
     }
 
+    if (accounting) {
+        accounting->onAttach(millis() - start, false);
+    }
+
     return false;
 }
 
 bool SaraN200::setConfigParam(const char* param, const char* value) {
+    beginCommand(CommandConfig);
     print("AT+NCONFIG=");
     print(param);
     print(",");
@@ -440,9 +2175,13 @@ bool SaraN200::setConfigParam(const char* param, const char* value) {
     return readResponse() == ResponseOK;
 }
 
-bool SaraN200::checkAndApplyNconfig(bool forceNoAutoconnect) {
+bool SaraN200::checkAndApplyNconfig(bool forceNoAutoconnect, bool* changed) {
     bool applyParamResult[nConfigCount];
+    bool applied = false;
 
+    memset(applyParamResult, 0, sizeof(applyParamResult));
+
+    beginCommand(CommandConfig);
     println("AT+NCONFIG?");
 
     if (readResponse<bool, uint8_t>(checkAndApplyNconfigParser, applyParamResult, NULL) == ResponseOK) {
@@ -450,19 +2189,31 @@ bool SaraN200::checkAndApplyNconfig(bool forceNoAutoconnect) {
             debugPrint(nConfig[i].Name);
 
             if (strcmp(nConfig[i].Name, "\"AUTOCONNECT\"") == 0 && forceNoAutoconnect) {
-                setConfigParam(nConfig[i].Name, "\"FALSE\"");
-                debugPrintln("... FORCING to FALSE");
+                // applyParamResult tells whether it is "TRUE" right now
+                if (applyParamResult[i]) {
+                    setConfigParam(nConfig[i].Name, "\"FALSE\"");
+                    applied = true;
+                    debugPrintln("... FORCING to FALSE");
+                } else {
+                    debugPrintln("... OK");
+                }
+
                 continue;
             }
 
             if (!applyParamResult[i]) {
                 debugPrintln("... CHANGE");
                 setConfigParam(nConfig[i].Name, nConfig[i].Value);
+                applied = true;
             } else {
                 debugPrintln("... OK");
             }
         }
 
+        if (changed) {
+            *changed = applied;
+        }
+
         return true;
     }
 
@@ -494,12 +2245,233 @@ ResponseType SaraN200::checkAndApplyNconfigParser(ResponseType& response, const
     return ResponseError;
 }
 
-void SaraN200::reboot() {
+bool SaraN200::reboot() {
+    uint32_t start = NOW;
+    bool banner = false;
+    bool ready = false;
+
+    beginCommand(CommandGeneric);
     println("AT+NRB");
 
-    uint32_t start = millis();
-    while ((readResponse() != ResponseOK) && !is_timedout(start, 2000)) {
+    // The module answers REBOOTING, restarts and prints its banner
+    // (REBOOT_CAUSE_..., u-blox or Neul) followed by OK once it accepts
+    // commands again, so there is no need to sleep and probe.
+    while (!ready && !is_timedout(start, SARA_N200_REBOOT_TIMEOUT)) {
+        if (readln(inputBuffer, inputBufferSize, 250) == 0) {
+            continue;
+        }
+
+        debugPrint("[reboot]: ");
+        debugPrintln(inputBuffer);
+
+        if (startsWith("REBOOT", inputBuffer) || startsWith("u-blox", inputBuffer) || startsWith("Neul", inputBuffer)) {
+            banner = true;
+        } else if (banner && startsWith(STR_RESPONSE_OK, inputBuffer)) {
+            ready = true;
+        }
+    }
+
+    if (ready && echoManaged) {
+        setEchoEnabled(false);
+    }
+
+    if (ready) {
+        setErrorCodesEnabled(true);
+    }
+
+    // sockets and cached values did not survive the restart
+    registration.valid = false;
+    if (ready && registrationMode) {
+        setRegistrationUrcEnabled(true, registrationMode == 4);
+    }
+
+    resetSockets();
+    nonIpUrcEnabled = false;
+    nonIpPending = 0;
+    signalQuality.valid = false;
+    signalQuality.extended = false;
+
+    bootTimings.reboot += NOW - start;
+    bootTimings.rebooted = true;
+
+    return ready;
+}
+
+static uint32_t daysFromCivil(int year, unsigned month, unsigned day) {
+    // days since 1970-01-01 in the proleptic Gregorian calendar
+    year -= (month <= 2);
+    int era = year / 400;
+    unsigned yoe = static_cast<unsigned>(year - era * 400);
+    unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return static_cast<uint32_t>(era * 146097 + static_cast<int>(doe) - 719468);
+}
+
+bool SaraN200::parseClock(const char* text, uint32_t* epoch, int* quarters) {
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+    int zone = 0;
+
+    // "yy/MM/dd,hh:mm:ss+zz", quoted or not, the zone in quarter hours
+    while (*text == ' ' || *text == '"') {
+        text++;
+    }
+
+    int fields = sscanf(text, "%d/%d/%d,%d:%d:%d%d", &year, &month, &day, &hour, &minute, &second, &zone);
+    if (fields < 6) {
+        return false;
+    }
+
+    if (year < 100) {
+        year += (year >= 70) ? 1900 : 2000;
+    }
+
+    // before NITZ the module counts from its own epoch (1970 or 2000s)
+    if (year < 2020 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    *epoch = daysFromCivil(year, month, day) * 86400UL + hour * 3600UL + minute * 60UL + second;
+    if (quarters) {
+        *quarters = zone;
+    }
+
+    return true;
+}
+
+void SaraN200::setTime(uint32_t epoch, uint32_t at, TimeSource source) {
+    timeEpoch = epoch;
+    timeEpochAt = at;
+    timeSource = source;
+}
+
+bool SaraN200::getTime(uint32_t* epoch) const {
+    if (timeSource == TimeSourceNone) {
+        return false;
+    }
+
+    *epoch = timeEpoch + (NOW - timeEpochAt) / 1000;
+    return true;
+}
+
+bool SaraN200::syncNetworkTime() {
+    uint32_t epoch = 0;
+    int quarters = 0;
+
+    beginCommand(CommandQuery);
+    println("AT+CCLK?");
+
+    uint32_t at = NOW;
+    if (readResponse<uint32_t, int>(clockParser, &epoch, &quarters) != ResponseOK || epoch == 0) {
+        return false;
+    }
+
+    // the Neul firmware reports UTC, the zone comes separately
+    setTime(epoch, at, TimeSourceClock);
+    timeZone = quarters * 15;
+
+    return true;
+}
+
+ResponseType SaraN200::clockParser(ResponseType& response, const char* buffer, size_t size, uint32_t* epoch, int* quarters) {
+    if (!startsWith("+CCLK:", buffer)) {
+        return ResponseError;
+    }
+
+    // a clock the network never set is not an error, just no time
+    if (!parseClock(buffer + 6, epoch, quarters)) {
+        *epoch = 0;
+    }
+
+    return ResponseEmpty;
+}
+
+bool SaraN200::setTimeZoneUrcEnabled(bool enabled) {
+    beginCommand(CommandConfig);
+    print("AT+CTZR=");
+    println(enabled ? "2" : "0");
+
+    return readResponse() == ResponseOK;
+}
+
+bool SaraN200::syncTimeSntp(IPAddress server, uint32_t timeout, uint16_t localPort) {
+    // 48-byte client request, version 4, mode 3
+    uint8_t packet[48];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = 0x23;
+
+    // The server echoes the transmit timestamp as the originate timestamp,
+    // so any value unique to this request ties the reply to it.
+    uint32_t nonce[2] = { NOW, static_cast<uint32_t>(micros()) };
+    uint8_t transmit[8];
+    for (size_t i = 0; i < sizeof(transmit); i++) {
+        transmit[i] = nonce[i / 4] >> (24 - 8 * (i % 4));
+    }
+    memcpy(packet + 40, transmit, sizeof(transmit));
+
+    int socket = createSocket(localPort, true);
+    if (socket < 0) {
+        return false;
+    }
+
+    SocketInfo* slot = findSocket(socket);
+    uint32_t sentAt = NOW;
+    bool synced = false;
+
+    if (socketSendTo(socket, server, 123, packet, sizeof(packet)) == sizeof(packet)) {
+        while (!synced && !is_timedout(sentAt, timeout)) {
+            // only the +NSONMI, no pings or signal refreshes mid-exchange
+            pollUrcs();
+
+            if (!slot || slot->pendingDatagrams == 0) {
+                delay(10);
+                continue;
+            }
+
+            IPAddress remoteIp;
+            uint16_t remotePort = 0;
+            int length = socketRecvFrom(socket, packet, sizeof(packet), &remoteIp, &remotePort);
+            if (length < 0) {
+                // wait for the next +NSONMI instead of asking again
+                slot->pendingDatagrams = 0;
+                continue;
+            }
+
+            // only the reply to this request counts, the socket takes
+            // datagrams from anyone
+            if (!(remoteIp == server) || remotePort != 123 || memcmp(packet + 24, transmit, sizeof(transmit)) != 0) {
+                debugPrintln("[sntp] ignored a datagram that is not the reply");
+                continue;
+            }
+
+            uint8_t mode = packet[0] & 0x07;
+            uint8_t stratum = packet[1];
+
+            // a server reply (mode 4) from a synchronised server
+            if (length == sizeof(packet) && mode == 4 && stratum != 0 && stratum < 16) {
+                uint32_t now = NOW;
+                uint32_t seconds = (static_cast<uint32_t>(packet[40]) << 24) | (static_cast<uint32_t>(packet[41]) << 16) | (static_cast<uint32_t>(packet[42]) << 8) | packet[43];
+                uint32_t fraction = (static_cast<uint32_t>(packet[44]) << 24) | (static_cast<uint32_t>(packet[45]) << 16) | (static_cast<uint32_t>(packet[46]) << 8) | packet[47];
+                uint32_t ms = static_cast<uint32_t>((static_cast<uint64_t>(fraction) * 1000) >> 32);
+
+                // NTP counts from 1900; half the round trip went on the reply
+                setTime(seconds - 2208988800UL, now - ms - (now - sentAt) / 2, TimeSourceSntp);
+                synced = true;
+            }
+        }
     }
+
+    closeSocket(socket);
+    return synced;
+}
+
+bool SaraN200::syncTime(IPAddress sntpServer) {
+    return syncNetworkTime() || syncTimeSntp(sntpServer);
 }
 
 bool SaraN200::startsWith(const char* pre, const char* str) {
@@ -511,11 +2483,11 @@ bool SaraN200::waitForGprs(uint32_t timeout) {
     uint32_t interval = 2000;
 
     while (!is_timedout(start, timeout)) {
-        if (millis() % interval == 0) {
-            if (isConnected()) {
-                return true;
-            }
+        if (isConnected()) {
+            return true;
         }
+
+        delay(interval);
     }
 
     return false;
@@ -524,6 +2496,7 @@ bool SaraN200::waitForGprs(uint32_t timeout) {
 bool SaraN200::sleep() {
     disconnect();
     delay(100);
+    beginCommand(CommandRadio);
     println("AT+CFUN=0");
 
     return readResponse() == ResponseOK;
@@ -532,6 +2505,7 @@ bool SaraN200::sleep() {
 bool SaraN200::printThroughputInfo() {
     debugEnabled = true;
     delay(100);
+    beginCommand(CommandQuery);
     println("AT+NUESTATS=\"THP\"");
 
     bool ret = (readResponse() == ResponseOK);
@@ -543,6 +2517,7 @@ bool SaraN200::printThroughputInfo() {
 bool SaraN200::printCellStatsInfo() {
     debugEnabled = true;
     delay(100);
+    beginCommand(CommandQuery);
     println("AT+NUESTATS=\"CELL\"");
 
     bool ret = (readResponse() == ResponseOK);
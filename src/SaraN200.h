@@ -4,10 +4,44 @@
 #include <Arduino.h>
 #include <Stream.h>
 #include "SaraN200AT.h"
+#include "SaraN200Config.h"
+#include "SaraN200Timeouts.h"
+#include "SaraN200Accounting.h"
+#include "SaraN200Ping.h"
+
+// Receives +NSORF payloads as they are decoded off the UART, so large
+// downloads can go straight to flash or a parser without a datagram buffer.
+class SaraN200RecvSink {
+public:
+    virtual ~SaraN200RecvSink() {}
+
+    // Bytes the sink accepts right now; 0 makes the driver stop issuing
+    // AT+NSORF and leave the data queued on the modem (backpressure).
+    virtual size_t capacity() = 0;
+    // Called once per NSORF response, before its payload.
+    virtual void begin(int socket, const char* fromIp, uint16_t fromPort, size_t length) {}
+    // Never receives more than the last capacity() in total per response.
+    virtual void write(const uint8_t* data, size_t size) = 0;
+    // `remaining` is the part of the datagram still queued on the modem.
+    virtual void end(size_t remaining) {}
+};
 
 class SaraN200 : public SaraN200AT {
 public:
 
+    typedef struct SignalQuality {
+        bool valid;
+        int8_t rssi;        // dBm from +CSQ, 0 when not detectable
+        uint8_t ber;        // percent x 10 from +CSQ
+        uint32_t updatedAt; // millis() of the last +CSQ
+        bool extended;      // the fields below have been read
+        int16_t rsrp;       // tenths of a dBm, NUESTATS "Signal power"
+        int16_t rsrq;       // tenths of a dB
+        int16_t snr;        // tenths of a dB
+        uint8_t ecl;        // coverage enhancement level 0..2
+        uint32_t extendedAt; // millis() of the last +NUESTATS="RADIO"
+    } SignalQuality;
+
     typedef struct NameValuePair {
         const char* Name;
         const char* Value;
@@ -15,15 +49,145 @@ public:
 
     typedef struct UdpDownlinkMesssage {
         int socket;
-        char fromIp[48];
+        char fromIp[16];
         uint16_t fromPort;
         size_t dataLength;
-        char data[512];
+        uint8_t* data; // payload is decoded straight into the caller's buffer
+        size_t dataSize;
         size_t remaining;
+        bool truncated; // the response carried more than dataSize bytes
     } UdpDownlinkMesssage;
 
+    typedef struct SocketInfo {
+        int socket; // SOCKET_FAIL when the slot is free
+        uint16_t localPort;
+        bool urcEnabled;
+        uint16_t pendingDatagrams; // announced by +NSONMI, not read yet
+        size_t partialBytes; // of the datagram being read in chunks
+        bool connected; // bound to one peer by socketConnect()
+        uint16_t peerPort;
+        char peerIp[16];
+        char sendPrefix[SARA_N200_SEND_PREFIX_SIZE]; // AT+NSOST=<socket>,"<ip>",<port>,
+    } SocketInfo;
+
+    typedef struct UdpPacket {
+        IPAddress remoteIp;
+        uint16_t remotePort;
+        uint8_t* data; // points into the buffer passed to socketRecvBatch
+        size_t length;
+        bool truncated; // the buffer ran out, the rest of the datagram was dropped
+    } UdpPacket;
+
+    typedef struct RecvBatchStats {
+        size_t packets;
+        size_t bytes;
+        size_t commands; // AT+NSORF round-trips spent on the batch
+        size_t truncated; // packets cut short by the end of the buffer
+        bool morePending; // stopped because the buffer or packet array was full
+    } RecvBatchStats;
+
+    // Where connect()/autoconnect() spent their time, in ms.
+    typedef struct BootTimings {
+        uint32_t detect;    // AT probing until the module answered
+        uint8_t probes;     // AT probes sent
+        uint32_t configure; // radio off and NCONFIG check
+        uint32_t reboot;    // AT+NRB until the boot banner
+        uint32_t attach;    // context, radio on and network attach
+        uint32_t total;
+        bool rebooted;      // NCONFIG had to change, the module was rebooted
+        uint32_t hintedAttach; // part of attach spent on the last known good network
+        bool hinted;        // attached on the last known good network
+    } BootTimings;
+
+    // Where the module last found service; see setNetworkHint().
+    typedef struct NetworkHint {
+        bool valid;
+        uint8_t band;    // 0 when unknown
+        char plmn[7];    // MCC and MNC, empty for automatic selection
+        uint32_t earfcn; // downlink EARFCN, 0 when unknown
+        int16_t pci;     // physical cell id, -1 when unknown
+        // AT+NBAND? from before the first band lock, restored for a full
+        // search: the lock stays in the module's NVM
+        uint8_t searchBands[SARA_N200_MAX_BANDS];
+        uint8_t searchBandCount;
+    } NetworkHint;
+
+    typedef struct AttachAttempt {
+        uint32_t duration; // ms
+        bool hinted;       // on the last known good network, not a full search
+        bool success;
+    } AttachAttempt;
+
+    typedef enum {
+        TimeSourceNone = 0,
+        TimeSourceClock,  // AT+CCLK?
+        TimeSourceNitz,   // +CTZEU URC
+        TimeSourceSntp,
+    } TimeSource;
+
+    typedef enum {
+        ErrorNone = 0,
+        ErrorGeneric, // plain ERROR, or a code in text form
+        ErrorCme,     // +CME ERROR: <code>
+        ErrorCms,     // +CMS ERROR: <code>
+        ErrorTimeout,
+        ErrorNotRegistered, // refused without a command, see setRegistrationUrcEnabled()
+    } ErrorType;
+
+    typedef struct ModemError {
+        ErrorType type;
+        uint16_t code; // for ErrorCme and ErrorCms
+    } ModemError;
+
+    // What a failed command calls for, see getRetryAction().
+    typedef enum {
+        RetryGiveUp = 0,     // the command cannot succeed as it is
+        RetryImmediately,    // transient, e.g. an aborted command
+        RetryWithBackoff,    // busy or not ready, try again later
+        RetryRecreateSocket, // the socket is gone on the module
+        RetryReattach,       // no network service or PDP context
+    } RetryAction;
+
+    typedef struct RetryRule {
+        uint16_t code; // +CME ERROR code
+        RetryAction action;
+    } RetryRule;
+
+    // <stat> of +CEREG.
+    typedef enum {
+        RegistrationNotSearching = 0,
+        RegistrationHome = 1,
+        RegistrationSearching = 2,
+        RegistrationDenied = 3,
+        RegistrationUnknown = 4,
+        RegistrationRoaming = 5,
+    } RegistrationStatus;
+
+    typedef enum {
+        RegistrationChangeStatus = 0x01,
+        RegistrationChangeCell = 0x02,   // TAC, cell id or access technology
+        RegistrationChangeTimers = 0x04, // PSM timers
+    } RegistrationChange;
+
+    typedef struct RegistrationState {
+        bool valid;               // a +CEREG has been seen
+        RegistrationStatus status;
+        uint16_t tac;             // tracking area code, kept from the last cell
+        uint32_t cellId;          // E-UTRAN cell id, kept from the last cell
+        int8_t accessTechnology;  // <AcT>, 9 for NB-IoT, -1 when unknown
+        int32_t activeTime;       // T3324 in s, -1 when not granted or unknown
+        int32_t periodicTau;      // T3412 extended in s, -1 likewise
+        uint32_t changedAt;       // millis() of the last status change
+    } RegistrationState;
+
+    // `changes` is a mask of RegistrationChange.
+    typedef void (*RegistrationCallback)(const RegistrationState& state, uint8_t changes, void* context);
+
+    // `result` is the length the module accepted, or -1 on ERROR/timeout.
+    typedef void (*SendResultCallback)(uint32_t ticket, int socket, int result, void* context);
+
     SaraN200();
-    virtual ~SaraN200() {}
+    virtual ~SaraN200();
 
     typedef ResponseType(*CallbackMethodPtr)(ResponseType& response, const char* buffer, size_t size, void* param, void* param2);
 
@@ -31,40 +195,281 @@ public:
     bool setRadioActive(bool on);
     bool isAlive();
     virtual uint32_t getDefaultBaudrate();
-    bool autoconnect();
-    bool createContext(const char* apn);
+    bool autoconnect(bool turnOffRadioFirst = false);
+    // `nonIp` creates a NONIP context for nonIpSend()/nonIpRecv().
+    bool createContext(const char* apn, bool nonIp = false);
+    // AT+CGATT=1, retried as the retry policy allows until `timeout`.
+    bool attach(uint32_t timeout = 30 * 1000) { return attachGprs(timeout); }
     bool connect(const char* apn, bool noAutoconnect = true);
     bool disconnect();
     bool isConnected();
+    // Served from the signal quality cache while it is younger than the TTL.
     bool getRSSIAndBER(int8_t* rssi, uint8_t* ber);
+    // Last cached values without any AT traffic; false when nothing is cached.
+    bool getSignalQuality(SignalQuality* quality, uint32_t* age = NULL) const;
+    bool refreshSignalQuality(bool extended = true);
+    void setSignalQualityTtl(uint32_t ttl) { signalQualityTtl = ttl; }
+    // poll() refreshes the cache once it is older than `interval`, 0 disables.
+    void setSignalRefreshInterval(uint32_t interval) { signalRefreshInterval = interval; }
     int8_t convertCSQ2RSSI(uint8_t csq) const;
     uint8_t convertRSSI2CSQ(int8_t rssi) const;
 
     int createSocket(uint16_t localPort = 42000, bool enableURC = false);
     int socketSendTo(int socket, IPAddress ip, uint16_t port, uint8_t* buffer, size_t size);
-    int socketRecvFrom(int socket, uint8_t* buffer, size_t size);
+    // Writes the AT+NSOST and returns a ticket without waiting for the
+    // result, or 0 when it could not be sent at all. Results are collected
+    // by poll() and before the next command and reported through the send
+    // result callback. Waits for the oldest result once
+    // SARA_N200_MAX_PENDING_SENDS are in flight.
+    uint32_t socketSendToAsync(int socket, IPAddress ip, uint16_t port, const uint8_t* buffer, size_t size);
+    void setSendResultCallback(SendResultCallback callback, void* context = NULL);
+    size_t getPendingSends() const { return pendingSendCount; }
+    // Waits for every pending send, returns false when any of them failed.
+    bool flushSends();
+    // Binds `socket` to one peer: the AT+NSOST prefix is formatted once for
+    // socketSend(), and socketRecvFrom() drops datagrams from anyone else.
+    // Local only, the module has no connected UDP sockets.
+    bool socketConnect(int socket, IPAddress ip, uint16_t port);
+    void socketDisconnect(int socket);
+    int socketSend(int socket, const uint8_t* buffer, size_t size);
+    uint32_t socketSendAsync(int socket, const uint8_t* buffer, size_t size);
+    // Reads one whole datagram, over as many AT+NSORF as it takes. A datagram
+    // longer than `size` is cut there and its tail dropped. `remoteIp` and
+    // `remotePort`, when given, are set to the sender.
+    int socketRecvFrom(int socket, uint8_t* buffer, size_t size, IPAddress* remoteIp = NULL, uint16_t* remotePort = NULL);
+    // Reads pending datagrams into `buffer` back to back. A datagram the
+    // buffer has no room left for is cut short and flagged, like recvfrom()
+    // would, so the next call still starts on a datagram boundary.
+    int socketRecvBatch(int socket, uint8_t* buffer, size_t size, UdpPacket* packets, size_t maxPackets, RecvBatchStats* stats = NULL);
+    uint16_t getPendingDatagrams(int socket);
+    // Drains pending downlink data into `sink`, returns the bytes delivered or -1.
+    // `maxBytes` of 0 means until the modem queue is empty or the sink is busy.
+    int socketRecvStream(int socket, SaraN200RecvSink& sink, size_t maxBytes = 0);
     bool closeSocket(int socket);
+    size_t getSocketCount() const { return socketCount; }
+
+    // Non-IP data delivery (NIDD): messages carry no IP/UDP headers and go
+    // to the application server the network has configured for the APN.
+    // Needs a context from createContext(apn, true) and network support.
+    bool nonIpSend(const uint8_t* buffer, size_t size);
+    // Reads the oldest downlink message buffered by the module, returns its
+    // length (bytes past `size` are dropped), 0 when none is waiting or -1.
+    int nonIpRecv(uint8_t* buffer, size_t size);
+    // AT+NNMI=2: +NNMI announces each downlink message, which stays
+    // buffered for nonIpRecv().
+    bool setNonIpUrcEnabled(bool enabled);
+    bool isNonIpUrcEnabled() const { return nonIpUrcEnabled; }
+    // Announced by +NNMI and not read yet.
+    uint16_t getPendingNonIpMessages() const { return nonIpPending; }
 
     bool sleep();
 
+    bool getRadioStats(RadioStats* stats);
+    bool setConnectionUrcEnabled(bool enabled);
+    void setAccounting(SaraN200Accounting* accounting) { this->accounting = accounting; }
+    SaraN200Accounting* getAccounting() const { return accounting; }
+    // RRC state from the +CSCON URC, false until the first one arrives.
+    bool isRadioConnected() const { return radioConnected; }
+
+    // Starts AT+NPING; the result arrives as a URC and goes to the ping
+    // stats. `timeout` is the module's wait for the echo reply, in ms.
+    bool ping(IPAddress ip, uint16_t size = 12, uint32_t timeout = 10000);
+    bool isPingPending() const { return pingPending; }
+    void setPingStats(SaraN200PingStats* stats) { pingStats = stats; }
+    // poll() pings `ip` every `interval` ms, but only while the RRC
+    // connection is up anyway (needs setConnectionUrcEnabled(true)), so
+    // probing never wakes the radio. 0 disables.
+    void setPingSchedule(IPAddress ip, uint32_t interval);
+
+    const BootTimings& getBootTimings() const { return bootTimings; }
+
+    // AT+NBAND: the bands searched for service. Needs the radio off
+    // (setRadioActive(false)) and stays in the module's NVM.
+    bool setBands(const uint8_t* bands, size_t count);
+    // Returns the number of bands copied to `bands`, 0 on failure.
+    size_t getBands(uint8_t* bands, size_t maxBands);
+    // AT+COPS=1: registers on `plmn` (MCC and MNC, e.g. "26201") only.
+    // NULL goes back to automatic selection. Blocks until the module has
+    // registered or given up, at most `timeout` ms.
+    bool selectOperator(const char* plmn, uint32_t timeout = 30 * 1000);
+    // The PLMN the module is registered on, false when there is none.
+    bool getOperator(char* plmn, size_t size);
+    // AT+NEARFCN: searches `earfcn` first, optionally for cell `pci`. Needs
+    // the radio off; 0 clears the hint. Fails on firmware without it.
+    bool setEarfcnHint(uint32_t earfcn, int16_t pci = -1);
+    // The band a downlink EARFCN belongs to, 0 when unknown.
+    static uint8_t getBandForEarfcn(uint32_t earfcn);
+
+    // Last known good network. connect() and autoconnect() lock the band,
+    // PLMN and EARFCN to it before searching, and fall back to a full
+    // search when that gets no service within the hint timeout. Once
+    // attached the locks are undone again, which takes the radio off and on
+    // once more. It is refreshed after every successful attach; store it
+    // with the application's state to keep it across power cycles.
+    const NetworkHint& getNetworkHint() const { return networkHint; }
+    void setNetworkHint(const NetworkHint& hint) { networkHint = hint; }
+    void clearNetworkHint() { networkHint.valid = false; }
+    void setNetworkHintEnabled(bool enabled) { networkHintEnabled = enabled; }
+    void setNetworkHintTimeout(uint32_t timeout) { networkHintTimeout = timeout; }
+    // Copies the latest attach attempts, oldest first, and returns how
+    // many there were.
+    size_t getAttachAttempts(AttachAttempt* attempts, size_t maxAttempts) const;
+
+    // AT+CMEE=1: failures come as +CME ERROR: <code> instead of a bare
+    // ERROR. Sent after every detection and reboot.
+    bool setErrorCodesEnabled(bool enabled);
+    // Why the last command failed; ErrorNone after a success. Read it
+    // right after the failed call, or inside the send result callback.
+    const ModemError& getLastError() const { return lastError; }
+    // What the retry policy says about the last error, or about `error`.
+    // Rules from setRetryRules() are checked before the built-in table;
+    // codes in neither, plain ERRORs and timeouts get RetryWithBackoff.
+    RetryAction getRetryAction() const { return getRetryAction(lastError); }
+    RetryAction getRetryAction(const ModemError& error) const;
+    void setRetryRules(const RetryRule* rules, size_t count) { retryRules = rules; retryRuleCount = count; }
+
+    // AT+CEREG=2, or 4 to include the PSM timers: the module reports every
+    // registration and cell change, which keeps getRegistration() current
+    // without polling AT+CGATT?. While it reports no service, sends fail
+    // at once with ErrorNotRegistered instead of going to the module.
+    // Sent again after every detection and reboot.
+    bool setRegistrationUrcEnabled(bool enabled, bool psmTimers = true);
+    // AT+CEREG?, for the state before the first URC.
+    bool refreshRegistration();
+    const RegistrationState& getRegistration() const { return registration; }
+    // Registered on the home network or roaming, per the last +CEREG.
+    bool isRegistered() const { return registration.valid && (registration.status == RegistrationHome || registration.status == RegistrationRoaming); }
+    // Called as the +CEREG URCs arrive, also in the middle of other
+    // commands, so it must not send AT commands itself.
+    void setRegistrationCallback(RegistrationCallback callback, void* context = NULL) { registrationCallback = callback; registrationContext = context; }
+
+    // Reads the network time (NITZ) the module keeps with AT+CCLK?. Fails
+    // until the network has sent it. connect() and autoconnect() call it
+    // once attached.
+    bool syncNetworkTime();
+    // AT+CTZR=2: +CTZEU reports time zone changes with the UTC time, which
+    // then updates the clock without any command.
+    bool setTimeZoneUrcEnabled(bool enabled);
+    // Minimal SNTP exchange for networks that never send NITZ. Only a reply
+    // from `server` port 123 that echoes the request's transmit timestamp
+    // sets the clock.
+    bool syncTimeSntp(IPAddress server, uint32_t timeout = 5000, uint16_t localPort = 42123);
+    // Network time first, SNTP only when the network has none.
+    bool syncTime(IPAddress sntpServer);
+    // UTC seconds since 1970, kept from the last sync as an offset to
+    // millis(). False until a sync succeeded.
+    bool getTime(uint32_t* epoch) const;
+    TimeSource getTimeSource() const { return timeSource; }
+    // Local time zone in minutes east of UTC, daylight saving included.
+    int16_t getTimeZone() const { return timeZone; }
+
+    // ATE0/ATE1. Enabling echo also turns echo management off.
+    bool setEchoEnabled(bool enabled);
+    // When on (the default) echo is turned off once the module is detected
+    // and after every reboot, and an echoed command seen later triggers
+    // another ATE0 before the next command.
+    void setEchoManagement(bool enabled) { echoManaged = enabled; echoPending = echoPending && enabled; }
+    // Command echoes received and discarded so far.
+    uint32_t getEchoCount() const { return echoCount; }
+
     bool printThroughputInfo();
     bool printCellStatsInfo();
 
+    // Per-command timeouts; setAdaptive(true) learns them from response times.
+    SaraN200Timeouts& getTimeouts() { return timeouts; }
+
+    // Reads whatever the modem sent unsolicited and dispatches the URCs.
+    void poll();
+
 protected:
-    ResponseType readResponse(char* buffer, size_t size, size_t* outSize, uint32_t timeout = 5000) {
+    SocketInfo* sockets;
+    size_t socketCount;
+    bool isSocketTableOwned;
+
+    SaraN200Timeouts timeouts;
+    CommandClass commandClass;
+    SaraN200Accounting* accounting;
+    bool radioConnected;
+
+    SaraN200PingStats* pingStats;
+    bool pingPending;
+    uint32_t pingSentAt;
+    uint32_t pingTimeout;
+    IPAddress pingTarget;
+    uint32_t pingInterval;
+    uint32_t lastPingAt;
+
+    SignalQuality signalQuality;
+    uint32_t signalQualityTtl;
+    uint32_t signalRefreshInterval;
+
+    BootTimings bootTimings;
+
+    NetworkHint networkHint;
+    bool networkHintEnabled;
+    uint32_t networkHintTimeout;
+    AttachAttempt attachAttempts[SARA_N200_ATTACH_HISTORY];
+    size_t attachAttemptCount;
+
+    TimeSource timeSource;
+    uint32_t timeEpoch;   // UTC seconds at timeEpochAt
+    uint32_t timeEpochAt; // millis()
+    int16_t timeZone;
+
+    typedef struct PendingSend {
+        uint32_t ticket;
+        int socket;
+    } PendingSend;
+
+    PendingSend pendingSends[SARA_N200_MAX_PENDING_SENDS];
+    size_t pendingSendHead;
+    size_t pendingSendCount;
+    uint32_t nextTicket;
+    SendResultCallback sendResultCallback;
+    void* sendResultContext;
+
+    bool nonIpUrcEnabled;
+    uint16_t nonIpPending;
+
+    ModemError lastError;
+    const RetryRule* retryRules;
+    size_t retryRuleCount;
+
+    RegistrationState registration;
+    uint8_t registrationMode;  // <n> of AT+CEREG, 0 when off
+    bool registrationQuery;    // AT+CEREG? is running, its +CEREG has <n> first
+    RegistrationCallback registrationCallback;
+    void* registrationContext;
+
+    bool echoManaged;
+    bool echoPending; // echo was seen, send ATE0 before the next command
+    uint32_t echoCount;
+
+    void beginCommand(CommandClass commandClass);
+
+    // used by SaraN200Static to hand over storage that lives inside the
+    // object; without it init() allocates both
+    SaraN200(char* inputBuffer, size_t inputBufferSize, SocketInfo* sockets, size_t socketCount);
+
+    SocketInfo* findSocket(int socket);
+
+    // Returns true when `line` was an unsolicited result code and has been consumed.
+    virtual bool handleUrc(const char* line);
+
+    ResponseType readResponse(char* buffer, size_t size, size_t* outSize, uint32_t timeout = SARA_N200_TIMEOUT_AUTO) {
         return readResponse(inputBuffer, inputBufferSize, NULL, NULL, NULL, outSize, timeout);
     };
 
     ResponseType readResponse(char* buffer, size_t size,
                                CallbackMethodPtr parserMethod, void* callbackParameter, void* callbackParameter2 = NULL,
-                               size_t* outSize = NULL, uint32_t timeout = 5000);
+                               size_t* outSize = NULL, uint32_t timeout = SARA_N200_TIMEOUT_AUTO);
 
-    ResponseType readResponse(size_t* outSize = NULL, uint32_t timeout = 5000) {
+    ResponseType readResponse(size_t* outSize = NULL, uint32_t timeout = SARA_N200_TIMEOUT_AUTO) {
         return readResponse(inputBuffer, inputBufferSize, NULL, NULL, NULL, outSize, timeout);
     };
 
     ResponseType readResponse(CallbackMethodPtr parserMethod, void* callbackParameter,
-                               void* callbackParameter2 = NULL, size_t* outSize = NULL, uint32_t timeout = 5000) {
+                               void* callbackParameter2 = NULL, size_t* outSize = NULL, uint32_t timeout = SARA_N200_TIMEOUT_AUTO) {
         return readResponse(inputBuffer, inputBufferSize,
                             parserMethod, callbackParameter, callbackParameter2,
                             outSize, timeout);
@@ -73,7 +478,7 @@ protected:
     template<typename T1, typename T2>
     ResponseType readResponse(ResponseType(*parserMethod)(ResponseType& response, const char* parseBuffer, size_t size, T1* parameter, T2* parameter2),
                                T1* callbackParameter, T2* callbackParameter2,
-                               size_t* outSize = NULL, uint32_t timeout = 5000)
+                               size_t* outSize = NULL, uint32_t timeout = SARA_N200_TIMEOUT_AUTO)
     {
         return readResponse(inputBuffer, inputBufferSize, (CallbackMethodPtr)parserMethod,
                             (void*)callbackParameter, (void*)callbackParameter2, outSize, timeout);
@@ -81,19 +486,80 @@ protected:
 
 private:
     static bool startsWith(const char* pre, const char* str);
+    void discardEcho(const char* line);
+    void recordError(const char* line);
+    bool sendBlocked();
+    void updateRegistration(const char* fields);
+    static size_t formatSendPrefix(char* prefix, int socket, const char* ip, uint16_t port);
+    static void formatIp(char* out, IPAddress ip);
+    void writeHex(const uint8_t* buffer, size_t size);
+    void writeSendCommand(const char* prefix, const uint8_t* buffer, size_t size);
+    int sendCommand(const char* prefix, int socket, const uint8_t* buffer, size_t size);
+    uint32_t sendCommandAsync(const char* prefix, int socket, const uint8_t* buffer, size_t size);
+    bool reapSend();
+    // The UART half of poll(): URCs and async send results, no periodic work.
+    void pollUrcs();
     bool waitForSignalQuality(uint32_t timeout = 30 * 1000);
+    bool querySignalQuality();
     bool waitForGprs(uint32_t timeout = 30 * 1000);
     bool attachGprs(uint32_t timeout = 30 * 1000);
     bool setConfigParam(const char* param, const char* value);
-    bool checkAndApplyNconfig(bool forceNoAutoconnect = false);
-    void reboot();
+    bool checkAndApplyNconfig(bool forceNoAutoconnect = false, bool* changed = NULL);
+    bool reboot();
+    static bool parseClock(const char* text, uint32_t* epoch, int* quarters);
+    void setTime(uint32_t epoch, uint32_t at, TimeSource source);
+    bool detect();
+    void resetSockets();
+    bool connectPhases(const char* apn, bool noAutoconnect);
+    bool autoconnectPhases(bool turnOffRadioFirst);
+    bool attachHinted(bool automatic);
+    // Restores the search bands and clears the EARFCN hint; needs the radio
+    // off.
+    void unlockNetwork(bool bandLocked, bool earfcnLocked);
+    void addAttachAttempt(uint32_t duration, bool hinted, bool success);
+    void rememberNetwork();
+    size_t getMaxRecvChunk(size_t size) const;
+    bool recvChunk(int socket, uint8_t* buffer, size_t size, UdpDownlinkMesssage* downlink);
+    int recvStreamChunk(int socket, SaraN200RecvSink& sink, size_t length, size_t* remaining);
+    int recvStreamDatagram(char first, int socket, SaraN200RecvSink& sink, size_t* remaining);
+    // Books an AT+NSORF chunk; a datagram counts once, with its full length,
+    // when its last chunk is in.
+    void chunkReceived(int socket, size_t length, size_t remaining);
+    // Reads and drops the `remaining` bytes of a datagram, returns the AT+NSORF sent.
+    size_t discardDatagram(int socket, size_t remaining);
+    int recvNonIpMessage(char first, uint8_t* buffer, size_t size);
+    ResponseType finishLine(char first);
 
     static ResponseType cgAttParser(ResponseType& response, const char* buffer, size_t size, uint8_t* result, uint8_t* unused);
+    static ResponseType radioStatsParser(ResponseType& response, const char* buffer, size_t size, RadioStats* stats, uint8_t* unused);
     static ResponseType csqParser(ResponseType& response, const char* buffer, size_t size, int* csqResult, int* berResult);
     static ResponseType createSocketParser(ResponseType& response, const char* buffer, size_t size, int* socketFd, int* unused);
     static ResponseType socketSendToParser(ResponseType& response, const char* buffer, size_t size, int* socketFd, int* length);
     static ResponseType checkAndApplyNconfigParser(ResponseType& response, const char* buffer, size_t size, bool* result, uint8_t* unused);
+    static ResponseType bandParser(ResponseType& response, const char* buffer, size_t size, uint8_t* bands, size_t* count);
+    static ResponseType operatorParser(ResponseType& response, const char* buffer, size_t size, char* plmn, size_t* plmnSize);
+    static ResponseType clockParser(ResponseType& response, const char* buffer, size_t size, uint32_t* epoch, int* quarters);
     static ResponseType socketRecvFromParser(ResponseType& response, const char* buffer, size_t size, UdpDownlinkMesssage* result, bool* indicator);
 };
 
+// SaraN200 with the input buffer and the socket table stored inside the
+// object, so the driver never touches the heap.
+template<size_t InputBufferSize = SARA_N200_INPUT_BUFFER_SIZE, size_t SocketCount = SARA_N200_SOCKET_COUNT>
+class SaraN200Static : public SaraN200 {
+public:
+    static_assert(InputBufferSize >= 32, "SARA-N200: input buffer is too small for modem responses");
+    static_assert(SocketCount >= 1 && SocketCount <= 7, "SARA-N200: the module supports 1 to 7 sockets");
+
+    static const size_t InputBufferBytes = InputBufferSize;
+    static const size_t SocketTableBytes = SocketCount * sizeof(SocketInfo);
+
+    SaraN200Static() : SaraN200(inputStorage, InputBufferSize, socketStorage, SocketCount) {}
+
+private:
+    char inputStorage[InputBufferSize];
+    SocketInfo socketStorage[SocketCount];
+};
+
+SARA_N200_MEMORY_REPORT(SaraN200Static<>)
+
 #endif
@@ -19,9 +19,21 @@
 SaraN200AT::SaraN200AT():
  debugStream(NULL),
  debugEnabled(false),
- inputBufferSize(250),
+ inputBufferSize(SARA_N200_INPUT_BUFFER_SIZE),
  isInputBufferInitialized(false),
- inputBuffer(0) {}
+ isInputBufferOwned(false),
+ inputBuffer(0),
+ startOn(0),
+ probeCount(0),
+ appendCommand(false),
+ commandSentAt(0),
+ lineTruncated(false) {}
+
+SaraN200AT::~SaraN200AT() {
+    if (isInputBufferOwned) {
+        free(inputBuffer);
+    }
+}
 
 void SaraN200AT::setDebugStream(Stream* debug) {
     this->debugStream = debug;
@@ -36,19 +48,20 @@ bool SaraN200AT::on() {
 
     // TODO: actually turn on the module.
 
-    bool timeout = false;
-    for (uint8_t i = 0; i < 10; i++) {
-        if (isAlive()) {
-            timeout = false;
-            break;
+    // each probe waits for the probe class timeout, which adapts to the
+    // module's response time, so probing stops as soon as it answers
+    probeCount = 0;
+    do {
+        if (probeCount < 0xFF) {
+            probeCount++;
         }
-    }
 
-    if (timeout) {
-        return false;
-    }
+        if (isAlive()) {
+            return isOn();
+        }
+    } while (millis() - startOn < SARA_N200_DETECT_TIMEOUT);
 
-    return isOn();
+    return false;
 }
 
 bool SaraN200AT::isOn() const {
@@ -61,8 +74,34 @@ bool SaraN200AT::off() {
     return !isOn();
 }
 
-void SaraN200AT::setInputBufferSize(size_t value) {
+bool SaraN200AT::setInputBufferSize(size_t value) {
+    if (isInputBufferInitialized && !isInputBufferOwned) {
+        // the buffer was supplied by the caller, its size is fixed
+        return value <= inputBufferSize;
+    }
+
+    if (isInputBufferOwned) {
+        char* resized = static_cast<char*>(realloc(inputBuffer, value));
+        if (!resized) {
+            return false;
+        }
+
+        this->inputBuffer = resized;
+    }
+
     this->inputBufferSize = value;
+    return true;
+}
+
+void SaraN200AT::setInputBuffer(char* buffer, size_t size) {
+    if (isInputBufferOwned) {
+        free(inputBuffer);
+    }
+
+    this->inputBuffer = buffer;
+    this->inputBufferSize = size;
+    this->isInputBufferOwned = false;
+    this->isInputBufferInitialized = true;
 }
 
 void SaraN200AT::setModemStream(Stream& stream) {
@@ -76,6 +115,7 @@ void SaraN200AT::setModemStream(Stream* stream) {
 void SaraN200AT::initBuffer() {
     if (!isInputBufferInitialized) {
         this->inputBuffer = static_cast<char*>(malloc(this->inputBufferSize));
+        this->isInputBufferOwned = true;
         this->isInputBufferInitialized = true;
     }
 }
@@ -137,11 +177,14 @@ size_t SaraN200AT::readBytes(uint8_t* buffer, size_t length, uint32_t timeout) {
 size_t SaraN200AT::readln(char* buffer, size_t size, uint32_t timeout) {
     size_t len = readBytesUntil(SARA_AT_DEVICE_TERMINATOR[SARA_AT_DEVICE_TERMINATOR_LEN - 1], buffer, size - 1, timeout);
 
-    if (buffer[len - 1] == '\r') {
+    // a full buffer ending in CR only misses the LF, anything else was cut
+    lineTruncated = (len == size - 1) && (buffer[len - 1] != '\r');
+
+    if (len > 0 && buffer[len - 1] == '\r') {
         len -= 1;
     }
 
-    if ((SARA_AT_DEVICE_TERMINATOR_LEN > 1) && (buffer[len - (SARA_AT_DEVICE_TERMINATOR_LEN - 1)] == SARA_AT_DEVICE_TERMINATOR[0])) {
+    if ((SARA_AT_DEVICE_TERMINATOR_LEN > 1) && (len >= SARA_AT_DEVICE_TERMINATOR_LEN - 1) && (buffer[len - (SARA_AT_DEVICE_TERMINATOR_LEN - 1)] == SARA_AT_DEVICE_TERMINATOR[0])) {
         len -= SARA_AT_DEVICE_TERMINATOR_LEN - 1;
     }
 
@@ -154,6 +197,16 @@ size_t SaraN200AT::readln() {
     return readln(inputBuffer, inputBufferSize);
 }
 
+void SaraN200AT::skipLine(uint32_t timeout) {
+    int c;
+
+    do {
+        c = timedRead(timeout);
+    } while (c >= 0 && c != SARA_AT_DEVICE_TERMINATOR[SARA_AT_DEVICE_TERMINATOR_LEN - 1]);
+
+    lineTruncated = false;
+}
+
 void SaraN200AT::writeProlog() {
     if (!appendCommand) {
         debugPrint(">> ");
@@ -299,5 +352,6 @@ size_t SaraN200AT::println(void) {
     debugPrintln("");
     size_t i = print('\r');
     appendCommand = false;
+    commandSentAt = millis();
     return i;
 }
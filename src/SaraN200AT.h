@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <stdint.h>
 #include <Stream.h>
+#include "SaraN200Config.h"
+#include "SaraN200Timeouts.h"
 
 typedef enum {
     ResponseNotFound = 0,
@@ -18,13 +20,14 @@ typedef enum {
 class SaraN200AT {
 public:
     SaraN200AT();
-    virtual ~SaraN200AT() {}
+    virtual ~SaraN200AT();
 
     void setDebugStream(Stream* debug);
     void setDebugEnabled(bool state);
     bool on();
     bool off();
-    void setInputBufferSize(size_t value);
+    bool setInputBufferSize(size_t value);
+    void setInputBuffer(char* buffer, size_t size);
 
     // implement this on the actual class
     virtual uint32_t getDefaultBaudrate() = 0;
@@ -36,17 +39,21 @@ protected:
 
     size_t inputBufferSize;
     bool isInputBufferInitialized;
+    bool isInputBufferOwned;
     char* inputBuffer;
 
     uint32_t startOn;
+    uint8_t probeCount; // AT probes sent by the last on()
     bool appendCommand;
+    uint32_t commandSentAt;
+    bool lineTruncated; // the last readln() stopped at the end of the buffer
 
     void setModemStream(Stream& stream);
     void setModemStream(Stream* stream);
 
     // implement this on the actual class
     virtual bool isAlive() = 0;
-    virtual ResponseType readResponse(char* buffer, size_t size, size_t* outSize, uint32_t timeout = 5000) = 0;
+    virtual ResponseType readResponse(char* buffer, size_t size, size_t* outSize, uint32_t timeout = SARA_N200_TIMEOUT_AUTO) = 0;
 
     bool isOn() const;
     void initBuffer();
@@ -56,6 +63,7 @@ protected:
     size_t readBytes(uint8_t* buffer, size_t length, uint32_t timeout = 1000);
     size_t readln(char* buffer, size_t size, uint32_t timeout = 1000);
     size_t readln();
+    void skipLine(uint32_t timeout = 1000);
 
     void writeProlog();
 
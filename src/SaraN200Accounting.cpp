@@ -0,0 +1,171 @@
+#include "SaraN200Accounting.h"
+
+#include <Arduino.h>
+
+#define NOW (uint32_t)millis()
+
+// Rough SARA-N2 figures from the data sheet, override with setEnergyModel().
+static const EnergyModel defaultModel = {
+    3600,                 // supplyMillivolts
+    40,                   // connectedMilliamps
+    90,                   // txMinMilliamps
+    220,                  // txMaxMilliamps
+    45,                   // rxMilliamps
+    { 20000, 2500, 300 }, // uplinkBitsPerSecond
+    { 25000, 3000, 400 }, // downlinkBitsPerSecond
+    28,                   // overheadBytes
+};
+
+SaraN200Accounting::SaraN200Accounting():
+ model(defaultModel) {
+    reset();
+}
+
+void SaraN200Accounting::reset() {
+    memset(&total, 0, sizeof(total));
+    memset(sockets, 0, sizeof(sockets));
+
+    connected = false;
+    connectedSince = 0;
+    connectedTime = 0;
+    attachTime = 0;
+    attachCount = 0;
+    attachEnergy = 0;
+
+    ecl = 0;
+    txPower = SARA_TX_POWER_UNKNOWN;
+    hasRadioStats = false;
+    lastTxTime = 0;
+    lastRxTime = 0;
+    measuredTxTime = 0;
+    measuredRxTime = 0;
+}
+
+const UsageCounters* SaraN200Accounting::getSocket(int socket) const {
+    if (socket < 0 || socket >= SARA_ACCOUNTING_SOCKETS) {
+        return NULL;
+    }
+
+    return &sockets[socket];
+}
+
+void SaraN200Accounting::onSend(int socket, size_t size, bool ipHeaders) {
+    uint32_t ms = airtime(size, model.uplinkBitsPerSecond, ecl, ipHeaders);
+    uint32_t mj = energy(model.supplyMillivolts, txMilliamps(), ms);
+
+    add(total, true, size, ms, mj);
+    if (socket >= 0 && socket < SARA_ACCOUNTING_SOCKETS) {
+        add(sockets[socket], true, size, ms, mj);
+    }
+}
+
+void SaraN200Accounting::onReceive(int socket, size_t size, bool ipHeaders) {
+    uint32_t ms = airtime(size, model.downlinkBitsPerSecond, ecl, ipHeaders);
+    uint32_t mj = energy(model.supplyMillivolts, model.rxMilliamps, ms);
+
+    add(total, false, size, ms, mj);
+    if (socket >= 0 && socket < SARA_ACCOUNTING_SOCKETS) {
+        add(sockets[socket], false, size, ms, mj);
+    }
+}
+
+void SaraN200Accounting::onAttach(uint32_t duration, bool attached) {
+    attachTime += duration;
+    attachEnergy += energy(model.supplyMillivolts, model.connectedMilliamps, duration);
+
+    if (attached) {
+        attachCount++;
+    }
+}
+
+void SaraN200Accounting::onConnectionState(bool connected) {
+    if (connected == this->connected) {
+        return;
+    }
+
+    if (connected) {
+        connectedSince = NOW;
+    } else {
+        connectedTime += NOW - connectedSince;
+    }
+
+    this->connected = connected;
+}
+
+void SaraN200Accounting::onRadioStats(const RadioStats& stats) {
+    ecl = (stats.ecl <= 2) ? stats.ecl : 2;
+
+    if (stats.txPower != SARA_TX_POWER_UNKNOWN) {
+        txPower = stats.txPower;
+    }
+
+    // the module counters restart with it, ignore a step backwards
+    if (hasRadioStats && stats.txTime >= lastTxTime && stats.rxTime >= lastRxTime) {
+        measuredTxTime += stats.txTime - lastTxTime;
+        measuredRxTime += stats.rxTime - lastRxTime;
+    }
+
+    lastTxTime = stats.txTime;
+    lastRxTime = stats.rxTime;
+    hasRadioStats = true;
+}
+
+uint32_t SaraN200Accounting::getConnectedTime() const {
+    if (connected) {
+        return connectedTime + (NOW - connectedSince);
+    }
+
+    return connectedTime;
+}
+
+uint32_t SaraN200Accounting::getEnergy() const {
+    // traffic airtime is already paid at the TX/RX current
+    uint32_t airtime = total.txAirtime + total.rxAirtime;
+    uint32_t connectedMs = getConnectedTime();
+    uint32_t idle = (connectedMs > airtime) ? (connectedMs - airtime) : 0;
+
+    return total.energy + attachEnergy + energy(model.supplyMillivolts, model.connectedMilliamps, idle);
+}
+
+uint32_t SaraN200Accounting::estimateSendEnergy(size_t size, uint8_t coverageClass) const {
+    uint32_t ms = airtime(size, model.uplinkBitsPerSecond, (coverageClass <= 2) ? coverageClass : 2);
+
+    return energy(model.supplyMillivolts, txMilliamps(), ms);
+}
+
+uint32_t SaraN200Accounting::airtime(size_t size, const uint16_t* bitsPerSecond, uint8_t coverageClass, bool ipHeaders) const {
+    uint32_t bits = 8UL * (ipHeaders ? size + model.overheadBytes : size);
+
+    return (bits * 1000UL) / bitsPerSecond[coverageClass];
+}
+
+uint16_t SaraN200Accounting::txMilliamps() const {
+    if (txPower == SARA_TX_POWER_UNKNOWN || txPower >= 230) {
+        return model.txMaxMilliamps;
+    }
+
+    if (txPower <= 0) {
+        return model.txMinMilliamps;
+    }
+
+    return model.txMinMilliamps + (static_cast<uint32_t>(model.txMaxMilliamps - model.txMinMilliamps) * txPower) / 230;
+}
+
+uint32_t SaraN200Accounting::energy(uint16_t millivolts, uint16_t milliamps, uint32_t ms) {
+    // mV * mA * ms = nJ
+    return static_cast<uint32_t>((static_cast<uint64_t>(millivolts) * milliamps * ms) / 1000000ULL);
+}
+
+void SaraN200Accounting::add(UsageCounters& counters, bool sent, size_t size, uint32_t airtime, uint32_t energy) {
+    if (sent) {
+        counters.bytesSent += size;
+        counters.datagramsSent++;
+        counters.txAirtime += airtime;
+    } else {
+        counters.bytesReceived += size;
+        counters.datagramsReceived++;
+        counters.rxAirtime += airtime;
+    }
+
+    counters.energy += energy;
+}
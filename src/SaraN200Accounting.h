@@ -0,0 +1,117 @@
+#ifndef SARA_N200_ACCOUNTING_H
+#define SARA_N200_ACCOUNTING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Socket ids handed out by AT+NSOCR are 0..6.
+#define SARA_ACCOUNTING_SOCKETS 7
+
+// +NUESTATS="RADIO" values. Powers are in tenths of a dBm as reported by
+// the module, times in ms since its boot.
+typedef struct RadioStats {
+    int16_t signalPower;
+    int16_t totalPower;
+    int16_t txPower;
+    uint32_t txTime;
+    uint32_t rxTime;
+    uint32_t cellId;
+    uint8_t ecl;
+    int16_t snr;
+    uint32_t earfcn;
+    uint16_t pci;
+    int16_t rsrq;
+} RadioStats;
+
+#define SARA_TX_POWER_UNKNOWN -32768
+
+typedef struct EnergyModel {
+    uint16_t supplyMillivolts;
+    uint16_t connectedMilliamps;     // RRC connected, not transmitting
+    uint16_t txMinMilliamps;         // transmitting at 0 dBm and below
+    uint16_t txMaxMilliamps;         // transmitting at 23 dBm
+    uint16_t rxMilliamps;
+    // effective application throughput per coverage class (ECL 0, 1, 2),
+    // repetitions included
+    uint16_t uplinkBitsPerSecond[3];
+    uint16_t downlinkBitsPerSecond[3];
+    uint8_t overheadBytes;           // IP + UDP headers per datagram
+} EnergyModel;
+
+typedef struct UsageCounters {
+    uint32_t bytesSent;
+    uint32_t bytesReceived;
+    uint32_t datagramsSent;
+    uint32_t datagramsReceived;
+    uint32_t txAirtime; // ms, estimated from the energy model
+    uint32_t rxAirtime; // ms, estimated from the energy model
+    uint32_t energy;    // mJ attributed to the traffic
+} UsageCounters;
+
+// Follows every send, receive and attach of a SaraN200 (see
+// SaraN200::setAccounting) and turns them into airtime and energy estimates,
+// per socket and cumulative. Connected-state time comes from +CSCON, coverage
+// class and TX power from +NUESTATS="RADIO".
+class SaraN200Accounting {
+public:
+    SaraN200Accounting();
+
+    void setEnergyModel(const EnergyModel& model) { this->model = model; }
+    const EnergyModel& getEnergyModel() const { return model; }
+
+    // `ipHeaders` is false for non-IP (NIDD) messages, which carry no
+    // IP/UDP headers over the air.
+    void onSend(int socket, size_t size, bool ipHeaders = true);
+    void onReceive(int socket, size_t size, bool ipHeaders = true);
+    void onAttach(uint32_t duration, bool attached);
+    void onConnectionState(bool connected);
+    void onRadioStats(const RadioStats& stats);
+
+    const UsageCounters& getTotal() const { return total; }
+    const UsageCounters* getSocket(int socket) const;
+
+    // RRC connected time in ms, including the current connection.
+    uint32_t getConnectedTime() const;
+    uint32_t getAttachTime() const { return attachTime; }
+    uint32_t getAttachCount() const { return attachCount; }
+    // Traffic and attach energy plus the connected-state baseline, in mJ.
+    uint32_t getEnergy() const;
+    // Airtime reported by the module itself, when NUESTATS has been read twice.
+    uint32_t getMeasuredTxTime() const { return measuredTxTime; }
+    uint32_t getMeasuredRxTime() const { return measuredRxTime; }
+
+    // What sending `size` bytes at `coverageClass` would cost, in mJ.
+    uint32_t estimateSendEnergy(size_t size, uint8_t coverageClass) const;
+
+    uint8_t getCoverageClass() const { return ecl; }
+    int16_t getTxPower() const { return txPower; }
+
+    void reset();
+
+private:
+    EnergyModel model;
+    UsageCounters total;
+    UsageCounters sockets[SARA_ACCOUNTING_SOCKETS];
+
+    bool connected;
+    uint32_t connectedSince;
+    uint32_t connectedTime;
+    uint32_t attachTime;
+    uint32_t attachCount;
+    uint32_t attachEnergy;
+
+    uint8_t ecl;
+    int16_t txPower;
+    bool hasRadioStats;
+    uint32_t lastTxTime;
+    uint32_t lastRxTime;
+    uint32_t measuredTxTime;
+    uint32_t measuredRxTime;
+
+    uint32_t airtime(size_t size, const uint16_t* bitsPerSecond, uint8_t coverageClass, bool ipHeaders = true) const;
+    uint16_t txMilliamps() const;
+    static uint32_t energy(uint16_t millivolts, uint16_t milliamps, uint32_t ms);
+    void add(UsageCounters& counters, bool sent, size_t size, uint32_t airtime, uint32_t energy);
+};
+
+#endif
@@ -0,0 +1,525 @@
+#include "SaraN200Cbor.h"
+
+#include <string.h>
+
+#define MAJOR_SHIFT 5
+#define INFO_MASK 0x1F
+
+#define INFO_ONE_BYTE 24
+#define INFO_TWO_BYTES 25
+#define INFO_FOUR_BYTES 26
+#define INFO_EIGHT_BYTES 27
+
+#define SIMPLE_FALSE 20
+#define SIMPLE_TRUE 21
+#define SIMPLE_NULL 22
+
+static uint16_t floatToHalf(float value, bool* exact) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF);
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    *exact = false;
+
+    if (exponent == 0xFF) {
+        // infinity stays exact, NaN payloads are not kept
+        *exact = (mantissa == 0);
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+
+    if (exponent == 0 && mantissa == 0) {
+        *exact = true;
+        return sign;
+    }
+
+    exponent = exponent - 127 + 15;
+
+    if (exponent >= 0x1F) {
+        return 0;
+    }
+
+    if (exponent <= 0) {
+        // subnormal half: the implicit bit joins the mantissa
+        if (exponent < -10) {
+            return 0;
+        }
+
+        uint32_t full = mantissa | 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        *exact = (full & ((1UL << shift) - 1)) == 0;
+        return sign | static_cast<uint16_t>(full >> shift);
+    }
+
+    *exact = (mantissa & 0x1FFF) == 0;
+    return sign | static_cast<uint16_t>(exponent << 10) | static_cast<uint16_t>(mantissa >> 13);
+}
+
+static float halfToFloat(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // normalise the subnormal
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+SaraN200CborWriter::SaraN200CborWriter(uint8_t* buffer, size_t size):
+ buffer(buffer),
+ size(size),
+ length(0),
+ overflow(false) {
+}
+
+bool SaraN200CborWriter::reserve(size_t count) {
+    if (overflow || count > size - length) {
+        overflow = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool SaraN200CborWriter::writeHead(uint8_t major, uint32_t argument) {
+    size_t headSize = saraN200CborHeadSize(argument);
+    if (!reserve(headSize)) {
+        return false;
+    }
+
+    uint8_t* out = buffer + length;
+    major <<= MAJOR_SHIFT;
+
+    switch (headSize) {
+    case 1:
+        out[0] = major | static_cast<uint8_t>(argument);
+        break;
+    case 2:
+        out[0] = major | INFO_ONE_BYTE;
+        out[1] = static_cast<uint8_t>(argument);
+        break;
+    case 3:
+        out[0] = major | INFO_TWO_BYTES;
+        out[1] = static_cast<uint8_t>(argument >> 8);
+        out[2] = static_cast<uint8_t>(argument);
+        break;
+    default:
+        out[0] = major | INFO_FOUR_BYTES;
+        out[1] = static_cast<uint8_t>(argument >> 24);
+        out[2] = static_cast<uint8_t>(argument >> 16);
+        out[3] = static_cast<uint8_t>(argument >> 8);
+        out[4] = static_cast<uint8_t>(argument);
+        break;
+    }
+
+    length += headSize;
+    return true;
+}
+
+bool SaraN200CborWriter::writeUint(uint32_t value) {
+    return writeHead(CborUnsigned, value);
+}
+
+bool SaraN200CborWriter::writeInt(int32_t value) {
+    if (value >= 0) {
+        return writeHead(CborUnsigned, static_cast<uint32_t>(value));
+    }
+
+    // -1 - n without overflowing on INT32_MIN
+    return writeHead(CborNegative, static_cast<uint32_t>(-(value + 1)));
+}
+
+bool SaraN200CborWriter::writeFloat(float value) {
+    bool exact;
+    uint16_t half = floatToHalf(value, &exact);
+
+    if (exact) {
+        if (!reserve(3)) {
+            return false;
+        }
+
+        buffer[length++] = (CborSimple << MAJOR_SHIFT) | INFO_TWO_BYTES;
+        buffer[length++] = static_cast<uint8_t>(half >> 8);
+        buffer[length++] = static_cast<uint8_t>(half);
+        return true;
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (!reserve(5)) {
+        return false;
+    }
+
+    buffer[length++] = (CborSimple << MAJOR_SHIFT) | INFO_FOUR_BYTES;
+    buffer[length++] = static_cast<uint8_t>(bits >> 24);
+    buffer[length++] = static_cast<uint8_t>(bits >> 16);
+    buffer[length++] = static_cast<uint8_t>(bits >> 8);
+    buffer[length++] = static_cast<uint8_t>(bits);
+    return true;
+}
+
+bool SaraN200CborWriter::writeBool(bool value) {
+    return writeHead(CborSimple, value ? SIMPLE_TRUE : SIMPLE_FALSE);
+}
+
+bool SaraN200CborWriter::writeNull() {
+    return writeHead(CborSimple, SIMPLE_NULL);
+}
+
+bool SaraN200CborWriter::writeBytes(const uint8_t* data, size_t size) {
+    if (!reserve(saraN200CborHeadSize(size) + size)) {
+        return false;
+    }
+
+    writeHead(CborBytes, size);
+    memcpy(buffer + length, data, size);
+    length += size;
+    return true;
+}
+
+bool SaraN200CborWriter::writeText(const char* text) {
+    return writeText(text, strlen(text));
+}
+
+bool SaraN200CborWriter::writeText(const char* text, size_t size) {
+    if (!reserve(saraN200CborHeadSize(size) + size)) {
+        return false;
+    }
+
+    writeHead(CborText, size);
+    memcpy(buffer + length, text, size);
+    length += size;
+    return true;
+}
+
+bool SaraN200CborWriter::writeArray(uint32_t count) {
+    return writeHead(CborArray, count);
+}
+
+bool SaraN200CborWriter::writeMap(uint32_t pairs) {
+    return writeHead(CborMap, pairs);
+}
+
+bool SaraN200CborWriter::writeTag(uint32_t tag) {
+    return writeHead(CborTag, tag);
+}
+
+SaraN200CborReader::SaraN200CborReader(const uint8_t* buffer, size_t size):
+ buffer(buffer),
+ size(size),
+ position(0),
+ error(false) {
+}
+
+CborType SaraN200CborReader::peekType() const {
+    if (error || position >= size) {
+        return CborInvalid;
+    }
+
+    return static_cast<CborType>(buffer[position] >> MAJOR_SHIFT);
+}
+
+bool SaraN200CborReader::isNull() const {
+    return !error && position < size && buffer[position] == ((CborSimple << MAJOR_SHIFT) | SIMPLE_NULL);
+}
+
+bool SaraN200CborReader::readHead(uint8_t* major, uint8_t* info, uint32_t* argument) {
+    if (error || position >= size) {
+        return fail();
+    }
+
+    uint8_t initial = buffer[position];
+    *major = initial >> MAJOR_SHIFT;
+    *info = initial & INFO_MASK;
+
+    size_t extra;
+    if (*info < INFO_ONE_BYTE) {
+        extra = 0;
+    } else if (*info <= INFO_EIGHT_BYTES) {
+        extra = 1 << (*info - INFO_ONE_BYTE);
+    } else {
+        // indefinite lengths and reserved values are not supported
+        return fail();
+    }
+
+    if (extra > size - position - 1) {
+        return fail();
+    }
+
+    if (extra == 0) {
+        *argument = *info;
+    } else {
+        uint64_t value = 0;
+        for (size_t i = 1; i <= extra; i++) {
+            value = (value << 8) | buffer[position + i];
+        }
+
+        // only doubles need all 8 bytes, and skip() just steps over them
+        if (value > 0xFFFFFFFFUL && *major != CborSimple) {
+            return fail();
+        }
+
+        *argument = static_cast<uint32_t>(value);
+    }
+
+    position += 1 + extra;
+    return true;
+}
+
+bool SaraN200CborReader::expect(uint8_t major, uint32_t* argument) {
+    if (peekType() != major) {
+        return fail();
+    }
+
+    uint8_t actual;
+    uint8_t info;
+    return readHead(&actual, &info, argument);
+}
+
+bool SaraN200CborReader::readUint(uint32_t* value) {
+    return expect(CborUnsigned, value);
+}
+
+bool SaraN200CborReader::readInt(int32_t* value) {
+    uint32_t argument;
+    CborType type = peekType();
+
+    if (type == CborUnsigned) {
+        if (!expect(CborUnsigned, &argument) || argument > 0x7FFFFFFFUL) {
+            return fail();
+        }
+
+        *value = static_cast<int32_t>(argument);
+        return true;
+    }
+
+    if (type == CborNegative) {
+        if (!expect(CborNegative, &argument) || argument > 0x7FFFFFFFUL) {
+            return fail();
+        }
+
+        *value = -1 - static_cast<int32_t>(argument);
+        return true;
+    }
+
+    return fail();
+}
+
+bool SaraN200CborReader::readFloat(float* value) {
+    CborType type = peekType();
+
+    if (type == CborUnsigned || type == CborNegative) {
+        int32_t integer;
+        if (!readInt(&integer)) {
+            return false;
+        }
+
+        *value = static_cast<float>(integer);
+        return true;
+    }
+
+    if (type != CborSimple) {
+        return fail();
+    }
+
+    uint8_t info = buffer[position] & INFO_MASK;
+    size_t extra = (info == INFO_TWO_BYTES) ? 2 : (info == INFO_FOUR_BYTES) ? 4 : (info == INFO_EIGHT_BYTES) ? 8 : 0;
+
+    if (extra == 0 || extra > size - position - 1) {
+        return fail();
+    }
+
+    uint64_t bits = 0;
+    for (size_t i = 1; i <= extra; i++) {
+        bits = (bits << 8) | buffer[position + i];
+    }
+    position += 1 + extra;
+
+    if (extra == 2) {
+        *value = halfToFloat(static_cast<uint16_t>(bits));
+    } else if (extra == 4) {
+        uint32_t single = static_cast<uint32_t>(bits);
+        memcpy(value, &single, sizeof(single));
+    } else {
+        double wide;
+        memcpy(&wide, &bits, sizeof(wide));
+        *value = static_cast<float>(wide);
+    }
+
+    return true;
+}
+
+bool SaraN200CborReader::readBool(bool* value) {
+    if (error || position >= size) {
+        return fail();
+    }
+
+    uint8_t initial = buffer[position];
+    if (initial != ((CborSimple << MAJOR_SHIFT) | SIMPLE_TRUE) && initial != ((CborSimple << MAJOR_SHIFT) | SIMPLE_FALSE)) {
+        return fail();
+    }
+
+    *value = (initial & INFO_MASK) == SIMPLE_TRUE;
+    position++;
+    return true;
+}
+
+bool SaraN200CborReader::readNull() {
+    if (!isNull()) {
+        return fail();
+    }
+
+    position++;
+    return true;
+}
+
+bool SaraN200CborReader::readBytes(CborSlice* bytes) {
+    uint32_t length;
+    if (!expect(CborBytes, &length) || length > size - position) {
+        return fail();
+    }
+
+    bytes->data = buffer + position;
+    bytes->size = length;
+    position += length;
+    return true;
+}
+
+bool SaraN200CborReader::readText(CborSlice* text) {
+    uint32_t length;
+    if (!expect(CborText, &length) || length > size - position) {
+        return fail();
+    }
+
+    text->data = buffer + position;
+    text->size = length;
+    position += length;
+    return true;
+}
+
+bool SaraN200CborReader::readArray(uint32_t* count) {
+    return expect(CborArray, count);
+}
+
+bool SaraN200CborReader::readMap(uint32_t* pairs) {
+    return expect(CborMap, pairs);
+}
+
+bool SaraN200CborReader::readTag(uint32_t* tag) {
+    return expect(CborTag, tag);
+}
+
+bool SaraN200CborReader::read(uint8_t* value) {
+    uint32_t wide;
+    if (!readUint(&wide) || wide > 0xFF) {
+        return fail();
+    }
+
+    *value = static_cast<uint8_t>(wide);
+    return true;
+}
+
+bool SaraN200CborReader::read(uint16_t* value) {
+    uint32_t wide;
+    if (!readUint(&wide) || wide > 0xFFFF) {
+        return fail();
+    }
+
+    *value = static_cast<uint16_t>(wide);
+    return true;
+}
+
+bool SaraN200CborReader::read(int8_t* value) {
+    int32_t wide;
+    if (!readInt(&wide) || wide < -128 || wide > 127) {
+        return fail();
+    }
+
+    *value = static_cast<int8_t>(wide);
+    return true;
+}
+
+bool SaraN200CborReader::read(int16_t* value) {
+    int32_t wide;
+    if (!readInt(&wide) || wide < -32768 || wide > 32767) {
+        return fail();
+    }
+
+    *value = static_cast<int16_t>(wide);
+    return true;
+}
+
+bool SaraN200CborReader::read(CborSlice* value) {
+    return (peekType() == CborText) ? readText(value) : readBytes(value);
+}
+
+bool SaraN200CborReader::skip() {
+    // items still to step over per nesting level
+    uint32_t pending[SARA_N200_CBOR_MAX_DEPTH];
+    size_t depth = 0;
+    pending[0] = 1;
+
+    while (true) {
+        while (pending[depth] == 0) {
+            if (depth == 0) {
+                return true;
+            }
+            depth--;
+        }
+
+        pending[depth]--;
+
+        uint8_t major;
+        uint8_t info;
+        uint32_t argument;
+
+        if (!readHead(&major, &info, &argument)) {
+            return false;
+        }
+
+        switch (major) {
+        case CborBytes:
+        case CborText:
+            if (argument > size - position) {
+                return fail();
+            }
+            position += argument;
+            break;
+        case CborArray:
+        case CborMap:
+            // every item takes at least a byte
+            if (argument > size - position || depth + 1 == SARA_N200_CBOR_MAX_DEPTH) {
+                return fail();
+            }
+            pending[++depth] = (major == CborMap) ? 2 * argument : argument;
+            break;
+        case CborTag:
+            // the tagged item follows at the same level
+            pending[depth]++;
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,277 @@
+#ifndef SARA_N200_CBOR_H
+#define SARA_N200_CBOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SaraN200Config.h"
+
+// Nesting SaraN200CborReader::skip() follows before it gives up.
+#ifndef SARA_N200_CBOR_MAX_DEPTH
+#define SARA_N200_CBOR_MAX_DEPTH 8
+#endif
+
+typedef enum {
+    CborUnsigned = 0,
+    CborNegative,
+    CborBytes,
+    CborText,
+    CborArray,
+    CborMap,
+    CborTag,
+    CborSimple, // false, true, null, undefined and floats
+    CborInvalid
+} CborType;
+
+// Points into the buffer being decoded, nothing is copied.
+typedef struct CborSlice {
+    const uint8_t* data;
+    size_t size;
+} CborSlice;
+
+// Bytes a CBOR head takes for `value`: the type and a 0-4 byte argument.
+inline constexpr size_t saraN200CborHeadSize(uint32_t value) {
+    return (value < 24) ? 1 : (value <= 0xFF) ? 2 : (value <= 0xFFFF) ? 3 : 5;
+}
+
+// Encodes CBOR (RFC 8949) into a caller's buffer, typically the packet being
+// built by SaraUDP/SaraNIDD (see begin()). Each item is checked against the
+// space left once, not byte by byte. Running out of space sets a sticky
+// overflow flag and further writes are dropped, so a record can be written
+// in one go and checked at the end.
+class SaraN200CborWriter {
+public:
+    SaraN200CborWriter(uint8_t* buffer, size_t size);
+
+    // Writes straight into the unsent part of `packet`'s TX buffer; call
+    // commit() to add the encoded bytes to the packet.
+    template<typename Packet>
+    explicit SaraN200CborWriter(Packet& packet) : buffer(packet.txData()), size(packet.txSpace()), length(0), overflow(false) {}
+
+    template<typename Packet>
+    bool commit(Packet& packet) {
+        if (overflow) {
+            return false;
+        }
+
+        packet.txCommit(length);
+        return true;
+    }
+
+    bool writeUint(uint32_t value);
+    bool writeInt(int32_t value);
+    // As a half-precision float when that is exact, else single precision.
+    bool writeFloat(float value);
+    bool writeBool(bool value);
+    bool writeNull();
+    bool writeBytes(const uint8_t* data, size_t size);
+    bool writeText(const char* text);
+    bool writeText(const char* text, size_t size);
+    bool writeArray(uint32_t count);
+    bool writeMap(uint32_t pairs);
+    bool writeTag(uint32_t tag);
+
+    // Overloads for the schema helpers below.
+    bool write(bool value) { return writeBool(value); }
+    bool write(uint8_t value) { return writeUint(value); }
+    bool write(uint16_t value) { return writeUint(value); }
+    bool write(uint32_t value) { return writeUint(value); }
+    bool write(int8_t value) { return writeInt(value); }
+    bool write(int16_t value) { return writeInt(value); }
+    bool write(int32_t value) { return writeInt(value); }
+    bool write(float value) { return writeFloat(value); }
+    bool write(const char* text) { return writeText(text); }
+    bool write(const CborSlice& bytes) { return writeBytes(bytes.data, bytes.size); }
+
+    const uint8_t* data() const { return buffer; }
+    size_t getLength() const { return length; }
+    size_t getRemaining() const { return size - length; }
+    bool isOverflow() const { return overflow; }
+    void reset() { length = 0; overflow = false; }
+
+private:
+    uint8_t* buffer;
+    size_t size;
+    size_t length;
+    bool overflow;
+
+    bool writeHead(uint8_t major, uint32_t argument);
+    bool reserve(size_t count);
+};
+
+// Decodes CBOR in place, typically a packet received by SaraUDP/SaraNIDD.
+// Text and byte strings come back as slices into the buffer. A type
+// mismatch or truncated input sets a sticky error flag.
+class SaraN200CborReader {
+public:
+    SaraN200CborReader(const uint8_t* buffer, size_t size);
+
+    // Reads the unread part of `packet`'s RX buffer; call consume() to mark
+    // the decoded bytes as read.
+    template<typename Packet>
+    explicit SaraN200CborReader(Packet& packet) : buffer(packet.rxData()), size(packet.available()), position(0), error(false) {}
+
+    template<typename Packet>
+    void consume(Packet& packet) { packet.rxConsume(position); }
+
+    CborType peekType() const;
+    bool isNull() const;
+
+    bool readUint(uint32_t* value);
+    bool readInt(int32_t* value);
+    // Accepts half, single and double precision, and integers.
+    bool readFloat(float* value);
+    bool readBool(bool* value);
+    bool readNull();
+    bool readBytes(CborSlice* bytes);
+    bool readText(CborSlice* text);
+    bool readArray(uint32_t* count);
+    bool readMap(uint32_t* pairs);
+    bool readTag(uint32_t* tag);
+    // Steps over one item, including whatever it contains.
+    bool skip();
+
+    bool read(bool* value) { return readBool(value); }
+    bool read(uint8_t* value);
+    bool read(uint16_t* value);
+    bool read(uint32_t* value) { return readUint(value); }
+    bool read(int8_t* value);
+    bool read(int16_t* value);
+    bool read(int32_t* value) { return readInt(value); }
+    bool read(float* value) { return readFloat(value); }
+    bool read(CborSlice* value);
+
+    size_t getPosition() const { return position; }
+    size_t getRemaining() const { return size - position; }
+    bool isError() const { return error; }
+
+private:
+    const uint8_t* buffer;
+    size_t size;
+    size_t position;
+    bool error;
+
+    bool readHead(uint8_t* major, uint8_t* info, uint32_t* argument);
+    bool expect(uint8_t major, uint32_t* argument);
+    bool fail() { error = true; return false; }
+};
+
+// Compile-time description of fixed record layouts. Each field type gives
+// the largest encoding of its values, so a layout's MaxSize can be checked
+// against the datagram limit or a transport's TX buffer before anything is
+// sent:
+//
+//   typedef SaraN200CborArray<SaraN200CborField<uint32_t>, SaraN200CborField<int16_t>, SaraN200CborText<16> > Reading;
+//   SARA_N200_CBOR_ASSERT_FITS(Reading, SaraUDP);
+//   Reading::write(writer, timestamp, temperature, label);
+template<typename T>
+struct SaraN200CborField;
+
+template<> struct SaraN200CborField<bool> { static const size_t MaxSize = 1; };
+template<> struct SaraN200CborField<uint8_t> { static const size_t MaxSize = 2; };
+template<> struct SaraN200CborField<uint16_t> { static const size_t MaxSize = 3; };
+template<> struct SaraN200CborField<uint32_t> { static const size_t MaxSize = 5; };
+template<> struct SaraN200CborField<int8_t> { static const size_t MaxSize = 2; };
+template<> struct SaraN200CborField<int16_t> { static const size_t MaxSize = 3; };
+template<> struct SaraN200CborField<int32_t> { static const size_t MaxSize = 5; };
+template<> struct SaraN200CborField<float> { static const size_t MaxSize = 5; };
+
+// A string of at most `N` bytes.
+template<size_t N>
+struct SaraN200CborText { static const size_t MaxSize = saraN200CborHeadSize(N) + N; };
+
+template<size_t N>
+struct SaraN200CborByteString { static const size_t MaxSize = saraN200CborHeadSize(N) + N; };
+
+// A map entry under a small integer key, smaller than a text key.
+template<uint32_t Key, typename Field>
+struct SaraN200CborKey { static const size_t MaxSize = saraN200CborHeadSize(Key) + Field::MaxSize; };
+
+template<typename... Fields>
+struct SaraN200CborSum;
+
+template<>
+struct SaraN200CborSum<> { static const size_t value = 0; };
+
+template<typename First, typename... Rest>
+struct SaraN200CborSum<First, Rest...> { static const size_t value = First::MaxSize + SaraN200CborSum<Rest...>::value; };
+
+template<typename... Keys>
+struct SaraN200CborKeyList;
+
+template<>
+struct SaraN200CborKeyList<> {
+    static bool write(SaraN200CborWriter& writer) { return !writer.isOverflow(); }
+};
+
+template<uint32_t Key, typename Field, typename... Rest>
+struct SaraN200CborKeyList<SaraN200CborKey<Key, Field>, Rest...> {
+    template<typename Value, typename... Values>
+    static bool write(SaraN200CborWriter& writer, const Value& value, const Values&... values) {
+        writer.writeUint(Key);
+        writer.write(value);
+        return SaraN200CborKeyList<Rest...>::write(writer, values...);
+    }
+};
+
+template<typename... Fields>
+struct SaraN200CborArray {
+    static const size_t Count = sizeof...(Fields);
+    static const size_t MaxSize = saraN200CborHeadSize(sizeof...(Fields)) + SaraN200CborSum<Fields...>::value;
+
+    template<typename... Values>
+    static bool write(SaraN200CborWriter& writer, const Values&... values) {
+        static_assert(sizeof...(Values) == sizeof...(Fields), "SARA-N200: one value per CBOR field");
+        writer.writeArray(Count);
+        return writeAll(writer, values...);
+    }
+
+    // False when the record is not an array of exactly these fields.
+    template<typename... Values>
+    static bool read(SaraN200CborReader& reader, Values*... values) {
+        static_assert(sizeof...(Values) == sizeof...(Fields), "SARA-N200: one value per CBOR field");
+        uint32_t count = 0;
+        if (!reader.readArray(&count) || count != Count) {
+            return false;
+        }
+
+        return readAll(reader, values...);
+    }
+
+private:
+    static bool writeAll(SaraN200CborWriter& writer) { return !writer.isOverflow(); }
+
+    template<typename Value, typename... Values>
+    static bool writeAll(SaraN200CborWriter& writer, const Value& value, const Values&... values) {
+        writer.write(value);
+        return writeAll(writer, values...);
+    }
+
+    static bool readAll(SaraN200CborReader& reader) { return !reader.isError(); }
+
+    template<typename Value, typename... Values>
+    static bool readAll(SaraN200CborReader& reader, Value* value, Values*... values) {
+        return reader.read(value) && readAll(reader, values...);
+    }
+};
+
+// Fields are SaraN200CborKey<>s, written in order.
+template<typename... Keys>
+struct SaraN200CborMap {
+    static const size_t Count = sizeof...(Keys);
+    static const size_t MaxSize = saraN200CborHeadSize(sizeof...(Keys)) + SaraN200CborSum<Keys...>::value;
+
+    template<typename... Values>
+    static bool write(SaraN200CborWriter& writer, const Values&... values) {
+        static_assert(sizeof...(Values) == sizeof...(Keys), "SARA-N200: one value per CBOR key");
+        writer.writeMap(Count);
+        return SaraN200CborKeyList<Keys...>::write(writer, values...);
+    }
+};
+
+// Fails the build when `layout` can be larger than one datagram, or than
+// the TX buffer of `transport` (SaraUDP, SaraNIDD or their Static<> forms).
+#define SARA_N200_CBOR_ASSERT_FITS(layout, transport) \
+    static_assert((layout::MaxSize) <= SARA_N200_MAX_DATAGRAM_SIZE && (layout::MaxSize) <= transport::TxBufferBytes, \
+                  "SARA-N200: " #layout " does not fit in a " #transport " datagram")
+
+#endif
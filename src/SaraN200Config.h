@@ -0,0 +1,84 @@
+#ifndef SARA_N200_CONFIG_H
+#define SARA_N200_CONFIG_H
+
+#include <stddef.h>
+
+// Default sizes used by SaraN200, SaraN200Static<> and SaraUDPStatic<>.
+// Override them with -D flags or pass explicit template arguments.
+
+#ifndef SARA_N200_INPUT_BUFFER_SIZE
+#define SARA_N200_INPUT_BUFFER_SIZE 250
+#endif
+
+// The module supports up to 7 UDP sockets.
+#ifndef SARA_N200_SOCKET_COUNT
+#define SARA_N200_SOCKET_COUNT 7
+#endif
+
+// Largest datagram accepted by AT+NSOST / returned by AT+NSORF.
+#ifndef SARA_N200_MAX_DATAGRAM_SIZE
+#define SARA_N200_MAX_DATAGRAM_SIZE 512
+#endif
+
+// How long getRSSIAndBER() answers from the signal quality cache, in ms.
+#ifndef SARA_N200_SIGNAL_QUALITY_TTL
+#define SARA_N200_SIGNAL_QUALITY_TTL 5000
+#endif
+
+// How long on() keeps probing with AT before giving up, in ms.
+#ifndef SARA_N200_DETECT_TIMEOUT
+#define SARA_N200_DETECT_TIMEOUT 5000
+#endif
+
+// How long to wait for the boot banner after AT+NRB, in ms.
+#ifndef SARA_N200_REBOOT_TIMEOUT
+#define SARA_N200_REBOOT_TIMEOUT 10000
+#endif
+
+// AT+NSOST commands socketSendToAsync() may have in flight before it waits
+// for the oldest result.
+#ifndef SARA_N200_MAX_PENDING_SENDS
+#define SARA_N200_MAX_PENDING_SENDS 4
+#endif
+
+// Bands setBands() and getBands() handle at a time.
+#ifndef SARA_N200_MAX_BANDS
+#define SARA_N200_MAX_BANDS 8
+#endif
+
+// Attach attempts kept for SaraN200::getAttachAttempts().
+#ifndef SARA_N200_ATTACH_HISTORY
+#define SARA_N200_ATTACH_HISTORY 4
+#endif
+
+// AT+NSOST=<socket>,"<ip>",<port>, plus the terminator.
+#define SARA_N200_SEND_PREFIX_SIZE 36
+
+// Input buffer needed to read a whole +NSORF line carrying `n` payload bytes:
+// socket, dotted quad, port, length and remaining fields plus the hex payload.
+#define SARA_N200_RECV_LINE_SIZE(n) (2 * (n) + 48)
+
+#define SARA_N200_CONCAT_HELPER(a, b) a##b
+#define SARA_N200_CONCAT(a, b) SARA_N200_CONCAT_HELPER(a, b)
+
+// Fails the build when `type` does not fit in `bytes` of RAM.
+#define SARA_N200_ASSERT_MEMORY_BUDGET(type, bytes) \
+    static_assert(sizeof(type) <= (bytes), "SARA-N200: " #type " exceeds the memory budget of " #bytes " bytes")
+
+#ifdef SARA_N200_MEMORY_REPORT_ENABLED
+__attribute__((deprecated("SARA-N200 memory report, see 'Bytes' in the instantiation above")))
+inline void saraN200MemoryReport() {}
+
+template<size_t Bytes>
+struct SaraN200MemoryReport {
+    static void show() { saraN200MemoryReport(); }
+};
+
+// Prints "[with ... Bytes = N]" as a compiler warning for every reported type.
+#define SARA_N200_MEMORY_REPORT(type) \
+    inline void SARA_N200_CONCAT(saraN200MemoryReport_, __LINE__)() { SaraN200MemoryReport<sizeof(type)>::show(); }
+#else
+#define SARA_N200_MEMORY_REPORT(type)
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+#include "SaraN200Coro.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#define NOW (uint32_t)millis()
+
+static inline bool is_timedout(uint32_t from, uint32_t nr_ms) __attribute__((always_inline));
+static inline bool is_timedout(uint32_t from, uint32_t nr_ms)
+{
+    return (millis() - from) > nr_ms;
+}
+
+SaraN200FramePool::Block SaraN200FramePool::blocks[SARA_N200_CORO_FRAME_COUNT];
+bool SaraN200FramePool::taken[SARA_N200_CORO_FRAME_COUNT];
+size_t SaraN200FramePool::used = 0;
+uint32_t SaraN200FramePool::failures = 0;
+
+void* SaraN200FramePool::allocate(size_t size) {
+    if (size <= SARA_N200_CORO_FRAME_SIZE) {
+        for (size_t i = 0; i < SARA_N200_CORO_FRAME_COUNT; i++) {
+            if (!taken[i]) {
+                taken[i] = true;
+                used++;
+                return blocks[i].data;
+            }
+        }
+    }
+
+    failures++;
+    return nullptr;
+}
+
+void SaraN200FramePool::release(void* frame) {
+    for (size_t i = 0; i < SARA_N200_CORO_FRAME_COUNT; i++) {
+        if (frame == blocks[i].data) {
+            taken[i] = false;
+            used--;
+            return;
+        }
+    }
+}
+
+SaraN200Awaiter::~SaraN200Awaiter() {
+    // a task destroyed while suspended takes its await along
+    if (registered) {
+        driver->remove(this);
+    }
+}
+
+bool SaraN200Awaiter::suspend(std::coroutine_handle<> handle, const SaraN200PromiseBase* promise) {
+    this->handle = handle;
+    this->promise = promise;
+
+    if (promise->isCancelled()) {
+        expire(true);
+        return false;
+    }
+
+    if (!driver->add(this)) {
+        // no room to wait, fail like a timeout
+        expire(false);
+        return false;
+    }
+
+    suspendedAt = NOW;
+    return true;
+}
+
+bool SaraN200CoroRecv::step(SaraN200& modem) {
+    if (modem.getPendingDatagrams(socket) == 0) {
+        return false;
+    }
+
+    result = modem.socketRecvFrom(socket, buffer, size);
+    return true;
+}
+
+SaraN200Coro::SaraN200Coro(SaraN200& modem):
+ modem(&modem),
+ waiting(0),
+ pass(0) {
+    for (size_t i = 0; i < SARA_N200_CORO_WAITERS; i++) {
+        waiters[i] = nullptr;
+    }
+}
+
+bool SaraN200Coro::add(SaraN200Awaiter* awaiter) {
+    for (size_t i = 0; i < SARA_N200_CORO_WAITERS; i++) {
+        if (!waiters[i]) {
+            waiters[i] = awaiter;
+            awaiter->registered = true;
+            awaiter->pass = pass;
+            waiting++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SaraN200Coro::remove(SaraN200Awaiter* awaiter) {
+    for (size_t i = 0; i < SARA_N200_CORO_WAITERS; i++) {
+        if (waiters[i] == awaiter) {
+            waiters[i] = nullptr;
+            awaiter->registered = false;
+            waiting--;
+            return;
+        }
+    }
+}
+
+void SaraN200Coro::poll() {
+    modem->poll();
+
+    // awaits added while this pass resumes coroutines wait for the next one
+    pass++;
+
+    for (size_t i = 0; i < SARA_N200_CORO_WAITERS; i++) {
+        SaraN200Awaiter* awaiter = waiters[i];
+        if (!awaiter || awaiter->pass == pass) {
+            continue;
+        }
+
+        bool cancelled = awaiter->promise->isCancelled();
+        bool done = !cancelled && awaiter->step(*modem);
+
+        if (!done) {
+            bool expired = awaiter->timeout && is_timedout(awaiter->suspendedAt, awaiter->timeout);
+            if (!cancelled && !expired) {
+                continue;
+            }
+
+            awaiter->expire(cancelled);
+        }
+
+        // out of the table first, resuming ends the await and its lifetime
+        remove(awaiter);
+        awaiter->handle.resume();
+    }
+}
+
+#endif
@@ -0,0 +1,356 @@
+#ifndef SARA_N200_CORO_H
+#define SARA_N200_CORO_H
+
+// Optional C++20 coroutine layer: only compiled when the compiler supports
+// coroutines (e.g. GCC 11+ with -std=c++20, or CMAKE_CXX_STANDARD=20).
+//
+// The awaitables schedule the driver's calls, they do not make them
+// asynchronous: every co_await on a modem operation is still a blocking AT
+// command, run from SaraN200Coro::poll() when its turn comes, and poll()
+// returns only once that command has its response. What coroutines buy is
+// that waiting for a datagram or a delay costs no blocking at all.
+#if defined(__cpp_impl_coroutine)
+
+#include <Arduino.h>
+#include <coroutine>
+#include <exception>
+#include "SaraN200.h"
+
+// Coroutine frames come from a fixed pool, never from the heap. A frame
+// larger than a block, or a call while all blocks are in use, gives an
+// invalid task (see SaraN200Task::valid()).
+#ifndef SARA_N200_CORO_FRAME_SIZE
+#define SARA_N200_CORO_FRAME_SIZE 512
+#endif
+
+#ifndef SARA_N200_CORO_FRAME_COUNT
+#define SARA_N200_CORO_FRAME_COUNT 4
+#endif
+
+// Awaits that can be suspended at a time, over all coroutines.
+#ifndef SARA_N200_CORO_WAITERS
+#define SARA_N200_CORO_WAITERS 8
+#endif
+
+class SaraN200FramePool {
+public:
+    static void* allocate(size_t size);
+    static void release(void* frame);
+
+    static size_t getUsed() { return used; }
+    // Frames that could not be allocated so far.
+    static uint32_t getFailures() { return failures; }
+
+private:
+    typedef struct Block {
+        alignas(alignof(max_align_t)) uint8_t data[SARA_N200_CORO_FRAME_SIZE];
+    } Block;
+
+    static Block blocks[SARA_N200_CORO_FRAME_COUNT];
+    static bool taken[SARA_N200_CORO_FRAME_COUNT];
+    static size_t used;
+    static uint32_t failures;
+};
+
+// Shared by every SaraN200Task promise: the frame allocator, cancellation
+// and the coroutine to resume when this one finishes.
+class SaraN200PromiseBase {
+public:
+    static void* operator new(size_t size) noexcept { return SaraN200FramePool::allocate(size); }
+    static void operator delete(void* frame) { SaraN200FramePool::release(frame); }
+
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    // A task awaited by a cancelled task is cancelled as well.
+    bool isCancelled() const { return cancelled || (parent && parent->isCancelled()); }
+
+    bool cancelled = false;
+    const SaraN200PromiseBase* parent = nullptr;
+    std::coroutine_handle<> continuation;
+};
+
+template<typename T>
+class SaraN200Task;
+
+template<typename T>
+class SaraN200TaskPromise : public SaraN200PromiseBase {
+public:
+    SaraN200Task<T> get_return_object();
+    static SaraN200Task<T> get_return_object_on_allocation_failure() { return SaraN200Task<T>(); }
+
+    void return_value(const T& value) { result = value; }
+
+    T result = T();
+};
+
+template<>
+class SaraN200TaskPromise<void> : public SaraN200PromiseBase {
+public:
+    SaraN200Task<void> get_return_object();
+    static SaraN200Task<void> get_return_object_on_allocation_failure();
+
+    void return_void() {}
+};
+
+// A coroutine running on a SaraN200Coro driver. It starts at once and runs
+// until its first co_await; the driver's poll() resumes it from there. The
+// frame lives as long as the task object, so keep the task around until
+// done(): destroying it stops the coroutine. Tasks can await each other.
+template<typename T = void>
+class [[nodiscard]] SaraN200Task {
+public:
+    typedef SaraN200TaskPromise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    SaraN200Task() {}
+    explicit SaraN200Task(Handle handle) : handle(handle) {}
+    SaraN200Task(SaraN200Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    SaraN200Task(const SaraN200Task&) = delete;
+    SaraN200Task& operator=(const SaraN200Task&) = delete;
+
+    SaraN200Task& operator=(SaraN200Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+
+        return *this;
+    }
+
+    ~SaraN200Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    // False when no frame could be allocated.
+    bool valid() const { return static_cast<bool>(handle); }
+    bool done() const { return !handle || handle.done(); }
+
+    // The awaits in progress and all that follow fail at once (-1, false),
+    // so the coroutine unwinds through its error paths.
+    void cancel() {
+        if (handle) {
+            handle.promise().cancelled = true;
+        }
+    }
+
+    bool isCancelled() const { return handle && handle.promise().cancelled; }
+
+    // Awaiting a task from another task.
+    bool await_ready() const noexcept { return done(); }
+
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        handle.promise().parent = &awaiting.promise();
+    }
+
+    T await_resume() { return result(); }
+
+    // The co_return value once done(), T() until then or for invalid tasks.
+    T result() const {
+        if constexpr (std::is_void<T>::value) {
+            return;
+        } else {
+            return (handle && handle.done()) ? handle.promise().result : T();
+        }
+    }
+
+private:
+    Handle handle;
+};
+
+template<typename T>
+SaraN200Task<T> SaraN200TaskPromise<T>::get_return_object() {
+    return SaraN200Task<T>(SaraN200Task<T>::Handle::from_promise(*this));
+}
+
+inline SaraN200Task<void> SaraN200TaskPromise<void>::get_return_object() {
+    return SaraN200Task<void>(SaraN200Task<void>::Handle::from_promise(*this));
+}
+
+inline SaraN200Task<void> SaraN200TaskPromise<void>::get_return_object_on_allocation_failure() {
+    return SaraN200Task<void>();
+}
+
+class SaraN200Coro;
+
+// Base of every awaitable the driver resumes. While suspended it sits in
+// the driver's waiter table; poll() calls step() until it reports a result,
+// the timeout passes or the task is cancelled.
+class SaraN200Awaiter {
+public:
+    bool await_ready() const noexcept { return false; }
+
+    template<typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> handle) {
+        static_assert(std::is_base_of<SaraN200PromiseBase, Promise>::value, "SARA-N200: await driver operations from a SaraN200Task");
+        return suspend(handle, &handle.promise());
+    }
+
+    SaraN200Awaiter(const SaraN200Awaiter&) = delete;
+    SaraN200Awaiter& operator=(const SaraN200Awaiter&) = delete;
+
+protected:
+    // `timeout` in ms, 0 waits for as long as it takes.
+    SaraN200Awaiter(SaraN200Coro& driver, uint32_t timeout) : driver(&driver), timeout(timeout) {}
+    ~SaraN200Awaiter();
+
+    // Runs the operation or checks on it; true once the result is set.
+    virtual bool step(SaraN200& modem) = 0;
+    // Sets the result for a timeout or cancellation.
+    virtual void expire(bool cancelled) = 0;
+
+private:
+    friend class SaraN200Coro;
+
+    SaraN200Coro* driver;
+    uint32_t timeout;
+    uint32_t suspendedAt = 0;
+    uint32_t pass = 0;
+    bool registered = false;
+    std::coroutine_handle<> handle;
+    const SaraN200PromiseBase* promise = nullptr;
+
+    bool suspend(std::coroutine_handle<> handle, const SaraN200PromiseBase* promise);
+};
+
+// A blocking SaraN200 call run from poll(), so other coroutines and the
+// main loop get their turn between AT commands, not during one.
+template<typename T, typename Operation>
+class SaraN200CoroOperation : public SaraN200Awaiter {
+public:
+    SaraN200CoroOperation(SaraN200Coro& driver, T failure, Operation operation) :
+        SaraN200Awaiter(driver, 0), operation(operation), result(failure) {}
+
+    T await_resume() const { return result; }
+
+protected:
+    virtual bool step(SaraN200& modem) { result = operation(modem); return true; }
+    virtual void expire(bool cancelled) {}
+
+private:
+    Operation operation;
+    T result;
+};
+
+// Waits for +NSONMI and reads the datagram; the socket needs URCs enabled.
+// Resumes with the length, or -1 on timeout, cancellation or error.
+class SaraN200CoroRecv : public SaraN200Awaiter {
+public:
+    SaraN200CoroRecv(SaraN200Coro& driver, int socket, uint8_t* buffer, size_t size, uint32_t timeout) :
+        SaraN200Awaiter(driver, timeout), socket(socket), buffer(buffer), size(size), result(-1) {}
+
+    int await_resume() const { return result; }
+
+protected:
+    virtual bool step(SaraN200& modem);
+    virtual void expire(bool cancelled) { result = -1; }
+
+private:
+    int socket;
+    uint8_t* buffer;
+    size_t size;
+    int result;
+};
+
+// Resumes after `ms` with true, or with false when cancelled.
+class SaraN200CoroDelay : public SaraN200Awaiter {
+public:
+    SaraN200CoroDelay(SaraN200Coro& driver, uint32_t ms) : SaraN200Awaiter(driver, ms ? ms : 1), result(false) {}
+
+    bool await_resume() const { return result; }
+
+protected:
+    virtual bool step(SaraN200& modem) { return false; }
+    virtual void expire(bool cancelled) { result = !cancelled; }
+
+private:
+    bool result;
+};
+
+// Runs coroutines over one modem. Call poll() from the main loop: it
+// dispatches URCs through SaraN200::poll() and resumes the coroutines
+// whose awaits are ready. A typical flow:
+//
+//   SaraN200Task<int> report(SaraN200Coro& coro) {
+//       int socket = co_await coro.createSocket();
+//       if (socket < 0 || co_await coro.socketSendTo(socket, server, 5000, data, size) < 0) co_return -1;
+//       int length = co_await coro.socketRecvFrom(socket, reply, sizeof(reply), 10000);
+//       co_await coro.closeSocket(socket);
+//       co_return length;
+//   }
+class SaraN200Coro {
+public:
+    SaraN200Coro(SaraN200& modem);
+
+    void poll();
+
+    SaraN200& getModem() { return *modem; }
+    size_t getWaiting() const { return waiting; }
+
+    auto createSocket(uint16_t localPort = 42000, bool enableURC = true) {
+        return SaraN200CoroOperation(*this, -1, [=](SaraN200& modem) { return modem.createSocket(localPort, enableURC); });
+    }
+
+    auto closeSocket(int socket) {
+        return SaraN200CoroOperation(*this, false, [=](SaraN200& modem) { return modem.closeSocket(socket); });
+    }
+
+    // `buffer` must stay valid until the await resumes.
+    auto socketSendTo(int socket, IPAddress ip, uint16_t port, uint8_t* buffer, size_t size) {
+        return SaraN200CoroOperation(*this, -1, [=](SaraN200& modem) { return modem.socketSendTo(socket, ip, port, buffer, size); });
+    }
+
+    SaraN200CoroRecv socketRecvFrom(int socket, uint8_t* buffer, size_t size, uint32_t timeout) {
+        return SaraN200CoroRecv(*this, socket, buffer, size, timeout);
+    }
+
+    auto isConnected() {
+        return SaraN200CoroOperation(*this, false, [](SaraN200& modem) { return modem.isConnected(); });
+    }
+
+    // Refreshes the signal quality cache and copies it to `quality`.
+    auto getSignalQuality(SaraN200::SignalQuality* quality) {
+        return SaraN200CoroOperation(*this, false, [=](SaraN200& modem) {
+            return modem.refreshSignalQuality() && modem.getSignalQuality(quality);
+        });
+    }
+
+    SaraN200CoroDelay delay(uint32_t ms) { return SaraN200CoroDelay(*this, ms); }
+
+private:
+    friend class SaraN200Awaiter;
+
+    SaraN200* modem;
+    SaraN200Awaiter* waiters[SARA_N200_CORO_WAITERS];
+    size_t waiting;
+    uint32_t pass;
+
+    bool add(SaraN200Awaiter* awaiter);
+    void remove(SaraN200Awaiter* awaiter);
+};
+
+#endif
+
+#endif
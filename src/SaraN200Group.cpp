@@ -0,0 +1,293 @@
+#include "SaraN200Group.h"
+
+#ifdef SARA_N200_HAS_THREADS
+
+using SaraN200Platform::LockGuard;
+
+// consecutive send failures before a modem is taken out of rotation
+#define MAX_CONSECUTIVE_FAILURES 3
+
+// score penalties: one queued datagram weighs like 10 dB of signal
+#define QUEUE_PENALTY 10
+#define ECL_PENALTY 15
+#define RSSI_UNKNOWN -113
+
+SaraN200Group::SaraN200Group():
+ memberCount(0),
+ createdAt(millis()) {}
+
+SaraN200Group::~SaraN200Group() {}
+
+bool SaraN200Group::add(SaraN200Worker& worker, int socket) {
+    LockGuard guard(mutex);
+
+    if (memberCount == SARA_N200_GROUP_SIZE) {
+        return false;
+    }
+
+    Member& member = members[memberCount++];
+    memset(&member.stats, 0, sizeof(member.stats));
+    member.group = this;
+    member.worker = &worker;
+    member.socket = socket;
+    member.refreshing = false;
+    member.consecutiveFailures = 0;
+    member.stats.up = true;
+
+    for (size_t i = 0; i < SARA_N200_GROUP_QUEUE_DEPTH; i++) {
+        member.datagrams[i].group = this;
+        member.datagrams[i].member = &member;
+        member.datagrams[i].used = false;
+    }
+
+    return true;
+}
+
+SaraN200Group::Member* SaraN200Group::select(Member* exclude) {
+    Member* best = NULL;
+    int bestScore = 0;
+
+    for (size_t i = 0; i < memberCount; i++) {
+        Member* member = &members[i];
+        if (member == exclude || !member->stats.up || member->stats.queued == SARA_N200_GROUP_QUEUE_DEPTH) {
+            continue;
+        }
+
+        int rssi = (member->stats.rssi == 0) ? RSSI_UNKNOWN : member->stats.rssi;
+        int score = rssi - ECL_PENALTY * member->stats.ecl - QUEUE_PENALTY * static_cast<int>(member->stats.queued);
+
+        if (!best || score > bestScore) {
+            best = member;
+            bestScore = score;
+        }
+    }
+
+    return best;
+}
+
+bool SaraN200Group::dispatch(Member* member, Datagram* source) {
+    Datagram* datagram = NULL;
+
+    mutex.lock();
+    for (size_t i = 0; i < SARA_N200_GROUP_QUEUE_DEPTH; i++) {
+        if (!member->datagrams[i].used) {
+            datagram = &member->datagrams[i];
+            break;
+        }
+    }
+
+    if (!datagram) {
+        mutex.unlock();
+        return false;
+    }
+
+    datagram->used = true;
+    datagram->attempts = source->attempts;
+    datagram->ip = source->ip;
+    datagram->port = source->port;
+    datagram->size = source->size;
+    memcpy(datagram->data, source->data, source->size);
+    member->stats.queued++;
+    mutex.unlock();
+
+    if (!member->worker->post(sendOperation, datagram, sendDropped)) {
+        LockGuard guard(mutex);
+        datagram->used = false;
+        member->stats.queued--;
+
+        return false;
+    }
+
+    return true;
+}
+
+int SaraN200Group::sendTo(IPAddress ip, uint16_t port, const uint8_t* buffer, size_t size) {
+    if (size > SARA_N200_MAX_DATAGRAM_SIZE) {
+        return -1;
+    }
+
+    Datagram source;
+    source.attempts = 0;
+    source.ip = ip;
+    source.port = port;
+    source.size = size;
+    memcpy(source.data, buffer, size);
+
+    Member* exclude = NULL;
+    for (size_t attempt = 0; attempt < memberCount; attempt++) {
+        mutex.lock();
+        Member* member = select(exclude);
+        mutex.unlock();
+
+        if (!member) {
+            return -1;
+        }
+
+        if (dispatch(member, &source)) {
+            return member - members;
+        }
+
+        // worker queue full, try the next best modem
+        exclude = member;
+    }
+
+    return -1;
+}
+
+void SaraN200Group::sendOperation(SaraN200& modem, void* context) {
+    Datagram* datagram = static_cast<Datagram*>(context);
+    int sent = modem.socketSendTo(datagram->member->socket, datagram->ip, datagram->port, datagram->data, datagram->size);
+
+    datagram->group->completed(datagram, sent >= 0);
+}
+
+void SaraN200Group::sendDropped(SaraN200& modem, void* context) {
+    // the worker ended before sending it
+    Datagram* datagram = static_cast<Datagram*>(context);
+    datagram->group->completed(datagram, false);
+}
+
+void SaraN200Group::completed(Datagram* datagram, bool sent) {
+    Member* member = datagram->member;
+    bool retry = false;
+
+    mutex.lock();
+    member->stats.queued--;
+    datagram->attempts++;
+
+    if (sent) {
+        member->stats.datagramsSent++;
+        member->stats.bytesSent += datagram->size;
+        member->consecutiveFailures = 0;
+    } else {
+        member->stats.failures++;
+        if (++member->consecutiveFailures >= MAX_CONSECUTIVE_FAILURES) {
+            member->stats.up = false;
+        }
+
+        retry = datagram->attempts < memberCount;
+    }
+    mutex.unlock();
+
+    bool moved = false;
+    Member* exclude = member;
+    for (size_t i = 0; retry && !moved && i < memberCount; i++) {
+        mutex.lock();
+        Member* fallback = select(exclude);
+        mutex.unlock();
+
+        if (!fallback) {
+            break;
+        }
+
+        moved = dispatch(fallback, datagram);
+        exclude = fallback;
+    }
+
+    LockGuard guard(mutex);
+    if (moved) {
+        member->stats.failovers++;
+    } else if (!sent) {
+        member->stats.dropped++;
+    }
+
+    datagram->used = false;
+}
+
+void SaraN200Group::update() {
+    for (size_t i = 0; i < memberCount; i++) {
+        Member* member = &members[i];
+
+        mutex.lock();
+        bool refreshing = member->refreshing;
+        member->refreshing = true;
+        mutex.unlock();
+
+        if (!refreshing && !member->worker->post(refreshOperation, member, refreshDropped)) {
+            LockGuard guard(mutex);
+            member->refreshing = false;
+        }
+    }
+}
+
+void SaraN200Group::refreshOperation(SaraN200& modem, void* context) {
+    Member* member = static_cast<Member*>(context);
+
+    bool attached = modem.isConnected();
+    int8_t rssi = 0;
+    uint8_t ber = 0;
+    SaraN200::SignalQuality quality;
+
+    modem.getRSSIAndBER(&rssi, &ber);
+    modem.getSignalQuality(&quality);
+
+    LockGuard guard(member->group->mutex);
+    member->stats.up = attached;
+    member->stats.rssi = rssi;
+    if (quality.extended) {
+        member->stats.ecl = quality.ecl;
+    }
+
+    if (attached) {
+        member->consecutiveFailures = 0;
+    }
+
+    member->refreshing = false;
+}
+
+void SaraN200Group::refreshDropped(SaraN200& modem, void* context) {
+    Member* member = static_cast<Member*>(context);
+
+    LockGuard guard(member->group->mutex);
+    member->refreshing = false;
+}
+
+bool SaraN200Group::flush(uint32_t timeout) {
+    uint32_t start = millis();
+
+    while (getTotals().queued > 0) {
+        if (millis() - start > timeout) {
+            return false;
+        }
+
+        delay(10);
+    }
+
+    return true;
+}
+
+SaraN200Group::MemberStats SaraN200Group::getStats(size_t index) {
+    LockGuard guard(mutex);
+    return members[index].stats;
+}
+
+SaraN200Group::MemberStats SaraN200Group::getTotals() {
+    MemberStats totals;
+    memset(&totals, 0, sizeof(totals));
+
+    LockGuard guard(mutex);
+    for (size_t i = 0; i < memberCount; i++) {
+        const MemberStats& stats = members[i].stats;
+
+        totals.up = totals.up || stats.up;
+        totals.queued += stats.queued;
+        totals.datagramsSent += stats.datagramsSent;
+        totals.bytesSent += stats.bytesSent;
+        totals.failures += stats.failures;
+        totals.failovers += stats.failovers;
+        totals.dropped += stats.dropped;
+    }
+
+    return totals;
+}
+
+uint32_t SaraN200Group::getThroughput() {
+    uint32_t elapsed = millis() - createdAt;
+    if (elapsed == 0) {
+        return 0;
+    }
+
+    return static_cast<uint32_t>((static_cast<uint64_t>(getTotals().bytesSent) * 1000) / elapsed);
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef SARA_N200_GROUP_H
+#define SARA_N200_GROUP_H
+
+#include "SaraN200Worker.h"
+
+#ifdef SARA_N200_HAS_THREADS
+
+#ifndef SARA_N200_GROUP_SIZE
+#define SARA_N200_GROUP_SIZE 4
+#endif
+
+// Datagrams each modem can have queued for sending.
+#ifndef SARA_N200_GROUP_QUEUE_DEPTH
+#define SARA_N200_GROUP_QUEUE_DEPTH 4
+#endif
+
+// Drives several SARA-N200 modules as one uplink. Every modem is owned by its
+// own SaraN200Worker, so sends to different modems run concurrently. sendTo()
+// copies the datagram, picks the modem with the best link quality and the
+// shortest queue and returns at once. A modem that fails repeatedly or
+// reports itself detached is taken out of rotation, and its failed datagrams
+// go out through another modem.
+class SaraN200Group {
+public:
+    typedef struct MemberStats {
+        bool up;
+        int8_t rssi;
+        uint8_t ecl;
+        size_t queued;
+        uint32_t datagramsSent;
+        uint32_t bytesSent;
+        uint32_t failures;
+        uint32_t failovers; // datagrams moved to another modem after failing here
+        uint32_t dropped;   // failed here with no other modem left to take them
+    } MemberStats;
+
+    SaraN200Group();
+    ~SaraN200Group();
+
+    // `socket` is a socket already created on that modem. The worker must be
+    // running and must outlive the group. Datagrams still queued when the
+    // worker ends count as failed sends on that modem.
+    bool add(SaraN200Worker& worker, int socket);
+    size_t getSize() const { return memberCount; }
+
+    // Queues the datagram on the best modem. Returns the modem index, or -1
+    // when no modem is up or every queue is full.
+    int sendTo(IPAddress ip, uint16_t port, const uint8_t* buffer, size_t size);
+
+    // Refreshes attach state and signal quality of every modem in the
+    // background. Call it every few seconds.
+    void update();
+
+    // Waits until every queued datagram has been handled.
+    bool flush(uint32_t timeout);
+
+    MemberStats getStats(size_t index);
+    MemberStats getTotals();
+    // Aggregate uplink throughput since the group was created, bytes/s.
+    uint32_t getThroughput();
+
+private:
+    struct Member;
+
+    typedef struct Datagram {
+        SaraN200Group* group;
+        Member* member;
+        bool used;
+        uint8_t attempts;
+        IPAddress ip;
+        uint16_t port;
+        size_t size;
+        uint8_t data[SARA_N200_MAX_DATAGRAM_SIZE];
+    } Datagram;
+
+    struct Member {
+        SaraN200Group* group;
+        SaraN200Worker* worker;
+        int socket;
+        bool refreshing;
+        uint8_t consecutiveFailures;
+        MemberStats stats;
+        Datagram datagrams[SARA_N200_GROUP_QUEUE_DEPTH];
+    };
+
+    Member members[SARA_N200_GROUP_SIZE];
+    size_t memberCount;
+    uint32_t createdAt;
+    SaraN200Platform::Mutex mutex;
+
+    Member* select(Member* exclude);
+    bool dispatch(Member* member, Datagram* source);
+    void completed(Datagram* datagram, bool sent);
+
+    static void sendOperation(SaraN200& modem, void* context);
+    static void sendDropped(SaraN200& modem, void* context);
+    static void refreshOperation(SaraN200& modem, void* context);
+    static void refreshDropped(SaraN200& modem, void* context);
+
+    SaraN200Group(const SaraN200Group&);
+    SaraN200Group& operator=(const SaraN200Group&);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,171 @@
+#include "SaraN200Nidd.h"
+
+SaraNIDDBase::SaraNIDDBase(SaraN200& sara, uint8_t* txBuffer, size_t txBufferSize, uint8_t* rxBuffer, size_t rxBufferSize):
+ sara_(&sara),
+ rmtPort_(0),
+ tx_buffer_(txBuffer),
+ tx_buffer_size_(txBufferSize),
+ tx_buffer_len_(0),
+ rx_buffer_(rxBuffer),
+ rx_buffer_size_(rxBufferSize),
+ rx_buffer_len_(0),
+ rx_buffer_pos_(0)
+ {}
+
+SaraNIDDBase::~SaraNIDDBase() {
+    stop();
+}
+
+uint8_t SaraNIDDBase::begin(uint16_t port) {
+    return sara_->setNonIpUrcEnabled(true) ? 1 : 0;
+}
+
+void SaraNIDDBase::stop() {
+    tx_buffer_len_ = 0;
+    flush();
+
+    if (sara_->isNonIpUrcEnabled()) {
+        sara_->setNonIpUrcEnabled(false);
+    }
+}
+
+int SaraNIDDBase::beginPacket() {
+    tx_buffer_len_ = 0;
+    return 1;
+}
+
+int SaraNIDDBase::beginPacket(IPAddress ip, uint16_t port) {
+    rmtIp_ = ip;
+    rmtPort_ = port;
+
+    return beginPacket();
+}
+
+int SaraNIDDBase::beginPacket(const char* host, uint16_t port) {
+    // nothing to resolve, the network picks the destination
+    rmtPort_ = port;
+
+    return beginPacket();
+}
+
+int SaraNIDDBase::endPacket() {
+    if (!sara_->nonIpSend(tx_buffer_, tx_buffer_len_)) {
+        return 0;
+    }
+
+    return 1;
+}
+
+size_t SaraNIDDBase::write(uint8_t value) {
+    if (tx_buffer_len_ == tx_buffer_size_) {
+        endPacket();
+        tx_buffer_len_ = 0;
+    }
+
+    tx_buffer_[tx_buffer_len_++] = value;
+    return 1;
+}
+
+size_t SaraNIDDBase::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+
+    // copy in runs up to the end of the buffer, a full buffer goes out
+    // just like with write(uint8_t)
+    while (written < size) {
+        if (tx_buffer_len_ == tx_buffer_size_) {
+            endPacket();
+            tx_buffer_len_ = 0;
+        }
+
+        size_t count = size - written;
+        if (count > tx_buffer_size_ - tx_buffer_len_) {
+            count = tx_buffer_size_ - tx_buffer_len_;
+        }
+
+        memcpy(tx_buffer_ + tx_buffer_len_, buffer + written, count);
+        tx_buffer_len_ += count;
+        written += count;
+    }
+
+    return written;
+}
+
+void SaraNIDDBase::txCommit(size_t size) {
+    if (size > txSpace()) {
+        size = txSpace();
+    }
+
+    tx_buffer_len_ += size;
+}
+
+int SaraNIDDBase::parsePacket() {
+    if (available()) {
+        return 0;
+    }
+
+    // +NNMI is only counted while the driver reads the UART
+    sara_->poll();
+
+    // with +NNMI on, nothing is buffered on the module until it says so
+    if (sara_->isNonIpUrcEnabled() && sara_->getPendingNonIpMessages() == 0) {
+        return 0;
+    }
+
+    int readLength = sara_->nonIpRecv(rx_buffer_, rx_buffer_size_);
+    if (readLength <= 0) {
+        return 0;
+    }
+
+    rx_buffer_len_ = readLength;
+    rx_buffer_pos_ = 0;
+
+    return readLength;
+}
+
+int SaraNIDDBase::available() {
+    return rx_buffer_len_ - rx_buffer_pos_;
+}
+
+int SaraNIDDBase::read() {
+    if (!available()) return -1;
+    return rx_buffer_[rx_buffer_pos_++];
+}
+
+int SaraNIDDBase::read(unsigned char* buffer, size_t len) {
+    return read((char*)buffer, len);
+}
+
+int SaraNIDDBase::read(char* buffer, size_t len) {
+    size_t count = available();
+    if (count > len) {
+        count = len;
+    }
+
+    memcpy(buffer, rx_buffer_ + rx_buffer_pos_, count);
+    rx_buffer_pos_ += count;
+
+    return count;
+}
+
+int SaraNIDDBase::peek() {
+    if (!available()) return -1;
+    return rx_buffer_[rx_buffer_pos_];
+}
+
+void SaraNIDDBase::rxConsume(size_t size) {
+    size_t count = available();
+    rx_buffer_pos_ += (size > count) ? count : size;
+}
+
+void SaraNIDDBase::flush() {
+    rx_buffer_len_ = 0;
+    rx_buffer_pos_ = 0;
+}
+
+IPAddress SaraNIDDBase::remoteIP() {
+    return rmtIp_;
+}
+
+uint16_t SaraNIDDBase::remotePort() {
+    return rmtPort_;
+}
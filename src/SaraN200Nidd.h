@@ -0,0 +1,89 @@
+#ifndef SARA_N200_NIDD_INTERFACE_H
+#define SARA_N200_NIDD_INTERFACE_H
+
+#include <Arduino.h>
+#include <Udp.h>
+#include "SaraN200.h"
+#include "SaraN200Config.h"
+
+// Non-IP data delivery behind the same packet interface as SaraUDP, so code
+// written against UDP& runs over either transport. Messages carry no IP or
+// UDP headers: the addresses given to beginPacket() are ignored, the network
+// routes every message to the application server configured for the APN,
+// and remoteIP()/remotePort() return the last destination. The TX and RX
+// buffers are handed in by SaraNIDDStatic<>, so the class never allocates.
+class SaraNIDDBase: public UDP {
+public:
+    virtual ~SaraNIDDBase();
+
+    // Enables +NNMI so parsePacket() only asks the module when a message
+    // has been announced. `port` is ignored.
+    virtual uint8_t begin(uint16_t port);
+    virtual void stop();
+    virtual int beginPacket();
+    virtual int beginPacket(IPAddress ip, uint16_t port);
+    virtual int beginPacket(const char* host, uint16_t port);
+    virtual int endPacket();
+    virtual size_t write(uint8_t value);
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    // Runs SaraN200::poll() to pick up +NNMI, so a plain
+    // `while (nidd.parsePacket())` loop needs nothing else.
+    virtual int parsePacket();
+    virtual int available();
+    virtual int read();
+    virtual int read(unsigned char* buffer, size_t len);
+    virtual int read(char* buffer, size_t len);
+    virtual int peek();
+    virtual void flush();
+    virtual IPAddress remoteIP();
+    virtual uint16_t remotePort();
+
+    // Direct access to the packet buffers, e.g. for SaraN200CborWriter and
+    // SaraN200CborReader. Up to txSpace() bytes written at txData() join the
+    // packet with txCommit(); rxData() is the unread part of the packet
+    // from parsePacket(), available() bytes long.
+    uint8_t* txData() { return tx_buffer_ + tx_buffer_len_; }
+    size_t txSpace() const { return tx_buffer_size_ - tx_buffer_len_; }
+    void txCommit(size_t size);
+    const uint8_t* rxData() const { return rx_buffer_ + rx_buffer_pos_; }
+    void rxConsume(size_t size);
+
+protected:
+    SaraNIDDBase(SaraN200& sara, uint8_t* txBuffer, size_t txBufferSize, uint8_t* rxBuffer, size_t rxBufferSize);
+
+    SaraN200* sara_;
+    IPAddress rmtIp_;
+    uint16_t rmtPort_;
+    uint8_t* tx_buffer_;
+    size_t tx_buffer_size_;
+    size_t tx_buffer_len_;
+    uint8_t* rx_buffer_;
+    size_t rx_buffer_size_;
+    size_t rx_buffer_len_;
+    size_t rx_buffer_pos_;
+};
+
+template<size_t TxBufferSize = SARA_N200_MAX_DATAGRAM_SIZE, size_t RxBufferSize = SARA_N200_MAX_DATAGRAM_SIZE>
+class SaraNIDDStatic: public SaraNIDDBase {
+public:
+    static_assert(TxBufferSize > 0 && TxBufferSize <= SARA_N200_MAX_DATAGRAM_SIZE, "SARA-N200: TX buffer must hold at most one message");
+    static_assert(RxBufferSize > 0 && RxBufferSize <= SARA_N200_MAX_DATAGRAM_SIZE, "SARA-N200: RX buffer must hold at most one message");
+
+    static const size_t TxBufferBytes = TxBufferSize;
+    static const size_t RxBufferBytes = RxBufferSize;
+
+    SaraNIDDStatic(SaraN200& sara) : SaraNIDDBase(sara, txStorage, TxBufferSize, rxStorage, RxBufferSize) {}
+
+private:
+    uint8_t txStorage[TxBufferSize];
+    uint8_t rxStorage[RxBufferSize];
+};
+
+class SaraNIDD: public SaraNIDDStatic<> {
+public:
+    SaraNIDD(SaraN200& sara) : SaraNIDDStatic<>(sara) {}
+};
+
+SARA_N200_MEMORY_REPORT(SaraNIDD)
+
+#endif
@@ -0,0 +1,258 @@
+#include "SaraN200Peers.h"
+
+#define NOW (uint32_t)millis()
+
+SaraN200PeerQueue::SaraN200PeerQueue(SaraN200& modem):
+ modem(&modem),
+ queued(0),
+ nextPeer(0),
+ burst(SARA_N200_PEER_QUEUE_DEPTH),
+ interval(0),
+ current(NULL),
+ incoming(NULL),
+ continuing(false),
+ truncating(false) {
+    clear();
+}
+
+void SaraN200PeerQueue::setRateLimit(uint8_t burst, uint32_t interval) {
+    this->burst = burst ? burst : 1;
+    this->interval = interval;
+
+    for (size_t i = 0; i < SARA_N200_PEER_COUNT; i++) {
+        peers[i].tokens = this->burst;
+        peers[i].refilledAt = NOW;
+    }
+}
+
+void SaraN200PeerQueue::clear() {
+    for (size_t i = 0; i < SARA_N200_PEER_COUNT; i++) {
+        peers[i].used = false;
+        peers[i].count = 0;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    queued = 0;
+    nextPeer = 0;
+    current = NULL;
+    incoming = NULL;
+    continuing = false;
+}
+
+size_t SaraN200PeerQueue::getPeerCount() const {
+    size_t count = 0;
+
+    for (size_t i = 0; i < SARA_N200_PEER_COUNT; i++) {
+        if (peers[i].used) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+bool SaraN200PeerQueue::getPeerStats(IPAddress ip, uint16_t port, Stats* peerStats) const {
+    for (size_t i = 0; i < SARA_N200_PEER_COUNT; i++) {
+        if (peers[i].used && peers[i].port == port && peers[i].ip == ip) {
+            *peerStats = peers[i].stats;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int SaraN200PeerQueue::fill(int socket, size_t maxBytes) {
+    return modem->socketRecvStream(socket, *this, maxBytes);
+}
+
+int SaraN200PeerQueue::next(uint8_t* buffer, size_t size, IPAddress* remoteIp, uint16_t* remotePort) {
+    if (queued == 0) {
+        return 0;
+    }
+
+    for (size_t n = 0; n < SARA_N200_PEER_COUNT; n++) {
+        size_t index = (nextPeer + n) % SARA_N200_PEER_COUNT;
+        Peer* peer = &peers[index];
+
+        if (!peer->used || peer->count == 0) {
+            continue;
+        }
+
+        Datagram* datagram = &peer->datagrams[peer->head];
+        size_t length = (datagram->length > size) ? size : datagram->length;
+        memcpy(buffer, datagram->data, length);
+
+        if (remoteIp) {
+            *remoteIp = peer->ip;
+        }
+
+        if (remotePort) {
+            *remotePort = peer->port;
+        }
+
+        peer->head = (peer->head + 1) % SARA_N200_PEER_QUEUE_DEPTH;
+        peer->count--;
+        queued--;
+        stats.delivered++;
+        peer->stats.delivered++;
+
+        // the next call starts with the sender after this one
+        nextPeer = index + 1;
+        return length;
+    }
+
+    return 0;
+}
+
+SaraN200PeerQueue::Peer* SaraN200PeerQueue::findPeer(IPAddress ip, uint16_t port) {
+    for (size_t i = 0; i < SARA_N200_PEER_COUNT; i++) {
+        if (peers[i].used && peers[i].port == port && peers[i].ip == ip) {
+            return &peers[i];
+        }
+    }
+
+    return NULL;
+}
+
+SaraN200PeerQueue::Peer* SaraN200PeerQueue::addPeer(IPAddress ip, uint16_t port) {
+    Peer* peer = NULL;
+
+    // a free entry, else the sender heard from longest ago with nothing queued
+    for (size_t i = 0; i < SARA_N200_PEER_COUNT; i++) {
+        if (!peers[i].used) {
+            peer = &peers[i];
+            break;
+        }
+
+        if (peers[i].count == 0 && (!peer || (int32_t)(peers[i].lastSeenAt - peer->lastSeenAt) < 0)) {
+            peer = &peers[i];
+        }
+    }
+
+    if (!peer) {
+        return NULL;
+    }
+
+    peer->used = true;
+    peer->ip = ip;
+    peer->port = port;
+    peer->head = 0;
+    peer->count = 0;
+    peer->tokens = burst;
+    peer->refilledAt = NOW;
+    memset(&peer->stats, 0, sizeof(peer->stats));
+
+    return peer;
+}
+
+bool SaraN200PeerQueue::takeToken(Peer* peer) {
+    if (interval == 0) {
+        return true;
+    }
+
+    uint32_t elapsed = NOW - peer->refilledAt;
+    uint32_t earned = elapsed / interval;
+
+    if (earned > 0) {
+        peer->tokens = (earned >= static_cast<uint32_t>(burst - peer->tokens)) ? burst : peer->tokens + earned;
+        peer->refilledAt += earned * interval;
+    }
+
+    if (peer->tokens == burst) {
+        peer->refilledAt = NOW;
+    }
+
+    if (peer->tokens == 0) {
+        return false;
+    }
+
+    peer->tokens--;
+    return true;
+}
+
+size_t SaraN200PeerQueue::capacity() {
+    // with every queue full, leave the rest on the modem
+    if (!continuing && queued == SARA_N200_PEER_COUNT * SARA_N200_PEER_QUEUE_DEPTH) {
+        return 0;
+    }
+
+    return SARA_N200_PEER_MAX_PAYLOAD;
+}
+
+void SaraN200PeerQueue::begin(int socket, const char* fromIp, uint16_t fromPort, size_t length) {
+    // the rest of a datagram longer than the last capacity()
+    if (continuing) {
+        return;
+    }
+
+    IPAddress ip;
+    ip.fromString(fromIp);
+
+    current = NULL;
+    incoming = NULL;
+
+    Peer* peer = findPeer(ip, fromPort);
+    if (!peer) {
+        peer = addPeer(ip, fromPort);
+    }
+
+    if (!peer) {
+        stats.rejected++;
+        return;
+    }
+
+    peer->lastSeenAt = NOW;
+
+    if (peer->count == SARA_N200_PEER_QUEUE_DEPTH) {
+        stats.overflowed++;
+        peer->stats.overflowed++;
+        return;
+    }
+
+    if (!takeToken(peer)) {
+        stats.rateLimited++;
+        peer->stats.rateLimited++;
+        return;
+    }
+
+    current = peer;
+    incoming = &peer->datagrams[(peer->head + peer->count) % SARA_N200_PEER_QUEUE_DEPTH];
+    incoming->length = 0;
+    truncating = false;
+}
+
+void SaraN200PeerQueue::write(const uint8_t* data, size_t size) {
+    if (!incoming) {
+        return;
+    }
+
+    size_t count = SARA_N200_PEER_MAX_PAYLOAD - incoming->length;
+    if (count > size) {
+        count = size;
+    }
+
+    if (count < size && !truncating) {
+        truncating = true;
+        stats.truncated++;
+        current->stats.truncated++;
+    }
+
+    memcpy(incoming->data + incoming->length, data, count);
+    incoming->length += count;
+}
+
+void SaraN200PeerQueue::end(size_t remaining) {
+    continuing = remaining > 0;
+    if (continuing || !current) {
+        return;
+    }
+
+    current->count++;
+    queued++;
+    stats.received++;
+    current->stats.received++;
+
+    current = NULL;
+    incoming = NULL;
+}
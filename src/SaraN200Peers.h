@@ -0,0 +1,106 @@
+#ifndef SARA_N200_PEERS_H
+#define SARA_N200_PEERS_H
+
+#include <Arduino.h>
+#include "SaraN200.h"
+
+// Senders tracked at a time.
+#ifndef SARA_N200_PEER_COUNT
+#define SARA_N200_PEER_COUNT 4
+#endif
+
+// Datagrams each sender can have waiting.
+#ifndef SARA_N200_PEER_QUEUE_DEPTH
+#define SARA_N200_PEER_QUEUE_DEPTH 2
+#endif
+
+// Longer datagrams are cut to this size.
+#ifndef SARA_N200_PEER_MAX_PAYLOAD
+#define SARA_N200_PEER_MAX_PAYLOAD 128
+#endif
+
+// Sorts downlink datagrams by sender so one chatty peer cannot starve the
+// others: each sender gets its own queue and, optionally, a rate limit, and
+// next() hands out the queued datagrams round robin. Datagrams are decoded
+// off the UART straight into their queue (see SaraN200RecvSink), and those a
+// full queue or the rate limit has no room for are dropped, like UDP would.
+// Typically used through SaraUDP::setPeerQueue().
+class SaraN200PeerQueue : public SaraN200RecvSink {
+public:
+    typedef struct Stats {
+        uint32_t received;    // queued
+        uint32_t delivered;   // handed out by next()
+        uint32_t rateLimited; // dropped, over the sender's rate limit
+        uint32_t overflowed;  // dropped, the sender's queue was full
+        uint32_t rejected;    // dropped, no room to track another sender
+        uint32_t truncated;   // cut to SARA_N200_PEER_MAX_PAYLOAD
+    } Stats;
+
+    SaraN200PeerQueue(SaraN200& modem);
+
+    // Reads what is pending on `socket` into the queues, returns the bytes
+    // read or -1. Stops early, leaving data on the modem, once every queue
+    // is full.
+    int fill(int socket, size_t maxBytes = 0);
+
+    // Takes the next datagram, going round the senders. Returns its length
+    // (bytes past `size` are dropped) or 0 when nothing is queued.
+    int next(uint8_t* buffer, size_t size, IPAddress* remoteIp, uint16_t* remotePort);
+
+    // A sender may send `burst` datagrams back to back and one more every
+    // `interval` ms after that; the rest is dropped. An interval of 0 turns
+    // the limit off.
+    void setRateLimit(uint8_t burst, uint32_t interval);
+
+    void clear();
+
+    size_t getQueued() const { return queued; }
+    size_t getPeerCount() const;
+    const Stats& getStats() const { return stats; }
+    // False when `ip`/`port` is not tracked.
+    bool getPeerStats(IPAddress ip, uint16_t port, Stats* peerStats) const;
+
+    virtual size_t capacity();
+    virtual void begin(int socket, const char* fromIp, uint16_t fromPort, size_t length);
+    virtual void write(const uint8_t* data, size_t size);
+    virtual void end(size_t remaining);
+
+private:
+    typedef struct Datagram {
+        size_t length;
+        uint8_t data[SARA_N200_PEER_MAX_PAYLOAD];
+    } Datagram;
+
+    typedef struct Peer {
+        bool used;
+        IPAddress ip;
+        uint16_t port;
+        uint8_t head;
+        uint8_t count;
+        uint8_t tokens;
+        uint32_t refilledAt;
+        uint32_t lastSeenAt;
+        Stats stats;
+        Datagram datagrams[SARA_N200_PEER_QUEUE_DEPTH];
+    } Peer;
+
+    SaraN200* modem;
+    Peer peers[SARA_N200_PEER_COUNT];
+    size_t queued;
+    size_t nextPeer;
+    uint8_t burst;
+    uint32_t interval;
+    Stats stats;
+
+    // the datagram being decoded, NULL while dropping one
+    Peer* current;
+    Datagram* incoming;
+    bool continuing;
+    bool truncating;
+
+    Peer* findPeer(IPAddress ip, uint16_t port);
+    Peer* addPeer(IPAddress ip, uint16_t port);
+    bool takeToken(Peer* peer);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "SaraN200Ping.h"
+
+#include <string.h>
+
+#define PING_LOST 0xFFFF
+#define PING_MAX_RTT 0xFFFE
+
+SaraN200PingStats::SaraN200PingStats() {
+    reset();
+}
+
+void SaraN200PingStats::reset() {
+    memset(samples, 0, sizeof(samples));
+    head = 0;
+    count = 0;
+    last = 0;
+    totalSent = 0;
+    totalLost = 0;
+}
+
+void SaraN200PingStats::addSample(uint32_t rtt) {
+    last = rtt;
+    add((rtt > PING_MAX_RTT) ? PING_MAX_RTT : static_cast<uint16_t>(rtt));
+}
+
+void SaraN200PingStats::addLoss() {
+    totalLost++;
+    add(PING_LOST);
+}
+
+void SaraN200PingStats::add(uint16_t sample) {
+    samples[head] = sample;
+    head = (head + 1) % SARA_N200_PING_WINDOW;
+    if (count < SARA_N200_PING_WINDOW) {
+        count++;
+    }
+
+    totalSent++;
+}
+
+uint32_t SaraN200PingStats::getMin() const {
+    uint32_t result = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i] != PING_LOST && (result == 0 || samples[i] < result)) {
+            result = samples[i];
+        }
+    }
+
+    return result;
+}
+
+uint32_t SaraN200PingStats::getMean() const {
+    uint32_t sum = 0;
+    size_t answered = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i] != PING_LOST) {
+            sum += samples[i];
+            answered++;
+        }
+    }
+
+    return answered ? sum / answered : 0;
+}
+
+uint32_t SaraN200PingStats::getP95() const {
+    uint16_t sorted[SARA_N200_PING_WINDOW];
+    size_t answered = 0;
+
+    // insertion sort, the window is small
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i] == PING_LOST) {
+            continue;
+        }
+
+        size_t j = answered++;
+        while (j > 0 && sorted[j - 1] > samples[i]) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = samples[i];
+    }
+
+    if (answered == 0) {
+        return 0;
+    }
+
+    // nearest rank
+    size_t rank = (answered * 95 + 99) / 100;
+    return sorted[rank - 1];
+}
+
+uint8_t SaraN200PingStats::getLossRate() const {
+    size_t lost = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i] == PING_LOST) {
+            lost++;
+        }
+    }
+
+    return count ? static_cast<uint8_t>((lost * 100) / count) : 0;
+}
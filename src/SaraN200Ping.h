@@ -0,0 +1,46 @@
+#ifndef SARA_N200_PING_H
+#define SARA_N200_PING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Ping results kept for the rolling statistics.
+#ifndef SARA_N200_PING_WINDOW
+#define SARA_N200_PING_WINDOW 16
+#endif
+
+// Rolling round-trip statistics over the last SARA_N200_PING_WINDOW pings,
+// fed by SaraN200 from the +NPING/+NPINGERR URCs (see SaraN200::setPingStats).
+class SaraN200PingStats {
+public:
+    SaraN200PingStats();
+
+    void addSample(uint32_t rtt);
+    void addLoss();
+    void reset();
+
+    // Pings in the window, answered or not.
+    size_t getCount() const { return count; }
+    // RTT figures in ms over the answered pings, 0 when there are none.
+    uint32_t getMin() const;
+    uint32_t getMean() const;
+    uint32_t getP95() const;
+    uint32_t getLast() const { return last; }
+    // Unanswered pings in the window, in percent.
+    uint8_t getLossRate() const;
+
+    uint32_t getTotalSent() const { return totalSent; }
+    uint32_t getTotalLost() const { return totalLost; }
+
+private:
+    uint16_t samples[SARA_N200_PING_WINDOW]; // ms, PING_LOST when unanswered
+    size_t head;
+    size_t count;
+    uint32_t last;
+    uint32_t totalSent;
+    uint32_t totalLost;
+
+    void add(uint16_t sample);
+};
+
+#endif
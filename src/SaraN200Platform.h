@@ -0,0 +1,187 @@
+#ifndef SARA_N200_PLATFORM_H
+#define SARA_N200_PLATFORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Threading primitives used by SaraN200Worker. FreeRTOS is picked on ESP-IDF /
+// arduino-esp32, std::thread on Linux hosts. Other targets build without them.
+
+#if defined(ESP_PLATFORM)
+#define SARA_N200_THREADS_FREERTOS
+#elif defined(SARA_N200_POSIX) || (defined(__linux__) && !defined(ARDUINO))
+#define SARA_N200_THREADS_STD
+#endif
+
+#if defined(SARA_N200_THREADS_FREERTOS) || defined(SARA_N200_THREADS_STD)
+#define SARA_N200_HAS_THREADS 1
+#endif
+
+#define SARA_N200_WAIT_FOREVER 0xFFFFFFFFUL
+
+#if defined(SARA_N200_THREADS_FREERTOS)
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+namespace SaraN200Platform {
+
+class Mutex {
+public:
+    Mutex() { handle = xSemaphoreCreateMutexStatic(&buffer); }
+    ~Mutex() { vSemaphoreDelete(handle); }
+
+    void lock() { xSemaphoreTake(handle, portMAX_DELAY); }
+    void unlock() { xSemaphoreGive(handle); }
+
+private:
+    StaticSemaphore_t buffer;
+    SemaphoreHandle_t handle;
+};
+
+// Binary signal: notify() wakes one wait(), repeated notifications collapse.
+class Signal {
+public:
+    Signal() { handle = xSemaphoreCreateBinaryStatic(&buffer); }
+    ~Signal() { vSemaphoreDelete(handle); }
+
+    bool wait(uint32_t timeout = SARA_N200_WAIT_FOREVER) {
+        TickType_t ticks = (timeout == SARA_N200_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout);
+        return xSemaphoreTake(handle, ticks) == pdTRUE;
+    }
+
+    void notify() { xSemaphoreGive(handle); }
+
+private:
+    StaticSemaphore_t buffer;
+    SemaphoreHandle_t handle;
+};
+
+class Thread {
+public:
+    typedef void (*Entry)(void* arg);
+
+    Thread() : entry(0), arg(0), handle(0) {}
+
+    bool start(Entry entry, void* arg, const char* name, uint32_t stackSize, int priority) {
+        this->entry = entry;
+        this->arg = arg;
+
+        return xTaskCreate(trampoline, name, stackSize, this, priority, &handle) == pdPASS;
+    }
+
+    void join() {
+        if (handle) {
+            finished.wait();
+            handle = 0;
+        }
+    }
+
+private:
+    Entry entry;
+    void* arg;
+    TaskHandle_t handle;
+    Signal finished;
+
+    static void trampoline(void* self) {
+        Thread* thread = static_cast<Thread*>(self);
+        thread->entry(thread->arg);
+        thread->finished.notify();
+        vTaskDelete(NULL);
+    }
+};
+
+} // namespace SaraN200Platform
+
+#elif defined(SARA_N200_THREADS_STD)
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace SaraN200Platform {
+
+class Mutex {
+public:
+    void lock() { handle.lock(); }
+    void unlock() { handle.unlock(); }
+
+private:
+    std::mutex handle;
+};
+
+// Binary signal: notify() wakes one wait(), repeated notifications collapse.
+class Signal {
+public:
+    Signal() : flag(false) {}
+
+    bool wait(uint32_t timeout = SARA_N200_WAIT_FOREVER) {
+        std::unique_lock<std::mutex> guard(mutex);
+
+        if (timeout == SARA_N200_WAIT_FOREVER) {
+            condition.wait(guard, [this] { return flag; });
+        } else if (!condition.wait_for(guard, std::chrono::milliseconds(timeout), [this] { return flag; })) {
+            return false;
+        }
+
+        flag = false;
+        return true;
+    }
+
+    void notify() {
+        std::lock_guard<std::mutex> guard(mutex);
+        flag = true;
+        condition.notify_one();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool flag;
+};
+
+class Thread {
+public:
+    typedef void (*Entry)(void* arg);
+
+    // name, stack size and priority only apply to FreeRTOS tasks
+    bool start(Entry entry, void* arg, const char* name, uint32_t stackSize, int priority) {
+        handle = std::thread(entry, arg);
+        return true;
+    }
+
+    void join() {
+        if (handle.joinable()) {
+            handle.join();
+        }
+    }
+
+private:
+    std::thread handle;
+};
+
+} // namespace SaraN200Platform
+
+#endif
+
+#ifdef SARA_N200_HAS_THREADS
+namespace SaraN200Platform {
+
+class LockGuard {
+public:
+    LockGuard(Mutex& mutex) : mutex(mutex) { mutex.lock(); }
+    ~LockGuard() { mutex.unlock(); }
+
+private:
+    Mutex& mutex;
+
+    LockGuard(const LockGuard&);
+    LockGuard& operator=(const LockGuard&);
+};
+
+} // namespace SaraN200Platform
+#endif
+
+#endif
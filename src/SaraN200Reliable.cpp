@@ -0,0 +1,325 @@
+#include "SaraN200Reliable.h"
+
+#define PACKET_TYPE_DATA 0x01
+#define PACKET_TYPE_ACK 0x02
+
+#define INITIAL_RTO 3000
+#define MIN_RTO 1000
+#define MAX_RTO 60000
+#define DEFAULT_MAX_RETRIES 5
+
+#define NOW (uint32_t)millis()
+
+static inline void putUint16(uint8_t* buffer, uint16_t value) {
+    buffer[0] = value >> 8;
+    buffer[1] = value & 0xFF;
+}
+
+static inline uint16_t getUint16(const uint8_t* buffer) {
+    return (static_cast<uint16_t>(buffer[0]) << 8) | buffer[1];
+}
+
+SaraReliableUDP::SaraReliableUDP(SaraUDPBase& udp, Slot* slots, uint8_t* payloads, size_t windowSize, size_t maxPayload, uint8_t* packet):
+ udp(&udp),
+ peerPort(0),
+ slots(slots),
+ payloads(payloads),
+ windowSize(windowSize),
+ maxPayload(maxPayload),
+ packet(packet),
+ inFlight(0),
+ epoch(0),
+ peerEpoch(0),
+ hasPeerEpoch(false),
+ nextSequence(0),
+ rxNext(0),
+ rxMask(0),
+ ackPending(false),
+ srtt(0),
+ rttvar(0),
+ rto(INITIAL_RTO),
+ hasRttSample(false),
+ maxRetries(DEFAULT_MAX_RETRIES),
+ receiveCallback(0),
+ receiveParam(0),
+ statusCallback(0),
+ statusParam(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void SaraReliableUDP::begin(IPAddress ip, uint16_t port) {
+    peerIp = ip;
+    peerPort = port;
+
+    for (size_t i = 0; i < windowSize; i++) {
+        slots[i].used = false;
+    }
+
+    inFlight = 0;
+    nextSequence = 0;
+    hasPeerEpoch = false;
+    ackPending = false;
+
+    // a new epoch tells the peer to restart its receive window at sequence 0
+    epoch = static_cast<uint8_t>(micros() ^ (micros() >> 8));
+    if (epoch == 0) {
+        epoch = 1;
+    }
+
+    // opens the socket so that poll() can receive before the first send
+    udp->beginPacket(ip, port);
+}
+
+void SaraReliableUDP::setReceiveCallback(ReceiveCallback callback, void* param) {
+    receiveCallback = callback;
+    receiveParam = param;
+}
+
+void SaraReliableUDP::setStatusCallback(StatusCallback callback, void* param) {
+    statusCallback = callback;
+    statusParam = param;
+}
+
+bool SaraReliableUDP::canSend() const {
+    // the receiver only tracks SARA_RELIABLE_SACK_BITS past its next sequence
+    uint16_t span = nextSequence - getOldestSequence();
+
+    return inFlight < windowSize && span < SARA_RELIABLE_SACK_BITS;
+}
+
+uint16_t SaraReliableUDP::getOldestSequence() const {
+    uint16_t oldest = nextSequence;
+
+    for (size_t i = 0; i < windowSize; i++) {
+        if (slots[i].used && static_cast<int16_t>(slots[i].sequence - oldest) < 0) {
+            oldest = slots[i].sequence;
+        }
+    }
+
+    return oldest;
+}
+
+int SaraReliableUDP::send(const uint8_t* data, size_t size) {
+    if (size > maxPayload || !canSend()) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < windowSize; i++) {
+        Slot& slot = slots[i];
+        if (slot.used) {
+            continue;
+        }
+
+        slot.used = true;
+        slot.sequence = nextSequence++;
+        slot.length = size;
+        slot.retries = 0;
+        memcpy(payloads + i * maxPayload, data, size);
+        inFlight++;
+
+        // a failed write is retried by the retransmission timer
+        transmit(slot);
+        stats.sent++;
+
+        return slot.sequence;
+    }
+
+    return -1;
+}
+
+bool SaraReliableUDP::transmit(Slot& slot) {
+    size_t index = &slot - slots;
+
+    packet[0] = PACKET_TYPE_DATA;
+    packet[1] = epoch;
+    putUint16(packet + 2, slot.sequence);
+    putUint16(packet + 4, getOldestSequence());
+    putUint16(packet + 6, 0);
+    memcpy(packet + SARA_RELIABLE_HEADER_SIZE, payloads + index * maxPayload, slot.length);
+
+    slot.sentAt = NOW;
+
+    if (!udp->beginPacket(peerIp, peerPort)) {
+        return false;
+    }
+
+    udp->write(packet, SARA_RELIABLE_HEADER_SIZE + slot.length);
+    return udp->endPacket() == 1;
+}
+
+void SaraReliableUDP::sendAck() {
+    packet[0] = PACKET_TYPE_ACK;
+    packet[1] = peerEpoch;
+    putUint16(packet + 2, 0);
+    putUint16(packet + 4, rxNext);
+    putUint16(packet + 6, rxMask);
+
+    if (udp->beginPacket(peerIp, peerPort)) {
+        udp->write(packet, SARA_RELIABLE_HEADER_SIZE);
+        if (udp->endPacket() == 1) {
+            ackPending = false;
+            stats.acksSent++;
+        }
+    }
+}
+
+void SaraReliableUDP::poll() {
+    int length;
+
+    while ((length = udp->parsePacket()) > 0) {
+        size_t size = udp->read(packet, maxPayload + SARA_RELIABLE_HEADER_SIZE);
+        udp->flush();
+
+        if (size < SARA_RELIABLE_HEADER_SIZE) {
+            continue;
+        }
+
+        uint8_t packetEpoch = packet[1];
+
+        if (packet[0] == PACKET_TYPE_DATA) {
+            if (!hasPeerEpoch || packetEpoch != peerEpoch) {
+                // the peer (re)started, so did its sequence numbers
+                peerEpoch = packetEpoch;
+                hasPeerEpoch = true;
+                rxNext = 0;
+                rxMask = 0;
+            }
+
+            handleData(getUint16(packet + 2), getUint16(packet + 4), packet + SARA_RELIABLE_HEADER_SIZE, size - SARA_RELIABLE_HEADER_SIZE);
+        } else if (packet[0] == PACKET_TYPE_ACK && packetEpoch == epoch) {
+            handleAck(getUint16(packet + 4), getUint16(packet + 6));
+        }
+    }
+
+    // one acknowledgement covers everything received in this poll
+    if (ackPending) {
+        sendAck();
+    }
+
+    bool backoff = false;
+    for (size_t i = 0; i < windowSize; i++) {
+        Slot& slot = slots[i];
+        if (!slot.used || (NOW - slot.sentAt) < rto) {
+            continue;
+        }
+
+        if (slot.retries >= maxRetries) {
+            release(slot, false);
+            continue;
+        }
+
+        slot.retries++;
+        transmit(slot);
+        stats.retransmitted++;
+        backoff = true;
+    }
+
+    if (backoff) {
+        rto = (2 * rto > MAX_RTO) ? MAX_RTO : 2 * rto;
+    }
+}
+
+void SaraReliableUDP::handleData(uint16_t sequence, uint16_t oldest, const uint8_t* data, size_t size) {
+    ackPending = true;
+
+    // the sender gave up on everything before `oldest`, stop waiting for it
+    if (static_cast<int16_t>(sequence - oldest) >= 0 && static_cast<int16_t>(oldest - rxNext) > 0) {
+        advanceTo(oldest);
+    }
+
+    int16_t distance = static_cast<int16_t>(sequence - rxNext);
+
+    if (distance < 0 || distance > SARA_RELIABLE_SACK_BITS) {
+        // already delivered, or too far ahead to track: only re-acknowledge
+        if (distance < 0) {
+            stats.duplicates++;
+        }
+        return;
+    }
+
+    if (distance > 0) {
+        uint16_t bit = 1 << (distance - 1);
+        if (rxMask & bit) {
+            stats.duplicates++;
+            return;
+        }
+
+        rxMask |= bit;
+    } else {
+        advanceTo(rxNext + 1);
+    }
+
+    stats.received++;
+
+    if (receiveCallback) {
+        receiveCallback(data, size, receiveParam);
+    }
+}
+
+void SaraReliableUDP::advanceTo(uint16_t sequence) {
+    // moves past `sequence` too while it was already received out of order
+    while (static_cast<int16_t>(sequence - rxNext) > 0) {
+        bool received = rxMask & 1;
+        rxMask >>= 1;
+        rxNext++;
+
+        if (received && rxNext == sequence) {
+            sequence++;
+        }
+    }
+}
+
+void SaraReliableUDP::handleAck(uint16_t ack, uint16_t sack) {
+    for (size_t i = 0; i < windowSize; i++) {
+        Slot& slot = slots[i];
+        if (!slot.used) {
+            continue;
+        }
+
+        int16_t distance = static_cast<int16_t>(slot.sequence - ack);
+        bool acked = (distance < 0) || (distance >= 1 && distance <= SARA_RELIABLE_SACK_BITS && (sack & (1 << (distance - 1))));
+
+        if (acked) {
+            // Karn: retransmitted datagrams give ambiguous samples
+            if (slot.retries == 0) {
+                addRttSample(NOW - slot.sentAt);
+            }
+
+            release(slot, true);
+        }
+    }
+}
+
+void SaraReliableUDP::release(Slot& slot, bool delivered) {
+    slot.used = false;
+    inFlight--;
+
+    if (delivered) {
+        stats.delivered++;
+    } else {
+        stats.failed++;
+    }
+
+    if (statusCallback) {
+        statusCallback(slot.sequence, delivered, statusParam);
+    }
+}
+
+void SaraReliableUDP::addRttSample(uint32_t rtt) {
+    if (!hasRttSample) {
+        srtt = rtt;
+        rttvar = rtt / 2;
+        hasRttSample = true;
+    } else {
+        uint32_t delta = (srtt > rtt) ? (srtt - rtt) : (rtt - srtt);
+        rttvar = (3 * rttvar + delta) / 4;
+        srtt = (7 * srtt + rtt) / 8;
+    }
+
+    rto = srtt + 4 * rttvar;
+    if (rto < MIN_RTO) {
+        rto = MIN_RTO;
+    } else if (rto > MAX_RTO) {
+        rto = MAX_RTO;
+    }
+}
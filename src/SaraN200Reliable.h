@@ -0,0 +1,129 @@
+#ifndef SARA_N200_RELIABLE_H
+#define SARA_N200_RELIABLE_H
+
+#include <Arduino.h>
+#include "SaraN200Udp.h"
+
+#define SARA_RELIABLE_HEADER_SIZE 8
+#define SARA_RELIABLE_SACK_BITS 16
+
+// Optional reliable delivery on top of SaraUDP for a single peer.
+//
+// Every datagram starts with an 8-byte header:
+//   type (DATA/ACK), session epoch, sequence, cumulative ack, SACK bitmap
+// The cumulative ack is the next sequence the receiver expects; bit i of the
+// SACK bitmap acknowledges sequence ack + 1 + i. In DATA datagrams the ack
+// field carries the oldest sequence the sender still retries instead, so the
+// receiver can skip datagrams the sender gave up on.
+//
+// Up to the window size of DATA datagrams are in flight at once, and never
+// more than the SACK bitmap covers past the oldest one. Each has a
+// retransmission timer derived from the measured round-trip time (Karn's
+// algorithm, RFC 6298). Received datagrams are delivered once, as they
+// arrive, through a callback.
+class SaraReliableUDP {
+public:
+    typedef void (*ReceiveCallback)(const uint8_t* data, size_t size, void* param);
+    typedef void (*StatusCallback)(uint16_t sequence, bool delivered, void* param);
+
+    typedef struct ReliableStats {
+        uint32_t sent;
+        uint32_t retransmitted;
+        uint32_t delivered;
+        uint32_t failed;
+        uint32_t received;
+        uint32_t duplicates;
+        uint32_t acksSent;
+    } ReliableStats;
+
+    void begin(IPAddress ip, uint16_t port);
+
+    // Queues and transmits `data`. Returns its sequence number, or -1 when the
+    // window is full or the payload is too large.
+    int send(const uint8_t* data, size_t size);
+
+    // Receives and acknowledges incoming datagrams and runs the retransmission
+    // timers. Call it from the main loop.
+    void poll();
+
+    bool canSend() const;
+    size_t getInFlight() const { return inFlight; }
+    size_t getMaxPayload() const { return maxPayload; }
+    uint32_t getRetransmitTimeout() const { return rto; }
+    // Changes with every begin(), the peer restarts its receive window then.
+    uint8_t getEpoch() const { return epoch; }
+    const ReliableStats& getStats() const { return stats; }
+
+    void setReceiveCallback(ReceiveCallback callback, void* param);
+    void setStatusCallback(StatusCallback callback, void* param);
+    void setMaxRetries(uint8_t value) { maxRetries = value; }
+
+protected:
+    typedef struct Slot {
+        bool used;
+        uint16_t sequence;
+        uint16_t length;
+        uint8_t retries;
+        uint32_t sentAt;
+    } Slot;
+
+    SaraReliableUDP(SaraUDPBase& udp, Slot* slots, uint8_t* payloads, size_t windowSize, size_t maxPayload, uint8_t* packet);
+
+private:
+    SaraUDPBase* udp;
+    IPAddress peerIp;
+    uint16_t peerPort;
+
+    Slot* slots;
+    uint8_t* payloads;
+    size_t windowSize;
+    size_t maxPayload;
+    uint8_t* packet; // maxPayload + header bytes of scratch for TX and RX
+    size_t inFlight;
+
+    uint8_t epoch;
+    uint8_t peerEpoch;
+    bool hasPeerEpoch;
+    uint16_t nextSequence;
+    uint16_t rxNext;
+    uint16_t rxMask;
+    bool ackPending;
+
+    uint32_t srtt;
+    uint32_t rttvar;
+    uint32_t rto;
+    bool hasRttSample;
+    uint8_t maxRetries;
+
+    ReceiveCallback receiveCallback;
+    void* receiveParam;
+    StatusCallback statusCallback;
+    void* statusParam;
+
+    ReliableStats stats;
+
+    bool transmit(Slot& slot);
+    void sendAck();
+    uint16_t getOldestSequence() const;
+    void handleData(uint16_t sequence, uint16_t oldest, const uint8_t* data, size_t size);
+    void advanceTo(uint16_t sequence);
+    void handleAck(uint16_t ack, uint16_t sack);
+    void release(Slot& slot, bool delivered);
+    void addRttSample(uint32_t rtt);
+};
+
+template<size_t WindowSize = 4, size_t MaxPayload = SARA_N200_MAX_DATAGRAM_SIZE - SARA_RELIABLE_HEADER_SIZE>
+class SaraReliableUDPStatic : public SaraReliableUDP {
+public:
+    static_assert(WindowSize >= 1 && WindowSize <= SARA_RELIABLE_SACK_BITS, "SARA-N200: window must fit the SACK bitmap");
+    static_assert(MaxPayload + SARA_RELIABLE_HEADER_SIZE <= SARA_N200_MAX_DATAGRAM_SIZE, "SARA-N200: payload plus header exceeds a datagram");
+
+    SaraReliableUDPStatic(SaraUDPBase& udp) : SaraReliableUDP(udp, slotStorage, payloadStorage, WindowSize, MaxPayload, packetStorage) {}
+
+private:
+    Slot slotStorage[WindowSize];
+    uint8_t payloadStorage[WindowSize * MaxPayload];
+    uint8_t packetStorage[MaxPayload + SARA_RELIABLE_HEADER_SIZE];
+};
+
+#endif
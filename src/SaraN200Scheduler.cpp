@@ -0,0 +1,210 @@
+#include "SaraN200Scheduler.h"
+
+#define NOW (uint32_t)millis()
+
+#define ECL_UNKNOWN -1
+
+SaraN200Scheduler::SaraN200Scheduler(SaraN200& modem):
+ modem(&modem),
+ queued(0),
+ deadlineGuard(5000),
+ refreshInterval(10000),
+ lastRefreshAt(0) {
+    for (size_t i = 0; i < SARA_N200_SCHEDULER_DEPTH; i++) {
+        messages[i].used = false;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+
+    setThreshold(PriorityUrgent, -128, 2);
+    setThreshold(PriorityNormal, -110, 1);
+    setThreshold(PriorityLow, -100, 0);
+}
+
+void SaraN200Scheduler::setThreshold(SchedulerPriority priority, int8_t minRssi, uint8_t maxEcl) {
+    if (priority < PriorityCount) {
+        thresholds[priority].minRssi = minRssi;
+        thresholds[priority].maxEcl = maxEcl;
+    }
+}
+
+int16_t SaraN200Scheduler::currentEcl() const {
+    SaraN200::SignalQuality quality;
+
+    if (!modem->getSignalQuality(&quality) || !quality.extended) {
+        return ECL_UNKNOWN;
+    }
+
+    return quality.ecl;
+}
+
+bool SaraN200Scheduler::linkAllows(uint8_t priority) const {
+    SaraN200::SignalQuality quality;
+
+    // no use trying while +CEREG says there is no service
+    if (modem->getRegistration().valid && !modem->isRegistered()) {
+        return false;
+    }
+
+    // rssi 0 means +CSQ found no signal at all
+    if (!modem->getSignalQuality(&quality) || quality.rssi == 0) {
+        return false;
+    }
+
+    if (quality.rssi < thresholds[priority].minRssi) {
+        return false;
+    }
+
+    return !quality.extended || quality.ecl <= thresholds[priority].maxEcl;
+}
+
+bool SaraN200Scheduler::send(int socket, IPAddress ip, uint16_t port, const uint8_t* data, size_t size,
+                             SchedulerPriority priority, uint32_t deadline) {
+    if (priority >= PriorityCount) {
+        return false;
+    }
+
+    // nothing waiting ahead of it, don't queue what can go now
+    if (priority == PriorityUrgent || (queued == 0 && linkAllows(priority))) {
+        if (modem->socketSendTo(socket, ip, port, const_cast<uint8_t*>(data), size) < 0) {
+            if (priority == PriorityUrgent) {
+                stats.failed++;
+                return false;
+            }
+        } else {
+            stats.sent++;
+            stats.sentImmediately++;
+            return true;
+        }
+    }
+
+    if (size > SARA_N200_SCHEDULER_MAX_PAYLOAD) {
+        return false;
+    }
+
+    for (size_t i = 0; i < SARA_N200_SCHEDULER_DEPTH; i++) {
+        Message* message = &messages[i];
+        if (message->used) {
+            continue;
+        }
+
+        message->used = true;
+        message->priority = priority;
+        message->socket = socket;
+        message->ip = ip;
+        message->port = port;
+        message->queuedAt = NOW;
+        message->deadline = deadline;
+        message->arrivalEcl = currentEcl();
+        message->size = size;
+        memcpy(message->data, data, size);
+
+        queued++;
+        stats.deferred++;
+
+        return true;
+    }
+
+    return false;
+}
+
+SaraN200Scheduler::Message* SaraN200Scheduler::next() {
+    Message* best = NULL;
+    int32_t bestRemaining = 0;
+
+    for (size_t i = 0; i < SARA_N200_SCHEDULER_DEPTH; i++) {
+        Message* message = &messages[i];
+        if (!message->used) {
+            continue;
+        }
+
+        int32_t remaining = static_cast<int32_t>(message->queuedAt + message->deadline - NOW);
+        bool due = remaining <= static_cast<int32_t>(deadlineGuard);
+        if (!due && !linkAllows(message->priority)) {
+            continue;
+        }
+
+        // highest priority first, then the closest deadline
+        if (!best || message->priority < best->priority || (message->priority == best->priority && remaining < bestRemaining)) {
+            best = message;
+            bestRemaining = remaining;
+        }
+    }
+
+    return best;
+}
+
+void SaraN200Scheduler::poll() {
+    if (queued == 0) {
+        return;
+    }
+
+    SaraN200::SignalQuality quality;
+    uint32_t age = 0;
+    bool cached = modem->getSignalQuality(&quality, &age);
+
+    if ((!cached || age > refreshInterval) && (NOW - lastRefreshAt > refreshInterval)) {
+        lastRefreshAt = NOW;
+        modem->refreshSignalQuality(true);
+    }
+
+    Message* message;
+    while ((message = next()) != NULL) {
+        bool forced = !linkAllows(message->priority);
+
+        if (!transmit(message, forced)) {
+            // the link is down, keep the rest for the next poll
+            break;
+        }
+    }
+}
+
+bool SaraN200Scheduler::transmit(Message* message, bool forced) {
+    int32_t remaining = static_cast<int32_t>(message->queuedAt + message->deadline - NOW);
+
+    if (modem->socketSendTo(message->socket, message->ip, message->port, message->data, message->size) < 0) {
+        // retried on the next poll until the deadline has passed
+        if (remaining < 0) {
+            message->used = false;
+            queued--;
+            stats.failed++;
+        }
+
+        return false;
+    }
+
+    uint32_t deferral = NOW - message->queuedAt;
+
+    stats.sent++;
+    stats.totalDeferral += deferral;
+    if (deferral > stats.maxDeferral) {
+        stats.maxDeferral = deferral;
+    }
+
+    if (forced) {
+        stats.forced++;
+    }
+
+    if (remaining < 0) {
+        stats.late++;
+    }
+
+    account(message->size, message->arrivalEcl);
+
+    message->used = false;
+    queued--;
+
+    return true;
+}
+
+void SaraN200Scheduler::account(size_t size, int16_t arrivalEcl) {
+    const SaraN200Accounting* accounting = modem->getAccounting();
+    int16_t ecl = currentEcl();
+
+    if (!accounting || arrivalEcl == ECL_UNKNOWN || ecl == ECL_UNKNOWN) {
+        return;
+    }
+
+    stats.energySaved += static_cast<int32_t>(accounting->estimateSendEnergy(size, arrivalEcl))
+                       - static_cast<int32_t>(accounting->estimateSendEnergy(size, ecl));
+}
@@ -0,0 +1,98 @@
+#ifndef SARA_N200_SCHEDULER_H
+#define SARA_N200_SCHEDULER_H
+
+#include <Arduino.h>
+#include "SaraN200.h"
+
+// Messages the scheduler can hold back at a time.
+#ifndef SARA_N200_SCHEDULER_DEPTH
+#define SARA_N200_SCHEDULER_DEPTH 8
+#endif
+
+#ifndef SARA_N200_SCHEDULER_MAX_PAYLOAD
+#define SARA_N200_SCHEDULER_MAX_PAYLOAD 128
+#endif
+
+typedef enum {
+    PriorityUrgent = 0, // sent at once whatever the link
+    PriorityNormal,
+    PriorityLow,
+    PriorityCount
+} SchedulerPriority;
+
+// Holds back uplink datagrams while coverage is poor. A message waits until
+// the signal quality cache (+CSQ RSSI and, once known, the NUESTATS coverage
+// class) passes the threshold of its priority, or until its deadline is
+// close, and then goes out through socketSendTo(). Urgent messages never wait.
+// With SaraN200::setRegistrationUrcEnabled() nothing else goes out while the
+// module has no service.
+class SaraN200Scheduler {
+public:
+    typedef struct Threshold {
+        int8_t minRssi; // dBm
+        uint8_t maxEcl;
+    } Threshold;
+
+    typedef struct Stats {
+        uint32_t sent;
+        uint32_t sentImmediately; // the link was good enough on arrival
+        uint32_t deferred;        // held back at least once
+        uint32_t forced;          // sent in poor coverage because of the deadline
+        uint32_t late;            // sent after the deadline
+        uint32_t failed;          // dropped after failing past the deadline
+        uint32_t totalDeferral;   // ms, over the deferred messages
+        uint32_t maxDeferral;     // ms
+        int32_t energySaved;      // mJ versus sending on arrival, needs SaraN200::setAccounting()
+    } Stats;
+
+    SaraN200Scheduler(SaraN200& modem);
+
+    // `deadline` is in ms from now. Returns false when the message is too
+    // large, the queue is full or an urgent send failed.
+    bool send(int socket, IPAddress ip, uint16_t port, const uint8_t* data, size_t size,
+              SchedulerPriority priority = PriorityNormal, uint32_t deadline = 60000);
+
+    // Refreshes the signal quality while messages are waiting and sends
+    // those the link or their deadline allows. Call it from the main loop.
+    void poll();
+
+    void setThreshold(SchedulerPriority priority, int8_t minRssi, uint8_t maxEcl);
+    // Messages go out this long before their deadline, whatever the link.
+    void setDeadlineGuard(uint32_t guard) { deadlineGuard = guard; }
+    // How often poll() re-reads the signal quality while messages wait.
+    void setRefreshInterval(uint32_t interval) { refreshInterval = interval; }
+
+    size_t getQueued() const { return queued; }
+    const Stats& getStats() const { return stats; }
+
+private:
+    typedef struct Message {
+        bool used;
+        uint8_t priority;
+        int socket;
+        IPAddress ip;
+        uint16_t port;
+        uint32_t queuedAt;
+        uint32_t deadline; // ms after queuedAt
+        int16_t arrivalEcl; // -1 when unknown
+        size_t size;
+        uint8_t data[SARA_N200_SCHEDULER_MAX_PAYLOAD];
+    } Message;
+
+    SaraN200* modem;
+    Message messages[SARA_N200_SCHEDULER_DEPTH];
+    size_t queued;
+    Threshold thresholds[PriorityCount];
+    uint32_t deadlineGuard;
+    uint32_t refreshInterval;
+    uint32_t lastRefreshAt;
+    Stats stats;
+
+    bool linkAllows(uint8_t priority) const;
+    int16_t currentEcl() const;
+    Message* next();
+    bool transmit(Message* message, bool forced);
+    void account(size_t size, int16_t arrivalEcl);
+};
+
+#endif
@@ -0,0 +1,458 @@
+#include "SaraN200Store.h"
+
+#if defined(SARA_N200_POSIX) || (defined(__linux__) && !defined(ARDUINO))
+#include <unistd.h>
+#endif
+
+#define NOW (uint32_t)millis()
+
+// Record layout, little endian:
+//   0 magic, 1 state, 2 length, 4 sequence, 8 ip, 12 port, 14 crc16,
+//   16 payload, padded to 4 bytes.
+// The CRC covers bytes 2..13 and the payload. The state byte is left out so
+// a record can be marked sent in place, which on flash only clears bits.
+#define RECORD_MAGIC 0xA5
+#define RECORD_PENDING 0xFF
+#define RECORD_SENT 0x00
+#define RECORD_WRAP 0xFFFF // length of the marker that sends readers back to offset 0
+#define HEADER_SIZE 16
+#define RECORD_SIZE(length) ((HEADER_SIZE + (length) + 3) & ~static_cast<uint32_t>(3))
+
+static inline bool is_timedout(uint32_t from, uint32_t nr_ms) __attribute__((always_inline));
+static inline bool is_timedout(uint32_t from, uint32_t nr_ms)
+{
+    return (millis() - from) > nr_ms;
+}
+
+static uint16_t crc16(uint16_t crc, const uint8_t* data, size_t size) {
+    // CRC-16/CCITT-FALSE
+    while (size--) {
+        crc ^= static_cast<uint16_t>(*data++) << 8;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static uint16_t getU16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static uint32_t getU32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+static void putU16(uint8_t* p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static void putU32(uint8_t* p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+
+bool SaraN200RamStorage::read(uint32_t offset, void* data, size_t size) {
+    if (offset + size > bufferSize) {
+        return false;
+    }
+
+    memcpy(data, buffer + offset, size);
+    return true;
+}
+
+bool SaraN200RamStorage::write(uint32_t offset, const void* data, size_t size) {
+    if (offset + size > bufferSize) {
+        return false;
+    }
+
+    memcpy(buffer + offset, data, size);
+    return true;
+}
+
+#if defined(ESP_PLATFORM)
+bool SaraN200FlashStorage::read(uint32_t offset, void* data, size_t size) {
+    return esp_partition_read(partition, offset, data, size) == ESP_OK;
+}
+
+bool SaraN200FlashStorage::write(uint32_t offset, const void* data, size_t size) {
+    return esp_partition_write(partition, offset, data, size) == ESP_OK;
+}
+
+bool SaraN200FlashStorage::erase(uint32_t offset, size_t size) {
+    return esp_partition_erase_range(partition, offset, size) == ESP_OK;
+}
+#endif
+
+#if defined(SARA_N200_POSIX) || (defined(__linux__) && !defined(ARDUINO))
+SaraN200FileStorage::SaraN200FileStorage(const char* path, size_t size):
+ file(fopen(path, "r+b")),
+ fileSize(size) {
+    if (!file) {
+        file = fopen(path, "w+b");
+    }
+}
+
+SaraN200FileStorage::~SaraN200FileStorage() {
+    if (file) {
+        fclose(file);
+    }
+}
+
+bool SaraN200FileStorage::read(uint32_t offset, void* data, size_t size) {
+    if (!file || offset + size > fileSize || fseek(file, offset, SEEK_SET) != 0) {
+        return false;
+    }
+
+    // the file grows as records are written, the part past its end reads as 0
+    size_t count = fread(data, 1, size, file);
+    memset(static_cast<uint8_t*>(data) + count, 0, size - count);
+
+    return true;
+}
+
+bool SaraN200FileStorage::write(uint32_t offset, const void* data, size_t size) {
+    if (!file || offset + size > fileSize || fseek(file, offset, SEEK_SET) != 0) {
+        return false;
+    }
+
+    return fwrite(data, 1, size, file) == size;
+}
+
+bool SaraN200FileStorage::sync() {
+    return file && fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+#endif
+
+SaraN200Store::SaraN200Store(SaraN200& modem, SaraN200Storage& storage):
+ modem(&modem),
+ storage(&storage),
+ capacity(storage.size() & ~static_cast<size_t>(3)),
+ eraseSize(storage.eraseSize()),
+ head(0),
+ tail(0),
+ count(0),
+ sequence(0),
+ datagramsPerSecond(0),
+ retryInterval(10000),
+ lastSendAt(0),
+ lastFailureAt(0),
+ failed(false),
+ dropped(0),
+ sent(0) {}
+
+bool SaraN200Store::begin() {
+    bool found = false;
+    bool foundPending = false;
+    uint32_t lastSequence = 0;
+    uint32_t oldestPending = 0;
+
+    head = 0;
+    tail = 0;
+    count = 0;
+
+    for (uint32_t offset = 0; offset + HEADER_SIZE <= capacity; ) {
+        Record record;
+        if (!readRecord(offset, &record, true)) {
+            offset += 4;
+            continue;
+        }
+
+        if (record.length == RECORD_WRAP) {
+            offset += HEADER_SIZE;
+            continue;
+        }
+
+        // sequence numbers may wrap around, compare by difference
+        if (!found || static_cast<int32_t>(record.sequence - lastSequence) > 0) {
+            lastSequence = record.sequence;
+            head = offset + RECORD_SIZE(record.length);
+            found = true;
+        }
+
+        if (record.state == RECORD_PENDING) {
+            count++;
+            if (!foundPending || static_cast<int32_t>(record.sequence - oldestPending) < 0) {
+                oldestPending = record.sequence;
+                tail = offset;
+                foundPending = true;
+            }
+        }
+
+        offset += RECORD_SIZE(record.length);
+    }
+
+    sequence = found ? lastSequence + 1 : 0;
+
+    // A record torn by a power loss may follow the head. Flash cannot be
+    // written over without an erase, so continue at the next block.
+    if (eraseSize && (head % eraseSize)) {
+        uint32_t blockEnd = head - (head % eraseSize) + eraseSize;
+        uint8_t value = 0xFF;
+
+        for (uint32_t offset = head; offset < blockEnd && offset < capacity && value == 0xFF; offset++) {
+            if (!storage->read(offset, &value, 1)) {
+                return false;
+            }
+        }
+
+        if (value != 0xFF) {
+            head = (blockEnd < capacity) ? blockEnd : 0;
+        }
+    }
+
+    if (count == 0) {
+        tail = head;
+    }
+
+    return true;
+}
+
+bool SaraN200Store::readRecord(uint32_t offset, Record* record, bool checkPayload) {
+    uint8_t header[HEADER_SIZE];
+
+    if (offset + HEADER_SIZE > capacity || !storage->read(offset, header, HEADER_SIZE) || header[0] != RECORD_MAGIC) {
+        return false;
+    }
+
+    record->state = header[1];
+    record->length = getU16(header + 2);
+
+    if (record->length == RECORD_WRAP) {
+        return true;
+    }
+
+    if (record->length > SARA_N200_MAX_DATAGRAM_SIZE || RECORD_SIZE(record->length) > capacity - offset) {
+        return false;
+    }
+
+    record->sequence = getU32(header + 4);
+    record->ip = IPAddress(header[8], header[9], header[10], header[11]);
+    record->port = getU16(header + 12);
+
+    if (!checkPayload) {
+        return true;
+    }
+
+    if (!storage->read(offset + HEADER_SIZE, payload, record->length)) {
+        return false;
+    }
+
+    uint16_t crc = crc16(0xFFFF, header + 2, 12);
+    crc = crc16(crc, payload, record->length);
+
+    return crc == getU16(header + 14);
+}
+
+uint32_t SaraN200Store::nextRecord(uint32_t offset, size_t length) {
+    uint32_t next = offset + RECORD_SIZE(length);
+
+    if (next == head) {
+        return next;
+    }
+
+    if (capacity - next < HEADER_SIZE) {
+        return 0;
+    }
+
+    Record record;
+    if (!readRecord(next, &record, false)) {
+        // only after the block skipped by begin() on flash
+        if (!eraseSize) {
+            return 0;
+        }
+
+        next = next - (next % eraseSize) + eraseSize;
+        return (next < capacity) ? next : 0;
+    }
+
+    return (record.length == RECORD_WRAP) ? 0 : next;
+}
+
+bool SaraN200Store::markSent(uint32_t offset) {
+    uint8_t state = RECORD_SENT;
+    return storage->write(offset + 1, &state, 1);
+}
+
+void SaraN200Store::advanceTail() {
+    Record record;
+
+    if (!readRecord(tail, &record, false) || record.length == RECORD_WRAP) {
+        // the storage changed under us, start over from what it holds
+        begin();
+        return;
+    }
+
+    if (--count == 0) {
+        tail = head;
+        return;
+    }
+
+    uint32_t next = tail;
+    for (size_t steps = 0; steps < capacity / HEADER_SIZE; steps++) {
+        next = nextRecord(next, record.length);
+        if (next == head || !readRecord(next, &record, false)) {
+            break;
+        }
+
+        if (record.state == RECORD_PENDING) {
+            tail = next;
+            return;
+        }
+    }
+
+    begin();
+}
+
+void SaraN200Store::dropOldest() {
+    markSent(tail);
+    advanceTail();
+    dropped++;
+}
+
+bool SaraN200Store::overlapsTail(uint32_t from, uint32_t to) const {
+    return count > 0 && tail >= from && tail < to;
+}
+
+bool SaraN200Store::prepare(uint32_t from, uint32_t to) {
+    if (!eraseSize) {
+        return true;
+    }
+
+    // the block holding `from` was erased when the head entered it
+    uint32_t block = (from % eraseSize) ? from - (from % eraseSize) + eraseSize : from;
+    for (; block < to; block += eraseSize) {
+        if (!storage->erase(block, eraseSize)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SaraN200Store::push(IPAddress ip, uint16_t port, const uint8_t* data, size_t size) {
+    uint32_t length = RECORD_SIZE(size);
+    if (size > SARA_N200_MAX_DATAGRAM_SIZE || length > capacity) {
+        return false;
+    }
+
+    bool wrap;
+    uint32_t start;
+
+    while (true) {
+        wrap = (capacity - head < length);
+        start = wrap ? 0 : head;
+
+        // on flash the whole block behind the record gets erased
+        uint32_t end = start + length;
+        if (eraseSize && (end % eraseSize)) {
+            end = end - (end % eraseSize) + eraseSize;
+        }
+
+        bool blocked = wrap ? (overlapsTail(head, capacity) || overlapsTail(0, end)) : overlapsTail(head, end);
+        if (!blocked) {
+            break;
+        }
+
+        dropOldest();
+    }
+
+    if (wrap && capacity - head >= HEADER_SIZE) {
+        uint8_t marker[4] = { RECORD_MAGIC, RECORD_SENT, 0xFF, 0xFF };
+        if (!storage->write(head, marker, sizeof(marker))) {
+            return false;
+        }
+    }
+
+    if (!prepare(start, start + length)) {
+        return false;
+    }
+
+    uint8_t header[HEADER_SIZE];
+    header[0] = RECORD_MAGIC;
+    header[1] = RECORD_PENDING;
+    putU16(header + 2, size);
+    putU32(header + 4, sequence);
+    header[8] = ip[0];
+    header[9] = ip[1];
+    header[10] = ip[2];
+    header[11] = ip[3];
+    putU16(header + 12, port);
+
+    uint16_t crc = crc16(0xFFFF, header + 2, 12);
+    putU16(header + 14, crc16(crc, data, size));
+
+    // payload first: a record cut short never gets a valid header
+    if (!storage->write(start + HEADER_SIZE, data, size) || !storage->write(start, header, HEADER_SIZE)) {
+        return false;
+    }
+
+    storage->sync();
+
+    if (count++ == 0) {
+        tail = start;
+    }
+
+    head = start + length;
+    sequence++;
+
+    return true;
+}
+
+bool SaraN200Store::isBackingOff() const {
+    return failed && retryInterval && !is_timedout(lastFailureAt, retryInterval);
+}
+
+bool SaraN200Store::send(int socket, IPAddress ip, uint16_t port, const uint8_t* data, size_t size) {
+    // keep the order: nothing overtakes queued datagrams
+    if (count == 0 && !isBackingOff()) {
+        if (modem->socketSendTo(socket, ip, port, const_cast<uint8_t*>(data), size) >= 0) {
+            failed = false;
+            sent++;
+            return true;
+        }
+
+        failed = true;
+        lastFailureAt = NOW;
+    }
+
+    return push(ip, port, data, size);
+}
+
+size_t SaraN200Store::flush(int socket, size_t maxDatagrams) {
+    size_t limit = maxDatagrams ? maxDatagrams : SARA_N200_STORE_BATCH;
+    size_t flushed = 0;
+    bool discarded = false;
+
+    if (isBackingOff()) {
+        return 0;
+    }
+
+    while (count > 0 && flushed < limit) {
+        if (datagramsPerSecond && (sent > 0) && !is_timedout(lastSendAt, 1000 / datagramsPerSecond)) {
+            break;
+        }
+
+        Record record;
+        if (!readRecord(tail, &record, true) || record.length == RECORD_WRAP) {
+            // corrupted in storage, nothing to send
+            dropOldest();
+            continue;
+        }
+
+        lastSendAt = NOW;
+        if (modem->socketSendTo(socket, record.ip, record.port, payload, record.length) < 0) {
+            // this one will never go out, don't let it block the rest
+            if (modem->getRetryAction() == SaraN200::RetryGiveUp) {
+                dropOldest();
+                discarded = true;
+                continue;
+            }
+
+            failed = true;
+            lastFailureAt = NOW;
+            break;
+        }
+
+        failed = false;
+        markSent(tail);
+        advanceTail();
+        sent++;
+        flushed++;
+    }
+
+    if (flushed > 0 || discarded) {
+        storage->sync();
+    }
+
+    return flushed;
+}
@@ -0,0 +1,160 @@
+#ifndef SARA_N200_STORE_H
+#define SARA_N200_STORE_H
+
+#include <Arduino.h>
+#include <stdio.h>
+#include "SaraN200.h"
+#include "SaraN200Config.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_partition.h>
+#endif
+
+// Datagrams flush() sends per call when no limit is given.
+#ifndef SARA_N200_STORE_BATCH
+#define SARA_N200_STORE_BATCH 8
+#endif
+
+// Byte storage under SaraN200Store. Offsets run from 0 to size() - 1.
+class SaraN200Storage {
+public:
+    virtual ~SaraN200Storage() {}
+
+    virtual size_t size() = 0;
+    virtual bool read(uint32_t offset, void* data, size_t size) = 0;
+    virtual bool write(uint32_t offset, const void* data, size_t size) = 0;
+
+    // Flash: bytes must be erased in blocks of eraseSize() before they can
+    // be written, and writes may only clear bits. 0 for RAM and files.
+    virtual size_t eraseSize() { return 0; }
+    virtual bool erase(uint32_t offset, size_t size) { return true; }
+    virtual bool sync() { return true; }
+};
+
+// Survives a reset only if the buffer lives in RTC/no-init memory.
+class SaraN200RamStorage : public SaraN200Storage {
+public:
+    SaraN200RamStorage(uint8_t* buffer, size_t size) : buffer(buffer), bufferSize(size) {}
+
+    virtual size_t size() { return bufferSize; }
+    virtual bool read(uint32_t offset, void* data, size_t size);
+    virtual bool write(uint32_t offset, const void* data, size_t size);
+
+private:
+    uint8_t* buffer;
+    size_t bufferSize;
+};
+
+#if defined(ESP_PLATFORM)
+// A data partition, e.g. one declared with subtype 0x40 in partitions.csv.
+class SaraN200FlashStorage : public SaraN200Storage {
+public:
+    SaraN200FlashStorage(const esp_partition_t* partition) : partition(partition) {}
+
+    virtual size_t size() { return partition->size; }
+    virtual bool read(uint32_t offset, void* data, size_t size);
+    virtual bool write(uint32_t offset, const void* data, size_t size);
+    virtual size_t eraseSize() { return SPI_FLASH_SEC_SIZE; }
+    virtual bool erase(uint32_t offset, size_t size);
+
+private:
+    const esp_partition_t* partition;
+};
+#endif
+
+#if defined(SARA_N200_POSIX) || (defined(__linux__) && !defined(ARDUINO))
+// A file of `size` bytes, created when missing. sync() calls fsync().
+class SaraN200FileStorage : public SaraN200Storage {
+public:
+    SaraN200FileStorage(const char* path, size_t size);
+    virtual ~SaraN200FileStorage();
+
+    bool isOpen() const { return file != NULL; }
+
+    virtual size_t size() { return fileSize; }
+    virtual bool read(uint32_t offset, void* data, size_t size);
+    virtual bool write(uint32_t offset, const void* data, size_t size);
+    virtual bool sync();
+
+private:
+    FILE* file;
+    size_t fileSize;
+};
+#endif
+
+// Store-and-forward queue for outbound datagrams. Datagrams that cannot be
+// sent are written to a ring over a SaraN200Storage and sent later, oldest
+// first, in rate-limited batches. Every record carries a sequence number
+// and a CRC, so begin() rebuilds the queue after a reset and a record torn
+// by a power loss is simply ignored. When the ring is full the oldest
+// datagram is dropped.
+class SaraN200Store {
+public:
+    SaraN200Store(SaraN200& modem, SaraN200Storage& storage);
+
+    // Scans the storage and recovers the queued datagrams.
+    bool begin();
+
+    // Sends at once while nothing is queued; otherwise, or when the send
+    // fails, queues the datagram behind the others.
+    bool send(int socket, IPAddress ip, uint16_t port, const uint8_t* data, size_t size);
+    bool push(IPAddress ip, uint16_t port, const uint8_t* data, size_t size);
+
+    // Sends up to `maxDatagrams` (0: SARA_N200_STORE_BATCH) queued
+    // datagrams, oldest first. Stops at the rate limit and at the first
+    // failure, after which nothing is tried for the retry interval. A
+    // datagram the retry policy gives up on (SaraN200::RetryGiveUp) is
+    // dropped instead. Returns the number of datagrams sent.
+    size_t flush(int socket, size_t maxDatagrams = 0);
+
+    // 0 disables the limit.
+    void setRateLimit(uint16_t datagramsPerSecond) { this->datagramsPerSecond = datagramsPerSecond; }
+    // Pause after a failed send, 10 s by default; 0 retries at once.
+    void setRetryInterval(uint32_t interval) { retryInterval = interval; }
+
+    size_t getCount() const { return count; }
+    bool isEmpty() const { return count == 0; }
+    uint32_t getDropped() const { return dropped; }
+    uint32_t getSent() const { return sent; }
+
+private:
+    SaraN200* modem;
+    SaraN200Storage* storage;
+    size_t capacity;
+    size_t eraseSize;
+
+    uint32_t head;  // where the next record goes
+    uint32_t tail;  // oldest queued record
+    size_t count;
+    uint32_t sequence;
+
+    uint16_t datagramsPerSecond;
+    uint32_t retryInterval;
+    uint32_t lastSendAt;
+    uint32_t lastFailureAt;
+    bool failed;
+
+    uint32_t dropped;
+    uint32_t sent;
+
+    uint8_t payload[SARA_N200_MAX_DATAGRAM_SIZE];
+
+    typedef struct Record {
+        uint8_t state;
+        uint16_t length;
+        uint32_t sequence;
+        IPAddress ip;
+        uint16_t port;
+    } Record;
+
+    bool readRecord(uint32_t offset, Record* record, bool checkPayload);
+    uint32_t nextRecord(uint32_t offset, size_t length);
+    bool markSent(uint32_t offset);
+    void advanceTail();
+    void dropOldest();
+    bool overlapsTail(uint32_t from, uint32_t to) const;
+    bool prepare(uint32_t from, uint32_t to);
+    bool isBackingOff() const;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "SaraN200Timeouts.h"
+
+// Smallest variation term added to SRTT, absorbs UART and scheduling jitter.
+#define TIMEOUT_GRANULARITY 100
+
+static const CommandTimeout defaultTimeouts[CommandClassCount] = {
+    { 5000, 500, 30000 },      // CommandGeneric
+    { 450, 100, 1000 },        // CommandProbe
+    { 5000, 300, 15000 },      // CommandQuery
+    { 5000, 300, 15000 },      // CommandConfig
+    { 5000, 300, 15000 },      // CommandSocket
+    { 5000, 500, 30000 },      // CommandSend, ECL2 can take seconds
+    { 5000, 300, 15000 },      // CommandReceive
+    { 5000, 1000, 60000 },     // CommandAttach
+    { 40000, 5000, 90000 },    // CommandDetach
+    { 5000, 1000, 30000 },     // CommandRadio
+};
+
+SaraN200Timeouts::SaraN200Timeouts():
+ adaptive(false) {
+    for (uint8_t i = 0; i < CommandClassCount; i++) {
+        limits[i] = defaultTimeouts[i];
+    }
+
+    reset();
+}
+
+void SaraN200Timeouts::setTimeout(CommandClass commandClass, uint32_t initial, uint32_t minimum, uint32_t maximum) {
+    limits[commandClass].initial = initial;
+    limits[commandClass].minimum = minimum;
+    limits[commandClass].maximum = maximum;
+
+    resetEstimate(commandClass);
+}
+
+uint32_t SaraN200Timeouts::getTimeout(CommandClass commandClass) const {
+    if (!adaptive) {
+        return limits[commandClass].initial;
+    }
+
+    return estimates[commandClass].timeout;
+}
+
+void SaraN200Timeouts::addSample(CommandClass commandClass, uint32_t responseTime) {
+    RttEstimate& estimate = estimates[commandClass];
+
+    if (estimate.samples == 0) {
+        estimate.srtt = responseTime;
+        estimate.rttvar = responseTime / 2;
+    } else {
+        uint32_t delta = (estimate.srtt > responseTime) ? (estimate.srtt - responseTime) : (responseTime - estimate.srtt);
+
+        // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+        estimate.rttvar = (3 * estimate.rttvar + delta) / 4;
+        estimate.srtt = (7 * estimate.srtt + responseTime) / 8;
+    }
+
+    estimate.samples++;
+
+    uint32_t variation = 4 * estimate.rttvar;
+    if (variation < TIMEOUT_GRANULARITY) {
+        variation = TIMEOUT_GRANULARITY;
+    }
+
+    estimate.timeout = clamp(commandClass, estimate.srtt + variation);
+}
+
+void SaraN200Timeouts::addTimeout(CommandClass commandClass) {
+    RttEstimate& estimate = estimates[commandClass];
+
+    estimate.timeouts++;
+    estimate.timeout = clamp(commandClass, 2 * estimate.timeout);
+}
+
+void SaraN200Timeouts::reset() {
+    for (uint8_t i = 0; i < CommandClassCount; i++) {
+        resetEstimate(static_cast<CommandClass>(i));
+    }
+}
+
+void SaraN200Timeouts::resetEstimate(CommandClass commandClass) {
+    RttEstimate& estimate = estimates[commandClass];
+
+    estimate.srtt = 0;
+    estimate.rttvar = 0;
+    estimate.timeout = limits[commandClass].initial;
+    estimate.samples = 0;
+    estimate.timeouts = 0;
+}
+
+uint32_t SaraN200Timeouts::clamp(CommandClass commandClass, uint32_t value) const {
+    if (value < limits[commandClass].minimum) {
+        return limits[commandClass].minimum;
+    }
+
+    if (value > limits[commandClass].maximum) {
+        return limits[commandClass].maximum;
+    }
+
+    return value;
+}
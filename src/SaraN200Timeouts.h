@@ -0,0 +1,68 @@
+#ifndef SARA_N200_TIMEOUTS_H
+#define SARA_N200_TIMEOUTS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Passed as readResponse timeout to use the current command class' timeout.
+// Every other value, 0 included, is taken as an explicit timeout in ms.
+#define SARA_N200_TIMEOUT_AUTO 0xFFFFFFFFUL
+
+typedef enum {
+    CommandGeneric = 0,
+    CommandProbe,    // AT
+    CommandQuery,    // +CSQ, +CGATT?, +NUESTATS, ...
+    CommandConfig,   // +NCONFIG, +CGDCONT, ...
+    CommandSocket,   // +NSOCR, +NSOCL
+    CommandSend,     // +NSOST
+    CommandReceive,  // +NSORF
+    CommandAttach,   // +CGATT=1
+    CommandDetach,   // +CGATT=0
+    CommandRadio,    // +CFUN
+    CommandClassCount,
+} CommandClass;
+
+typedef struct CommandTimeout {
+    uint32_t initial; // used while there are no samples, or always when not adaptive
+    uint32_t minimum;
+    uint32_t maximum;
+} CommandTimeout;
+
+typedef struct RttEstimate {
+    uint32_t srtt;    // smoothed response time, ms
+    uint32_t rttvar;  // response time variation, ms
+    uint32_t timeout; // current timeout, ms
+    uint32_t samples;
+    uint32_t timeouts;
+} RttEstimate;
+
+// Per-command-class response timeouts. In adaptive mode the timeout follows
+// the observed response times the way TCP's retransmission timer does
+// (RFC 6298): timeout = SRTT + 4 * RTTVAR, doubled after each expiry and
+// clamped to the class' [minimum, maximum] range.
+class SaraN200Timeouts {
+public:
+    SaraN200Timeouts();
+
+    void setAdaptive(bool adaptive) { this->adaptive = adaptive; }
+    bool isAdaptive() const { return adaptive; }
+
+    void setTimeout(CommandClass commandClass, uint32_t initial, uint32_t minimum, uint32_t maximum);
+    const CommandTimeout& getLimits(CommandClass commandClass) const { return limits[commandClass]; }
+    uint32_t getTimeout(CommandClass commandClass) const;
+    const RttEstimate& getEstimate(CommandClass commandClass) const { return estimates[commandClass]; }
+
+    void addSample(CommandClass commandClass, uint32_t responseTime);
+    void addTimeout(CommandClass commandClass);
+    void reset();
+
+private:
+    bool adaptive;
+    CommandTimeout limits[CommandClassCount];
+    RttEstimate estimates[CommandClassCount];
+
+    void resetEstimate(CommandClass commandClass);
+    uint32_t clamp(CommandClass commandClass, uint32_t value) const;
+};
+
+#endif
@@ -1,52 +1,71 @@
 #include "SaraN200Udp.h"
+#include "SaraN200Store.h"
+#include "SaraN200Peers.h"
 
-SaraUDP::SaraUDP(SaraN200& sara):
+SaraUDPBase::SaraUDPBase(SaraN200& sara, uint8_t* txBuffer, size_t txBufferSize, uint8_t* rxBuffer, size_t rxBufferSize):
  sara_(&sara),
  socket_(-1),
+ local_port_(42000),
  rmtPort_(0),
- tx_buffer_(0),
+ tx_buffer_(txBuffer),
+ tx_buffer_size_(txBufferSize),
  tx_buffer_len_(0),
- rx_buffer_(0)
+ rx_buffer_(rxBuffer),
+ rx_buffer_size_(rxBufferSize),
+ rx_buffer_len_(0),
+ rx_buffer_pos_(0),
+ async_send_(false),
+ connected_(false),
+ listening_(false),
+ store_(0),
+ scheduler_(0),
+ peers_(0),
+ priority_(PriorityNormal),
+ deadline_(60000),
+ last_ticket_(0)
  {}
 
-SaraUDP::~SaraUDP() {
+SaraUDPBase::~SaraUDPBase() {
     stop();
 }
 
-uint8_t SaraUDP::begin(uint16_t port) {
-    // always return 0 since server is not supported
-    return 0;
+uint8_t SaraUDPBase::begin(uint16_t port) {
+    stop();
+
+    socket_ = sara_->createSocket(port, true);
+    if (socket_ == -1) {
+        return 0;
+    }
+
+    local_port_ = port;
+    listening_ = true;
+    return 1;
 }
 
-void SaraUDP::stop() {
-    if (tx_buffer_) {
-        delete tx_buffer_;
-        tx_buffer_ = NULL;
+void SaraUDPBase::stop() {
+    tx_buffer_len_ = 0;
+    flush();
+
+    if (peers_) {
+        peers_->clear();
     }
 
-    if (rx_buffer_) {
-        delete rx_buffer_;
-        rx_buffer_ = NULL;
+    if (socket_ == -1) {
+        return;
     }
 
     if (sara_->closeSocket(socket_)) {
         socket_ = -1;
+        connected_ = false;
+        listening_ = false;
     }
 }
 
-int SaraUDP::beginPacket() {
+int SaraUDPBase::beginPacket() {
     if (rmtPort_ == 0) {
         return 0;
     }
 
-    if (!tx_buffer_) {
-        tx_buffer_ = new char[512];
-        if (!tx_buffer_) {
-            // log_e("could not create tx buffer: %d", errno);
-            return 0;
-        }
-    }
-
     tx_buffer_len_ = 0;
     if (socket_ == -1) {
         socket_ = sara_->createSocket();
@@ -58,20 +77,67 @@ int SaraUDP::beginPacket() {
     return 1;
 }
 
-int SaraUDP::beginPacket(IPAddress ip, uint16_t port) {
+int SaraUDPBase::connect(IPAddress ip, uint16_t port) {
+    rmtIp_ = ip;
+    rmtPort_ = port;
+
+    if (!beginPacket()) {
+        return 0;
+    }
+
+    connected_ = sara_->socketConnect(socket_, ip, port);
+    return connected_ ? 1 : 0;
+}
+
+size_t SaraUDPBase::flushStore(size_t maxPackets) {
+    if (!store_ || socket_ == -1) {
+        return 0;
+    }
+
+    return store_->flush(socket_, maxPackets);
+}
+
+int SaraUDPBase::beginPacket(IPAddress ip, uint16_t port) {
+    if (connected_ && (!(ip == rmtIp_) || port != rmtPort_)) {
+        sara_->socketDisconnect(socket_);
+        connected_ = false;
+    }
+
     rmtPort_ = port;
     rmtIp_ = ip;
 
     return beginPacket();
 }
 
-int SaraUDP::beginPacket(const char* host, uint16_t port) {
+int SaraUDPBase::beginPacket(const char* host, uint16_t port) {
     // TODO: handle this kind of thing
     return 0;
 }
 
-int SaraUDP::endPacket() {
-    int sent = sara_->socketSendTo(socket_, rmtIp_, rmtPort_, (uint8_t*)tx_buffer_, tx_buffer_len_);
+int SaraUDPBase::endPacket() {
+    if (scheduler_) {
+        return scheduler_->send(socket_, rmtIp_, rmtPort_, tx_buffer_, tx_buffer_len_, priority_, deadline_) ? 1 : 0;
+    }
+
+    if (store_) {
+        return store_->send(socket_, rmtIp_, rmtPort_, tx_buffer_, tx_buffer_len_) ? 1 : 0;
+    }
+
+    if (async_send_) {
+        if (connected_) {
+            last_ticket_ = sara_->socketSendAsync(socket_, tx_buffer_, tx_buffer_len_);
+        } else {
+            last_ticket_ = sara_->socketSendToAsync(socket_, rmtIp_, rmtPort_, tx_buffer_, tx_buffer_len_);
+        }
+
+        return last_ticket_ ? 1 : 0;
+    }
+
+    int sent = sendPacket();
+
+    if (sent == -1 && recover()) {
+        sent = sendPacket();
+    }
 
     if (sent == -1) {
         return 0;
@@ -80,8 +146,41 @@ int SaraUDP::endPacket() {
     return 1;
 }
 
-size_t SaraUDP::write(uint8_t value) {
-    if (tx_buffer_len_ == 512) {
+int SaraUDPBase::sendPacket() {
+    return connected_ ? sara_->socketSend(socket_, tx_buffer_, tx_buffer_len_)
+                      : sara_->socketSendTo(socket_, rmtIp_, rmtPort_, tx_buffer_, tx_buffer_len_);
+}
+
+bool SaraUDPBase::recover() {
+    switch (sara_->getRetryAction()) {
+    case SaraN200::RetryImmediately:
+        return true;
+
+    case SaraN200::RetryRecreateSocket:
+        sara_->closeSocket(socket_);
+        socket_ = listening_ ? sara_->createSocket(local_port_, true) : sara_->createSocket();
+        if (socket_ == -1) {
+            connected_ = false;
+            listening_ = false;
+            return false;
+        }
+
+        if (connected_) {
+            connected_ = sara_->socketConnect(socket_, rmtIp_, rmtPort_);
+        }
+        return true;
+
+    case SaraN200::RetryReattach:
+        return sara_->attach();
+
+    default:
+        // backoff belongs to the caller, see setStore()
+        return false;
+    }
+}
+
+size_t SaraUDPBase::write(uint8_t value) {
+    if (tx_buffer_len_ == tx_buffer_size_) {
         endPacket();
         tx_buffer_len_ = 0;
     }
@@ -90,84 +189,118 @@ size_t SaraUDP::write(uint8_t value) {
     return 1;
 }
 
-size_t SaraUDP::write(const uint8_t* buffer, size_t size) {
-    size_t i;
-    for (i = 0; i < size; i++) {
-        write(buffer[i]);
+size_t SaraUDPBase::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+
+    // copy in runs up to the end of the buffer, a full buffer goes out
+    // just like with write(uint8_t)
+    while (written < size) {
+        if (tx_buffer_len_ == tx_buffer_size_) {
+            endPacket();
+            tx_buffer_len_ = 0;
+        }
+
+        size_t count = size - written;
+        if (count > tx_buffer_size_ - tx_buffer_len_) {
+            count = tx_buffer_size_ - tx_buffer_len_;
+        }
+
+        memcpy(tx_buffer_ + tx_buffer_len_, buffer + written, count);
+        tx_buffer_len_ += count;
+        written += count;
+    }
+
+    return written;
+}
+
+void SaraUDPBase::txCommit(size_t size) {
+    if (size > txSpace()) {
+        size = txSpace();
     }
-    return i;
+
+    tx_buffer_len_ += size;
 }
 
-int SaraUDP::parsePacket() {
-    if (rx_buffer_) {
+int SaraUDPBase::parsePacket() {
+    if (available() || socket_ == -1) {
         return 0;
     }
 
-    uint8_t buffer[512] = {0};
+    // +NSONMI is only counted while the driver reads the UART
+    sara_->poll();
+
+    // when listening, the URC says when there is something to read
+    bool pending = !listening_ || sara_->getPendingDatagrams(socket_) > 0;
+    int readLength;
+
+    if (peers_) {
+        if (pending) {
+            peers_->fill(socket_);
+        }
+
+        readLength = peers_->next(rx_buffer_, rx_buffer_size_, &rmtIp_, &rmtPort_);
+    } else {
+        if (!pending) {
+            return 0;
+        }
 
-    int readLength = sara_->socketRecvFrom(socket_, buffer, 512);
-    if (readLength == -1) {
+        readLength = sara_->socketRecvFrom(socket_, rx_buffer_, rx_buffer_size_, &rmtIp_, &rmtPort_);
+    }
+
+    if (readLength <= 0) {
         return 0;
     }
 
-    rx_buffer_ = new cbuf(readLength);
-    rx_buffer_->write((const char*)buffer, readLength);
+    rx_buffer_len_ = readLength;
+    rx_buffer_pos_ = 0;
 
     return readLength;
 }
 
-int SaraUDP::available(){
-    if(!rx_buffer_) return 0;
-    return rx_buffer_->available();
+int SaraUDPBase::available(){
+    return rx_buffer_len_ - rx_buffer_pos_;
 }
 
-int SaraUDP::read(){
-    if(!rx_buffer_) return -1;
-    int out = rx_buffer_->read();
-
-    if(!rx_buffer_->available()){
-        cbuf *b = rx_buffer_;
-        rx_buffer_ = 0;
-        delete b;
-    }
-
-    return out;
+int SaraUDPBase::read(){
+    if (!available()) return -1;
+    return rx_buffer_[rx_buffer_pos_++];
 }
 
-int SaraUDP::read(unsigned char* buffer, size_t len) {
+int SaraUDPBase::read(unsigned char* buffer, size_t len) {
     return read((char*)buffer, len);
 }
 
-int SaraUDP::read(char* buffer, size_t len) {
-    if (!rx_buffer_) {
-        return 0;
+int SaraUDPBase::read(char* buffer, size_t len) {
+    size_t count = available();
+    if (count > len) {
+        count = len;
     }
 
-    int out = rx_buffer_->read(buffer, len);
-    if (!rx_buffer_->available()) {
-        cbuf *b = rx_buffer_;
-        rx_buffer_ = 0;
-        delete b;
-    }
+    memcpy(buffer, rx_buffer_ + rx_buffer_pos_, count);
+    rx_buffer_pos_ += count;
+
+    return count;
+}
 
-    return out;
+int SaraUDPBase::peek() {
+    if (!available()) return -1;
+    return rx_buffer_[rx_buffer_pos_];
 }
 
-int SaraUDP::peek() {
-    if (!rx_buffer_) return -1;
-    return rx_buffer_->peek();
+void SaraUDPBase::rxConsume(size_t size) {
+    size_t count = available();
+    rx_buffer_pos_ += (size > count) ? count : size;
 }
 
-void SaraUDP::flush() {
-    cbuf* b = rx_buffer_;
-    rx_buffer_ = 0;
-    delete b;
+void SaraUDPBase::flush() {
+    rx_buffer_len_ = 0;
+    rx_buffer_pos_ = 0;
 }
 
-IPAddress SaraUDP::remoteIP() {
+IPAddress SaraUDPBase::remoteIP() {
     return rmtIp_;
 }
 
-uint16_t SaraUDP::remotePort() {
+uint16_t SaraUDPBase::remotePort() {
     return rmtPort_;
 }
@@ -3,22 +3,37 @@
 
 #include <Arduino.h>
 #include <Udp.h>
-#include <cbuf.h>
 #include "SaraN200.h"
+#include "SaraN200Config.h"
+#include "SaraN200Scheduler.h"
 
-class SaraUDP: public UDP {
+class SaraN200Store;
+class SaraN200PeerQueue;
+
+// UDP logic shared by all buffer configurations. The TX and RX buffers are
+// handed in by SaraUDPStatic<>, so the class itself never allocates.
+class SaraUDPBase: public UDP {
 public:
-    SaraUDP(SaraN200& sara);
-    ~SaraUDP();
+    virtual ~SaraUDPBase();
 
+    // Listens on `port`: the socket reports datagrams with +NSONMI, so
+    // parsePacket() only talks to the module when something has arrived.
+    // Packets are sent from the same socket, replies to remoteIP() and
+    // remotePort() go back to the last sender.
     virtual uint8_t begin(uint16_t port);
     virtual void stop();
     virtual int beginPacket();
     virtual int beginPacket(IPAddress ip, uint16_t port);
     virtual int beginPacket(const char* host, uint16_t port);
+    // A failed send is repeated once when the retry policy allows it right
+    // away, after recreating the socket or re-attaching if it calls for
+    // that; see SaraN200::getRetryAction().
     virtual int endPacket();
     virtual size_t write(uint8_t value);
     virtual size_t write(const uint8_t* buffer, size_t size);
+    // Sets remoteIP() and remotePort() to the sender of the packet. Runs
+    // SaraN200::poll() to pick up +NSONMI, so a plain
+    // `while (udp.parsePacket())` server loop needs nothing else.
     virtual int parsePacket();
     virtual int available();
     virtual int read();
@@ -29,14 +44,91 @@ public:
     virtual IPAddress remoteIP();
     virtual uint16_t remotePort();
 
-private:
+    // Direct access to the packet buffers, e.g. for SaraN200CborWriter and
+    // SaraN200CborReader. Up to txSpace() bytes written at txData() join the
+    // packet with txCommit(); rxData() is the unread part of the packet
+    // from parsePacket(), available() bytes long.
+    uint8_t* txData() { return tx_buffer_ + tx_buffer_len_; }
+    size_t txSpace() const { return tx_buffer_size_ - tx_buffer_len_; }
+    void txCommit(size_t size);
+    const uint8_t* rxData() const { return rx_buffer_ + rx_buffer_pos_; }
+    void rxConsume(size_t size);
+
+    // endPacket() hands the datagram to SaraN200::socketSendToAsync() and
+    // returns without waiting for the module; see setSendResultCallback().
+    void setAsyncSend(bool enabled) { async_send_ = enabled; }
+
+    // Sends every packet to one peer and only accepts packets from it; see
+    // SaraN200::socketConnect(). beginPacket(ip, port) with another peer
+    // disconnects.
+    int connect(IPAddress ip, uint16_t port);
+
+    // endPacket() goes through `store`: packets that cannot be sent are kept
+    // and sent by flushStore() once the link is back.
+    void setStore(SaraN200Store* store) { store_ = store; }
+    size_t flushStore(size_t maxPackets = 0);
+
+    // endPacket() hands packets to `scheduler`, which holds them back while
+    // coverage is poor; see SaraN200Scheduler. setPriority() applies to the
+    // packets that follow.
+    void setScheduler(SaraN200Scheduler* scheduler) { scheduler_ = scheduler; }
+    void setPriority(SchedulerPriority priority, uint32_t deadline = 60000) { priority_ = priority; deadline_ = deadline; }
+    uint32_t lastTicket() const { return last_ticket_; }
+
+    // parsePacket() reads through `peers`, which queues datagrams per sender
+    // and hands them out in turn; see SaraN200PeerQueue.
+    void setPeerQueue(SaraN200PeerQueue* peers) { peers_ = peers; }
+
+protected:
+    SaraUDPBase(SaraN200& sara, uint8_t* txBuffer, size_t txBufferSize, uint8_t* rxBuffer, size_t rxBufferSize);
+
     SaraN200* sara_;
     int socket_;
+    uint16_t local_port_;
     IPAddress rmtIp_;
     uint16_t rmtPort_;
-    char* tx_buffer_;
+    uint8_t* tx_buffer_;
+    size_t tx_buffer_size_;
     size_t tx_buffer_len_;
-    cbuf* rx_buffer_;
+    uint8_t* rx_buffer_;
+    size_t rx_buffer_size_;
+    size_t rx_buffer_len_;
+    size_t rx_buffer_pos_;
+    bool async_send_;
+    bool connected_;
+    bool listening_;
+    SaraN200Store* store_;
+    SaraN200Scheduler* scheduler_;
+    SaraN200PeerQueue* peers_;
+    SchedulerPriority priority_;
+    uint32_t deadline_;
+    uint32_t last_ticket_;
+
+    int sendPacket();
+    bool recover();
 };
 
+template<size_t TxBufferSize = SARA_N200_MAX_DATAGRAM_SIZE, size_t RxBufferSize = SARA_N200_MAX_DATAGRAM_SIZE>
+class SaraUDPStatic: public SaraUDPBase {
+public:
+    static_assert(TxBufferSize > 0 && TxBufferSize <= SARA_N200_MAX_DATAGRAM_SIZE, "SARA-N200: TX buffer must hold at most one datagram");
+    static_assert(RxBufferSize > 0 && RxBufferSize <= SARA_N200_MAX_DATAGRAM_SIZE, "SARA-N200: RX buffer must hold at most one datagram");
+
+    static const size_t TxBufferBytes = TxBufferSize;
+    static const size_t RxBufferBytes = RxBufferSize;
+
+    SaraUDPStatic(SaraN200& sara) : SaraUDPBase(sara, txStorage, TxBufferSize, rxStorage, RxBufferSize) {}
+
+private:
+    uint8_t txStorage[TxBufferSize];
+    uint8_t rxStorage[RxBufferSize];
+};
+
+class SaraUDP: public SaraUDPStatic<> {
+public:
+    SaraUDP(SaraN200& sara) : SaraUDPStatic<>(sara) {}
+};
+
+SARA_N200_MEMORY_REPORT(SaraUDP)
+
 #endif
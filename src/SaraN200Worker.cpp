@@ -0,0 +1,332 @@
+#include "SaraN200Worker.h"
+
+#ifdef SARA_N200_HAS_THREADS
+
+using SaraN200Platform::LockGuard;
+
+typedef struct SocketCall {
+    int socket;
+    IPAddress ip;
+    uint16_t port;
+    uint8_t* buffer;
+    size_t size;
+    bool enableURC;
+    int result;
+} SocketCall;
+
+typedef struct SignalCall {
+    int8_t* rssi;
+    uint8_t* ber;
+    bool result;
+} SignalCall;
+
+static void createSocketOperation(SaraN200& modem, void* context) {
+    SocketCall* call = static_cast<SocketCall*>(context);
+    call->result = modem.createSocket(call->port, call->enableURC);
+}
+
+static void socketSendToOperation(SaraN200& modem, void* context) {
+    SocketCall* call = static_cast<SocketCall*>(context);
+    call->result = modem.socketSendTo(call->socket, call->ip, call->port, call->buffer, call->size);
+}
+
+static void socketRecvFromOperation(SaraN200& modem, void* context) {
+    SocketCall* call = static_cast<SocketCall*>(context);
+    call->result = modem.socketRecvFrom(call->socket, call->buffer, call->size);
+}
+
+static void closeSocketOperation(SaraN200& modem, void* context) {
+    SocketCall* call = static_cast<SocketCall*>(context);
+    call->result = modem.closeSocket(call->socket) ? 1 : 0;
+}
+
+static void isConnectedOperation(SaraN200& modem, void* context) {
+    *static_cast<bool*>(context) = modem.isConnected();
+}
+
+static void getRSSIAndBEROperation(SaraN200& modem, void* context) {
+    SignalCall* call = static_cast<SignalCall*>(context);
+    call->result = modem.getRSSIAndBER(call->rssi, call->ber);
+}
+
+SaraN200Worker::SaraN200Worker(SaraN200& modem):
+ modem(&modem),
+ fifoHead(0),
+ fifoCount(0),
+ idleHandler(0),
+ idleContext(0),
+ running(false),
+ rejectedCount(0) {
+    for (size_t i = 0; i < SARA_N200_WORKER_QUEUE_DEPTH; i++) {
+        requests[i].state = RequestFree;
+    }
+}
+
+SaraN200Worker::~SaraN200Worker() {
+    end();
+}
+
+bool SaraN200Worker::begin(uint32_t stackSize, int priority) {
+    mutex.lock();
+    if (running) {
+        mutex.unlock();
+        return true;
+    }
+
+    running = true;
+    mutex.unlock();
+
+    if (!thread.start(taskEntry, this, "sara-n200", stackSize, priority)) {
+        LockGuard guard(mutex);
+        running = false;
+        return false;
+    }
+
+    return true;
+}
+
+void SaraN200Worker::end() {
+    mutex.lock();
+    if (!running) {
+        mutex.unlock();
+        return;
+    }
+
+    running = false;
+    mutex.unlock();
+
+    wake.notify();
+    thread.join();
+}
+
+bool SaraN200Worker::isRunning() {
+    LockGuard guard(mutex);
+    return running;
+}
+
+void SaraN200Worker::setIdleHandler(Operation handler, void* context) {
+    LockGuard guard(mutex);
+    idleHandler = handler;
+    idleContext = context;
+}
+
+size_t SaraN200Worker::getQueueDepth() {
+    LockGuard guard(mutex);
+    return fifoCount;
+}
+
+uint32_t SaraN200Worker::getRejectedCount() {
+    LockGuard guard(mutex);
+    return rejectedCount;
+}
+
+SaraN200Worker::Request* SaraN200Worker::enqueue(Operation operation, void* context, bool detached, Operation dropped) {
+    Request* request = NULL;
+
+    LockGuard guard(mutex);
+    if (!running) {
+        rejectedCount++;
+        return NULL;
+    }
+
+    for (size_t i = 0; i < SARA_N200_WORKER_QUEUE_DEPTH; i++) {
+        if (requests[i].state == RequestFree) {
+            request = &requests[i];
+            fifo[(fifoHead + fifoCount) % SARA_N200_WORKER_QUEUE_DEPTH] = i;
+            fifoCount++;
+            break;
+        }
+    }
+
+    if (!request) {
+        rejectedCount++;
+        return NULL;
+    }
+
+    request->operation = operation;
+    request->dropped = dropped;
+    request->context = context;
+    request->detached = detached;
+    request->state = RequestQueued;
+
+    return request;
+}
+
+bool SaraN200Worker::post(Operation operation, void* context, Operation dropped) {
+    if (!enqueue(operation, context, true, dropped)) {
+        return false;
+    }
+
+    wake.notify();
+    return true;
+}
+
+bool SaraN200Worker::submit(Operation operation, void* context, uint32_t timeout) {
+    Request* request = enqueue(operation, context, false, NULL);
+    if (!request) {
+        return false;
+    }
+
+    wake.notify();
+
+    if (!request->done.wait(timeout)) {
+        mutex.lock();
+        if (request->state == RequestQueued) {
+            // the I/O task frees the slot when it dequeues it
+            request->state = RequestCancelled;
+            mutex.unlock();
+            return false;
+        }
+        mutex.unlock();
+
+        // already running: the context must stay valid until it is done
+        request->done.wait();
+    }
+
+    LockGuard guard(mutex);
+    bool ran = (request->state == RequestDone);
+    request->state = RequestFree;
+
+    return ran;
+}
+
+void SaraN200Worker::taskEntry(void* self) {
+    static_cast<SaraN200Worker*>(self)->run();
+}
+
+void SaraN200Worker::run() {
+    while (isRunning()) {
+        wake.wait(SARA_N200_WORKER_IDLE_INTERVAL);
+
+        while (true) {
+            mutex.lock();
+            if (!running || fifoCount == 0) {
+                mutex.unlock();
+                break;
+            }
+
+            Request* request = &requests[fifo[fifoHead]];
+            fifoHead = (fifoHead + 1) % SARA_N200_WORKER_QUEUE_DEPTH;
+            fifoCount--;
+
+            if (request->state == RequestCancelled) {
+                request->state = RequestFree;
+                mutex.unlock();
+                continue;
+            }
+
+            request->state = RequestRunning;
+            mutex.unlock();
+
+            request->operation(*modem, request->context);
+
+            mutex.lock();
+            if (request->detached) {
+                request->state = RequestFree;
+                mutex.unlock();
+                continue;
+            }
+
+            request->state = RequestDone;
+            mutex.unlock();
+            request->done.notify();
+        }
+
+        mutex.lock();
+        Operation handler = idleHandler;
+        void* context = idleContext;
+        bool stopping = !running;
+        mutex.unlock();
+
+        if (stopping) {
+            break;
+        }
+
+        if (handler) {
+            handler(*modem, context);
+        } else {
+            modem->poll();
+        }
+    }
+
+    // fail whatever is still queued so no caller blocks forever; none of it
+    // has run
+    while (true) {
+        mutex.lock();
+        if (fifoCount == 0) {
+            mutex.unlock();
+            break;
+        }
+
+        Request* request = &requests[fifo[fifoHead]];
+        fifoHead = (fifoHead + 1) % SARA_N200_WORKER_QUEUE_DEPTH;
+        fifoCount--;
+
+        if (request->state == RequestCancelled) {
+            request->state = RequestFree;
+            mutex.unlock();
+            continue;
+        }
+
+        if (!request->detached) {
+            request->state = RequestFailed;
+            mutex.unlock();
+            request->done.notify();
+            continue;
+        }
+
+        Operation dropped = request->dropped;
+        void* context = request->context;
+        request->state = RequestFree;
+        mutex.unlock();
+
+        // may post elsewhere, so not under the lock
+        if (dropped) {
+            dropped(*modem, context);
+        }
+    }
+}
+
+int SaraN200Worker::createSocket(uint16_t localPort, bool enableURC) {
+    SocketCall call = { -1, IPAddress(), localPort, NULL, 0, enableURC, -1 };
+    submit(createSocketOperation, &call);
+
+    return call.result;
+}
+
+int SaraN200Worker::socketSendTo(int socket, IPAddress ip, uint16_t port, const uint8_t* buffer, size_t size) {
+    SocketCall call = { socket, ip, port, const_cast<uint8_t*>(buffer), size, false, -1 };
+    submit(socketSendToOperation, &call);
+
+    return call.result;
+}
+
+int SaraN200Worker::socketRecvFrom(int socket, uint8_t* buffer, size_t size) {
+    SocketCall call = { socket, IPAddress(), 0, buffer, size, false, -1 };
+    submit(socketRecvFromOperation, &call);
+
+    return call.result;
+}
+
+bool SaraN200Worker::closeSocket(int socket) {
+    SocketCall call = { socket, IPAddress(), 0, NULL, 0, false, 0 };
+    submit(closeSocketOperation, &call);
+
+    return call.result == 1;
+}
+
+bool SaraN200Worker::isConnected() {
+    bool result = false;
+    submit(isConnectedOperation, &result);
+
+    return result;
+}
+
+bool SaraN200Worker::getRSSIAndBER(int8_t* rssi, uint8_t* ber) {
+    SignalCall call = { rssi, ber, false };
+    submit(getRSSIAndBEROperation, &call);
+
+    return call.result;
+}
+
+#endif
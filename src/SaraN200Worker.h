@@ -0,0 +1,104 @@
+#ifndef SARA_N200_WORKER_H
+#define SARA_N200_WORKER_H
+
+#include "SaraN200Platform.h"
+
+#ifdef SARA_N200_HAS_THREADS
+
+#include <Arduino.h>
+#include "SaraN200.h"
+
+#ifndef SARA_N200_WORKER_QUEUE_DEPTH
+#define SARA_N200_WORKER_QUEUE_DEPTH 8
+#endif
+
+#ifndef SARA_N200_WORKER_IDLE_INTERVAL
+#define SARA_N200_WORKER_IDLE_INTERVAL 1000
+#endif
+
+// Runs a dedicated I/O task that owns the modem. Other tasks submit requests
+// through a bounded MPSC queue and block until the I/O task has executed
+// them, so AT commands and their responses never interleave on the UART.
+class SaraN200Worker {
+public:
+    typedef void (*Operation)(SaraN200& modem, void* context);
+
+    SaraN200Worker(SaraN200& modem);
+    ~SaraN200Worker();
+
+    bool begin(uint32_t stackSize = 4096, int priority = 5);
+    // Waits for the running request, if any; requests still queued are
+    // dropped and their submit() returns false.
+    void end();
+
+    // Runs `operation` on the I/O task. `timeout` bounds the time spent
+    // waiting in the queue; once started the operation always completes.
+    // Returns false when the queue is full, the request timed out queued or
+    // end() dropped it before it ran.
+    bool submit(Operation operation, void* context, uint32_t timeout = SARA_N200_WAIT_FOREVER);
+    // Queues `operation` without waiting for it. `context` must stay valid
+    // until the operation has run; returns false when the queue is full.
+    // When end() drops the request instead, `dropped` is called with the same
+    // context on the I/O task.
+    bool post(Operation operation, void* context, Operation dropped = NULL);
+
+    // Called on the I/O task whenever the queue is idle, SaraN200::poll()
+    // when no handler is set.
+    void setIdleHandler(Operation handler, void* context);
+
+    size_t getQueueDepth();
+    uint32_t getRejectedCount();
+
+    int createSocket(uint16_t localPort = 42000, bool enableURC = false);
+    int socketSendTo(int socket, IPAddress ip, uint16_t port, const uint8_t* buffer, size_t size);
+    int socketRecvFrom(int socket, uint8_t* buffer, size_t size);
+    bool closeSocket(int socket);
+    bool isConnected();
+    bool getRSSIAndBER(int8_t* rssi, uint8_t* ber);
+
+private:
+    typedef enum {
+        RequestFree = 0,
+        RequestQueued,
+        RequestRunning,
+        RequestDone,
+        RequestCancelled, // timed out queued, the caller has gone
+        RequestFailed,    // dropped by end() without running
+    } RequestState;
+
+    typedef struct Request {
+        Operation operation;
+        Operation dropped;
+        void* context;
+        RequestState state;
+        bool detached; // posted, nobody waits for the result
+        SaraN200Platform::Signal done;
+    } Request;
+
+    SaraN200* modem;
+    SaraN200Platform::Mutex mutex;
+    SaraN200Platform::Signal wake;
+    SaraN200Platform::Thread thread;
+
+    Request requests[SARA_N200_WORKER_QUEUE_DEPTH];
+    uint8_t fifo[SARA_N200_WORKER_QUEUE_DEPTH];
+    size_t fifoHead;
+    size_t fifoCount;
+
+    Operation idleHandler;
+    void* idleContext;
+    bool running; // under `mutex`, the I/O task reads it while end() writes
+    uint32_t rejectedCount;
+
+    Request* enqueue(Operation operation, void* context, bool detached, Operation dropped);
+    bool isRunning();
+    void run();
+    static void taskEntry(void* self);
+
+    SaraN200Worker(const SaraN200Worker&);
+    SaraN200Worker& operator=(const SaraN200Worker&);
+};
+
+#endif
+
+#endif
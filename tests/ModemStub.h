@@ -0,0 +1,88 @@
+#ifndef SARA_N200_MODEM_STUB_H
+#define SARA_N200_MODEM_STUB_H
+
+// Stands in for the module on the other end of the UART. Every command line
+// the driver writes is logged and handed to `reply`, whose answer is queued
+// for the driver to read; push() queues unsolicited lines (URCs). Never call
+// push() from inside `reply`.
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+class ModemStub : public Stream {
+public:
+    std::function<std::string(const std::string& command)> reply;
+
+    virtual size_t write(uint8_t value) {
+        std::lock_guard<std::mutex> guard(mutex);
+
+        if (value == '\n') {
+            return 1;
+        }
+
+        if (value != '\r') {
+            line += static_cast<char>(value);
+            return 1;
+        }
+
+        log.push_back(line);
+        std::string answer = reply ? reply(line) : "\r\nOK\r\n";
+        output.insert(output.end(), answer.begin(), answer.end());
+        line.clear();
+
+        return 1;
+    }
+
+    void push(const std::string& text) {
+        std::lock_guard<std::mutex> guard(mutex);
+        output.insert(output.end(), text.begin(), text.end());
+    }
+
+    // Commands sent so far that start with `prefix`.
+    size_t count(const std::string& prefix) {
+        std::lock_guard<std::mutex> guard(mutex);
+        size_t n = 0;
+
+        for (size_t i = 0; i < log.size(); i++) {
+            if (log[i].compare(0, prefix.size(), prefix) == 0) {
+                n++;
+            }
+        }
+
+        return n;
+    }
+
+    virtual int available() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return output.size();
+    }
+
+    virtual int read() {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (output.empty()) {
+            return -1;
+        }
+
+        int c = static_cast<uint8_t>(output.front());
+        output.pop_front();
+        return c;
+    }
+
+    virtual int peek() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return output.empty() ? -1 : static_cast<uint8_t>(output.front());
+    }
+
+private:
+    std::mutex mutex;
+    std::string line;
+    std::vector<std::string> log;
+    std::deque<char> output;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef SARA_N200_TEST_SUPPORT_H
+#define SARA_N200_TEST_SUPPORT_H
+
+// Just enough of a test harness for the native build: CHECK() records a
+// failure and carries on, TEST_RESULT() is what main() returns.
+
+#include <stdio.h>
+
+static int testFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            testFailures++; \
+        } \
+    } while (0)
+
+#define TEST_RESULT() (testFailures == 0 ? 0 : 1)
+
+#endif
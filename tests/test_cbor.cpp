@@ -0,0 +1,211 @@
+#include <initializer_list>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#include "SaraN200Cbor.h"
+#include "SaraN200Udp.h"
+#include "TestSupport.h"
+
+#define ENCODES_AS(writer, ...) encodesAs(writer, std::initializer_list<uint8_t>{ __VA_ARGS__ })
+
+static bool encodesAs(const SaraN200CborWriter& writer, std::initializer_list<uint8_t> expected) {
+    return !writer.isOverflow() && writer.getLength() == expected.size() &&
+           memcmp(writer.data(), expected.begin(), expected.size()) == 0;
+}
+
+static bool sameBits(float a, float b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Encodes `value`, checks the head byte (0xF9 half, 0xFA single) and that it
+// decodes to the same bits.
+static bool floatRoundTrip(float value, uint8_t head) {
+    uint8_t buffer[8];
+    SaraN200CborWriter writer(buffer, sizeof(buffer));
+    if (!writer.writeFloat(value) || buffer[0] != head) {
+        return false;
+    }
+
+    SaraN200CborReader reader(buffer, writer.getLength());
+    float decoded;
+    return reader.readFloat(&decoded) && sameBits(decoded, value) && reader.getRemaining() == 0;
+}
+
+static void testFloats() {
+    uint8_t buffer[8];
+
+    SaraN200CborWriter one(buffer, sizeof(buffer));
+    CHECK(one.writeFloat(1.0f) && ENCODES_AS(one, 0xF9, 0x3C, 0x00));
+
+    SaraN200CborWriter tenth(buffer, sizeof(buffer));
+    CHECK(tenth.writeFloat(0.1f) && ENCODES_AS(tenth, 0xFA, 0x3D, 0xCC, 0xCC, 0xCD));
+
+    // half precision where exact: zeros, infinities, the largest half,
+    // the smallest normal and subnormals
+    CHECK(floatRoundTrip(0.0f, 0xF9));
+    CHECK(floatRoundTrip(-0.0f, 0xF9));
+    CHECK(floatRoundTrip(INFINITY, 0xF9));
+    CHECK(floatRoundTrip(-INFINITY, 0xF9));
+    CHECK(floatRoundTrip(65504.0f, 0xF9));
+    CHECK(floatRoundTrip(-2.5f, 0xF9));
+    CHECK(floatRoundTrip(ldexpf(1.0f, -14), 0xF9));
+    CHECK(floatRoundTrip(ldexpf(1.0f, -24), 0xF9));
+    CHECK(floatRoundTrip(ldexpf(3.0f, -20), 0xF9));
+    CHECK(floatRoundTrip(-ldexpf(1023.0f, -24), 0xF9));
+
+    SaraN200CborWriter subnormal(buffer, sizeof(buffer));
+    CHECK(subnormal.writeFloat(ldexpf(3.0f, -20)) && ENCODES_AS(subnormal, 0xF9, 0x00, 0x30));
+
+    // single precision once half would lose bits: too large, too small,
+    // more mantissa than fits, or a subnormal with bits shifted out
+    CHECK(floatRoundTrip(65520.0f, 0xFA));
+    CHECK(floatRoundTrip(ldexpf(1.0f, -25), 0xFA));
+    CHECK(floatRoundTrip(1.0f + ldexpf(1.0f, -11), 0xFA));
+    CHECK(floatRoundTrip(ldexpf(1.0f + ldexpf(1.0f, -16), -24), 0xFA));
+    CHECK(floatRoundTrip(ldexpf(5.0f, -26), 0xFA));
+    CHECK(floatRoundTrip(3.14159265f, 0xFA));
+
+    // NaN comes back as NaN
+    SaraN200CborWriter nan(buffer, sizeof(buffer));
+    CHECK(nan.writeFloat(NAN));
+    SaraN200CborReader nanReader(buffer, nan.getLength());
+    float decoded = 0;
+    CHECK(nanReader.readFloat(&decoded) && isnan(decoded));
+
+    // doubles and integers are read as floats too
+    const uint8_t wide[] = { 0xFB, 0x3F, 0xF8, 0, 0, 0, 0, 0, 0, 0x20 };
+    SaraN200CborReader wideReader(wide, sizeof(wide));
+    CHECK(wideReader.readFloat(&decoded) && decoded == 1.5f);
+    CHECK(wideReader.readFloat(&decoded) && decoded == -1.0f);
+}
+
+static void testIntegers() {
+    uint8_t buffer[8];
+
+    SaraN200CborWriter minimum(buffer, sizeof(buffer));
+    CHECK(minimum.writeInt(INT32_MIN) && ENCODES_AS(minimum, 0x3A, 0x7F, 0xFF, 0xFF, 0xFF));
+
+    SaraN200CborWriter maximum(buffer, sizeof(buffer));
+    CHECK(maximum.writeInt(INT32_MAX) && ENCODES_AS(maximum, 0x1A, 0x7F, 0xFF, 0xFF, 0xFF));
+
+    SaraN200CborWriter small(buffer, sizeof(buffer));
+    CHECK(small.writeInt(-24) && small.writeInt(-25) && ENCODES_AS(small, 0x37, 0x38, 0x18));
+
+    const int32_t values[] = { INT32_MIN, INT32_MIN + 1, -65537, -256, -25, -1, 0, 23, 24, 255, 65536, INT32_MAX };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        SaraN200CborWriter writer(buffer, sizeof(buffer));
+        CHECK(writer.writeInt(values[i]));
+
+        SaraN200CborReader reader(buffer, writer.getLength());
+        int32_t decoded = 0;
+        CHECK(reader.readInt(&decoded) && decoded == values[i]);
+        CHECK(reader.getRemaining() == 0);
+    }
+
+    // one below INT32_MIN does not fit an int32_t
+    const uint8_t tooSmall[] = { 0x3A, 0x80, 0x00, 0x00, 0x00 };
+    SaraN200CborReader reader(tooSmall, sizeof(tooSmall));
+    int32_t decoded = 0;
+    CHECK(!reader.readInt(&decoded) && reader.isError());
+
+    int8_t narrow = 0;
+    const uint8_t outOfRange[] = { 0x38, 0x80 };
+    SaraN200CborReader narrowReader(outOfRange, sizeof(outOfRange));
+    CHECK(!narrowReader.read(&narrow));
+}
+
+static size_t nest(uint8_t* buffer, size_t depth) {
+    SaraN200CborWriter writer(buffer, 32);
+    for (size_t i = 0; i < depth; i++) {
+        writer.writeArray(1);
+    }
+    writer.writeUint(7);
+
+    return writer.getLength();
+}
+
+static void testSkip() {
+    uint8_t buffer[32];
+
+    // up to SARA_N200_CBOR_MAX_DEPTH - 1 containers deep
+    size_t length = nest(buffer, SARA_N200_CBOR_MAX_DEPTH - 1);
+    SaraN200CborReader shallow(buffer, length);
+    CHECK(shallow.skip() && shallow.getRemaining() == 0);
+
+    length = nest(buffer, SARA_N200_CBOR_MAX_DEPTH);
+    SaraN200CborReader deep(buffer, length);
+    CHECK(!deep.skip() && deep.isError());
+
+    // a map with a tagged value, a text and a nested array, then a 1
+    SaraN200CborWriter writer(buffer, sizeof(buffer));
+    writer.writeMap(2);
+    writer.writeUint(1);
+    writer.writeTag(1);
+    writer.writeUint(1700000000);
+    writer.writeText("ab");
+    writer.writeArray(2);
+    writer.writeNull();
+    writer.writeFloat(0.5f);
+    writer.writeUint(1);
+    CHECK(!writer.isOverflow());
+
+    SaraN200CborReader reader(buffer, writer.getLength());
+    uint32_t after = 0;
+    CHECK(reader.skip() && reader.readUint(&after) && after == 1);
+
+    // a length past the end of the buffer
+    SaraN200CborReader truncated(buffer, 6);
+    CHECK(!truncated.skip() && truncated.isError());
+}
+
+typedef SaraN200CborArray<SaraN200CborField<uint32_t>, SaraN200CborField<int16_t>, SaraN200CborField<float>, SaraN200CborText<16> > Reading;
+typedef SaraN200CborMap<SaraN200CborKey<1, SaraN200CborField<uint8_t> >, SaraN200CborKey<30, SaraN200CborField<bool> > > Status;
+
+// the sizes the layouts promise, checked where they are declared
+static_assert(Reading::MaxSize == 1 + 5 + 3 + 5 + 17, "Reading layout size");
+static_assert(Status::MaxSize == 1 + (1 + 2) + (2 + 1), "Status layout size");
+static_assert(SaraN200CborText<24>::MaxSize == 26, "a 24-byte text needs a 2-byte head");
+SARA_N200_CBOR_ASSERT_FITS(Reading, SaraUDP);
+SARA_N200_CBOR_ASSERT_FITS(Status, SaraUDPStatic<8>);
+
+static void testSchema() {
+    uint8_t buffer[Reading::MaxSize];
+    SaraN200CborWriter writer(buffer, sizeof(buffer));
+
+    const char label[] = "sixteen byte lab";
+    CborSlice text = { reinterpret_cast<const uint8_t*>(label), 16 };
+    CHECK(Reading::write(writer, UINT32_MAX, static_cast<int16_t>(-32768), 0.1f, text));
+    CHECK(writer.getLength() == Reading::MaxSize);
+
+    uint32_t timestamp = 0;
+    int16_t temperature = 0;
+    float value = 0;
+    CborSlice read;
+    SaraN200CborReader reader(buffer, writer.getLength());
+    CHECK(Reading::read(reader, &timestamp, &temperature, &value, &read));
+    CHECK(timestamp == UINT32_MAX && temperature == -32768 && value == 0.1f);
+    CHECK(read.size == 16 && memcmp(read.data, label, 16) == 0);
+
+    // one byte short: the write fails as a whole
+    SaraN200CborWriter cramped(buffer, sizeof(buffer) - 1);
+    CHECK(!Reading::write(cramped, UINT32_MAX, static_cast<int16_t>(-32768), 0.1f, text));
+    CHECK(cramped.isOverflow());
+
+    // a record of other fields is refused
+    SaraN200CborWriter status(buffer, sizeof(buffer));
+    CHECK(Status::write(status, static_cast<uint8_t>(200), true));
+    CHECK(ENCODES_AS(status, 0xA2, 0x01, 0x18, 0xC8, 0x18, 0x1E, 0xF5));
+
+    SaraN200CborReader wrong(buffer, status.getLength());
+    CHECK(!Reading::read(wrong, &timestamp, &temperature, &value, &read));
+}
+
+int main() {
+    testFloats();
+    testIntegers();
+    testSkip();
+    testSchema();
+
+    return TEST_RESULT();
+}
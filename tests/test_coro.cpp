@@ -0,0 +1,169 @@
+#include <string>
+
+#include "SaraN200Coro.h"
+#include "ModemStub.h"
+#include "TestSupport.h"
+
+static std::string reply(const std::string& command) {
+    if (command.compare(0, 8, "AT+NSOCR") == 0) {
+        return "\r\n0\r\n\r\nOK\r\n";
+    }
+
+    if (command.compare(0, 8, "AT+NSOST") == 0) {
+        return "\r\n0,2\r\n\r\nOK\r\n";
+    }
+
+    if (command.compare(0, 8, "AT+NSORF") == 0) {
+        return "\r\n0,\"1.2.3.4\",5000,3,\"414243\",0\r\n\r\nOK\r\n";
+    }
+
+    return "\r\nOK\r\n";
+}
+
+static uint8_t received[16];
+
+static SaraN200Task<int> exchange(SaraN200Coro& coro, uint32_t timeout) {
+    static uint8_t request[2] = { 1, 2 };
+
+    int socket = co_await coro.createSocket();
+    if (socket < 0 || co_await coro.socketSendTo(socket, IPAddress(1, 2, 3, 4), 5000, request, sizeof(request)) < 0) {
+        co_return -2;
+    }
+
+    int length = co_await coro.socketRecvFrom(socket, received, sizeof(received), timeout);
+    co_await coro.closeSocket(socket);
+    co_return length;
+}
+
+// Awaits another task, so cancelling this one cancels that one too.
+static SaraN200Task<int> nested(SaraN200Coro& coro) {
+    co_return co_await exchange(coro, 0);
+}
+
+static SaraN200Task<> sleeper(SaraN200Coro& coro, bool* result) {
+    *result = co_await coro.delay(100000);
+}
+
+template<typename T>
+static void runUntilDone(SaraN200Coro& coro, SaraN200Task<T>& task, uint32_t timeout) {
+    uint32_t start = millis();
+    while (!task.done() && millis() - start < timeout) {
+        coro.poll();
+        delay(5);
+    }
+}
+
+// No +NSONMI within the receive timeout: the await resumes with -1 and the
+// coroutine still closes its socket.
+static void testTimeout() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    SaraN200Coro coro(sara);
+
+    SaraN200Task<int> task = exchange(coro, 100);
+    CHECK(task.valid() && !task.done());
+
+    runUntilDone(coro, task, 2000);
+    CHECK(task.done());
+    CHECK(task.result() == -1);
+    CHECK(modem.count("AT+NSORF") == 0);
+    CHECK(modem.count("AT+NSOCL") == 1);
+    CHECK(coro.getWaiting() == 0);
+}
+
+// The datagram announced by +NSONMI is read and handed to the coroutine.
+static void testReceive() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    SaraN200Coro coro(sara);
+
+    SaraN200Task<int> task = exchange(coro, 5000);
+    runUntilDone(coro, task, 100);
+    CHECK(!task.done());
+
+    modem.push("\r\n+NSONMI: 0,3\r\n");
+    runUntilDone(coro, task, 2000);
+    CHECK(task.result() == 3);
+    CHECK(memcmp(received, "ABC", 3) == 0);
+}
+
+// Cancelling fails the await in progress at the next poll(), also one
+// suspended in a task the cancelled task awaits.
+static void testCancel() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    SaraN200Coro coro(sara);
+
+    bool slept = true;
+    SaraN200Task<> sleeping = sleeper(coro, &slept);
+    SaraN200Task<int> waiting = nested(coro);
+    runUntilDone(coro, waiting, 50);
+    CHECK(!sleeping.done() && !waiting.done());
+
+    sleeping.cancel();
+    waiting.cancel();
+    coro.poll();
+
+    CHECK(sleeping.done() && !slept);
+    CHECK(waiting.done() && waiting.result() == -1);
+    CHECK(modem.count("AT+NSORF") == 0);
+    CHECK(coro.getWaiting() == 0);
+
+    // destroying a suspended task takes its await out of the driver
+    {
+        SaraN200Task<> dropped = sleeper(coro, &slept);
+        CHECK(coro.getWaiting() == 1);
+    }
+    CHECK(coro.getWaiting() == 0);
+}
+
+// With every frame in use the next coroutine gets no frame and an invalid
+// task instead of touching the heap.
+static void testPoolExhaustion() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    SaraN200Coro coro(sara);
+
+    CHECK(SaraN200FramePool::getUsed() == 0);
+    uint32_t failures = SaraN200FramePool::getFailures();
+
+    bool results[SARA_N200_CORO_FRAME_COUNT + 1];
+    SaraN200Task<> tasks[SARA_N200_CORO_FRAME_COUNT + 1];
+    for (size_t i = 0; i < SARA_N200_CORO_FRAME_COUNT + 1; i++) {
+        tasks[i] = sleeper(coro, &results[i]);
+    }
+
+    for (size_t i = 0; i < SARA_N200_CORO_FRAME_COUNT; i++) {
+        CHECK(tasks[i].valid());
+    }
+
+    CHECK(!tasks[SARA_N200_CORO_FRAME_COUNT].valid());
+    CHECK(tasks[SARA_N200_CORO_FRAME_COUNT].done());
+    CHECK(SaraN200FramePool::getFailures() == failures + 1);
+
+    // a released frame can be used again
+    tasks[0] = SaraN200Task<>();
+    tasks[SARA_N200_CORO_FRAME_COUNT] = sleeper(coro, &results[0]);
+    CHECK(tasks[SARA_N200_CORO_FRAME_COUNT].valid());
+}
+
+int main() {
+    testTimeout();
+    testReceive();
+    testCancel();
+    testPoolExhaustion();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,142 @@
+#include <atomic>
+#include <thread>
+
+#include "SaraN200Group.h"
+#include "ModemStub.h"
+#include "TestSupport.h"
+
+static std::atomic<bool> gateOpen(false);
+static std::atomic<bool> gateEntered(false);
+
+static void idle(SaraN200& modem, void* context) {
+}
+
+static void gate(SaraN200& modem, void* context) {
+    gateEntered = true;
+    while (!gateOpen) {
+        std::this_thread::yield();
+    }
+}
+
+static std::string reply(const std::string& command) {
+    if (command.compare(0, 8, "AT+NSOCR") == 0) {
+        return "\r\n0\r\n\r\nOK\r\n";
+    }
+
+    if (command.compare(0, 8, "AT+NSOST") == 0) {
+        return "\r\n0,4\r\n\r\nOK\r\n";
+    }
+
+    return "\r\nOK\r\n";
+}
+
+static void endWorker(SaraN200Worker* worker) {
+    worker->end();
+}
+
+// A datagram still queued when its modem's worker ends is not lost to the
+// queue accounting: it fails over to the other modem and flush() returns.
+static void testEndedWorkerFailsOver() {
+    ModemStub stubA;
+    ModemStub stubB;
+    stubA.reply = reply;
+    stubB.reply = reply;
+
+    SaraN200Static<> modemA;
+    SaraN200Static<> modemB;
+    modemA.init(&stubA);
+    modemB.init(&stubB);
+
+    SaraN200Worker workerA(modemA);
+    SaraN200Worker workerB(modemB);
+    workerA.setIdleHandler(idle, NULL);
+    workerB.setIdleHandler(idle, NULL);
+    CHECK(workerA.begin());
+    CHECK(workerB.begin());
+    CHECK(workerA.createSocket() == 0);
+    CHECK(workerB.createSocket() == 0);
+
+    SaraN200Group group;
+    CHECK(group.add(workerA, 0));
+    CHECK(group.add(workerB, 0));
+
+    gateOpen = false;
+    gateEntered = false;
+    CHECK(workerA.post(gate, NULL));
+    while (!gateEntered) {
+        std::this_thread::yield();
+    }
+
+    const uint8_t payload[4] = { 1, 2, 3, 4 };
+    CHECK(group.sendTo(IPAddress(10, 0, 0, 1), 5683, payload, sizeof(payload)) == 0);
+    CHECK(group.getTotals().queued == 1);
+
+    std::thread ender(endWorker, &workerA);
+    delay(50);
+    gateOpen = true;
+    ender.join();
+
+    CHECK(group.flush(1000));
+    CHECK(group.getStats(0).queued == 0);
+    CHECK(group.getStats(0).failovers == 1);
+    CHECK(group.getStats(1).datagramsSent == 1);
+    CHECK(stubA.count("AT+NSOST") == 0);
+    CHECK(stubB.count("AT+NSOST") == 1);
+}
+
+// With no other modem to take it the datagram is dropped, not stuck queued.
+static void testEndedWorkerDrops() {
+    ModemStub stub;
+    stub.reply = reply;
+
+    SaraN200Static<> modem;
+    modem.init(&stub);
+
+    SaraN200Worker worker(modem);
+    worker.setIdleHandler(idle, NULL);
+    CHECK(worker.begin());
+    CHECK(worker.createSocket() == 0);
+
+    SaraN200Group group;
+    CHECK(group.add(worker, 0));
+
+    gateOpen = false;
+    gateEntered = false;
+    CHECK(worker.post(gate, NULL));
+    while (!gateEntered) {
+        std::this_thread::yield();
+    }
+
+    const uint8_t payload[4] = { 1, 2, 3, 4 };
+    CHECK(group.sendTo(IPAddress(10, 0, 0, 1), 5683, payload, sizeof(payload)) == 0);
+    group.update();
+
+    std::thread ender(endWorker, &worker);
+    delay(50);
+    gateOpen = true;
+    ender.join();
+
+    CHECK(group.flush(100));
+    CHECK(group.getStats(0).queued == 0);
+    CHECK(group.getStats(0).dropped == 1);
+    CHECK(stub.count("AT+NSOST") == 0);
+    CHECK(stub.count("AT+CGATT?") == 0);
+
+    // the dropped refresh does not block the next one
+    CHECK(worker.begin());
+    group.update();
+    uint32_t start = millis();
+    while (stub.count("AT+CGATT?") == 0 && millis() - start < 1000) {
+        delay(1);
+    }
+
+    worker.end();
+    CHECK(stub.count("AT+CGATT?") == 1);
+}
+
+int main() {
+    testEndedWorkerFailsOver();
+    testEndedWorkerDrops();
+
+    return TEST_RESULT();
+}
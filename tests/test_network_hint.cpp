@@ -0,0 +1,200 @@
+#include <string>
+
+#include "SaraN200.h"
+#include "ModemStub.h"
+#include "TestSupport.h"
+
+static const char* nconfig =
+    "\r\n+NCONFIG: \"AUTOCONNECT\",\"FALSE\""
+    "\r\n+NCONFIG: \"CR_0354_0338_SCRAMBLING\",\"TRUE\""
+    "\r\n+NCONFIG: \"CR_0859_SI_AVOID\",\"TRUE\""
+    "\r\n+NCONFIG: \"COMBINE_ATTACH\",\"TRUE\""
+    "\r\n+NCONFIG: \"CELL_RESELECTION\",\"TRUE\""
+    "\r\n+NCONFIG: \"ENABLE_BIP\",\"TRUE\""
+    "\r\n\r\nOK\r\n";
+
+// A module whose only cell is on band 20, so a band 8 hint never attaches.
+// With `autoAttach` it attaches by itself whenever it can, like with
+// AUTOCONNECT set.
+static bool autoAttach = false;
+static bool radioOn = false;
+static bool attached = false;
+static std::string bands;
+static std::string lastCfun;
+static std::string lastCops;
+static std::string lastEarfcn;
+
+static bool canAttach() {
+    return radioOn && bands.find("20") != std::string::npos;
+}
+
+static std::string reply(const std::string& command) {
+    if (command == "AT+NCONFIG?") {
+        return nconfig;
+    }
+
+    if (command.compare(0, 8, "AT+CFUN=") == 0) {
+        lastCfun = command;
+        radioOn = (command == "AT+CFUN=1");
+        attached = attached && radioOn;
+        return "\r\nOK\r\n";
+    }
+
+    if (command == "AT+CSQ") {
+        return radioOn ? "\r\n+CSQ: 20,99\r\n\r\nOK\r\n" : "\r\n+CSQ: 99,99\r\n\r\nOK\r\n";
+    }
+
+    if (command == "AT+CGATT=1") {
+        attached = canAttach();
+        return "\r\nOK\r\n";
+    }
+
+    if (command == "AT+CGATT?") {
+        attached = attached || (autoAttach && canAttach());
+        return attached ? "\r\n+CGATT: 1\r\n\r\nOK\r\n" : "\r\n+CGATT: 0\r\n\r\nOK\r\n";
+    }
+
+    if (command == "AT+NBAND?") {
+        return "\r\n+NBAND:" + bands + "\r\n\r\nOK\r\n";
+    }
+
+    // like the module, NBAND and NEARFCN only with the radio off
+    if (command.compare(0, 9, "AT+NBAND=") == 0) {
+        if (radioOn) {
+            return "\r\nERROR\r\n";
+        }
+
+        bands = command.substr(9);
+        return "\r\nOK\r\n";
+    }
+
+    if (command.compare(0, 11, "AT+NEARFCN=") == 0) {
+        if (radioOn) {
+            return "\r\nERROR\r\n";
+        }
+
+        lastEarfcn = command;
+        return "\r\nOK\r\n";
+    }
+
+    if (command.compare(0, 8, "AT+COPS=") == 0) {
+        lastCops = command;
+        return "\r\nOK\r\n";
+    }
+
+    return "\r\nOK\r\n";
+}
+
+static void reset(bool automatic) {
+    autoAttach = automatic;
+    radioOn = false;
+    attached = false;
+    bands = "8,20";
+    lastCfun.clear();
+    lastCops.clear();
+    lastEarfcn.clear();
+}
+
+static void setBandHint(SaraN200& sara) {
+    SaraN200::NetworkHint hint;
+    memset(&hint, 0, sizeof(hint));
+    hint.valid = true;
+    hint.band = 8;
+    hint.pci = -1;
+    sara.setNetworkHint(hint);
+    sara.setNetworkHintEnabled(true);
+    sara.setNetworkHintTimeout(500);
+}
+
+static void checkFellBack(ModemStub& modem, SaraN200& sara) {
+    CHECK(modem.count("AT+NBAND=8,20") == 1);
+    CHECK(modem.count("AT+NBAND=") == 2);
+    CHECK(bands == "8,20");
+    CHECK(lastCfun == "AT+CFUN=1");
+    CHECK(!sara.getBootTimings().hinted);
+
+    SaraN200::AttachAttempt attempts[2];
+    CHECK(sara.getAttachAttempts(attempts, 2) == 2);
+    CHECK(attempts[0].hinted && !attempts[0].success);
+    CHECK(!attempts[1].hinted && attempts[1].success);
+
+    // the hint stays within its timeout, give or take a command
+    CHECK(attempts[0].duration < 500 + 3000);
+}
+
+// With AUTOCONNECT, a failed hint without a PLMN still turns the radio back
+// on, so the module can find the band 20 cell once the bands are restored.
+static void testAutoconnectFallback() {
+    ModemStub modem;
+    modem.reply = reply;
+    reset(true);
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    setBandHint(sara);
+
+    uint32_t start = millis();
+    CHECK(sara.autoconnect());
+    CHECK(millis() - start < 20000);
+    checkFellBack(modem, sara);
+}
+
+static void testConnectFallback() {
+    ModemStub modem;
+    modem.reply = reply;
+    reset(false);
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    setBandHint(sara);
+
+    CHECK(sara.connect("apn"));
+    checkFellBack(modem, sara);
+}
+
+// A hint that works still leaves no locks behind: the bands, EARFCN and
+// operator selection are back to a full search once attached.
+static void testHintUnlocks() {
+    ModemStub modem;
+    modem.reply = reply;
+    reset(false);
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+
+    SaraN200::NetworkHint hint;
+    memset(&hint, 0, sizeof(hint));
+    hint.valid = true;
+    hint.band = 20;
+    strcpy(hint.plmn, "20408");
+    hint.earfcn = 6300;
+    hint.pci = 12;
+    sara.setNetworkHint(hint);
+    sara.setNetworkHintEnabled(true);
+    sara.setNetworkHintTimeout(500);
+
+    CHECK(sara.connect("apn"));
+    CHECK(modem.count("AT+NBAND=20") == 1);
+    CHECK(modem.count("AT+COPS=1,2,\"20408\"") == 1);
+    CHECK(bands == "8,20");
+    CHECK(lastEarfcn == "AT+NEARFCN=0,0");
+    CHECK(lastCops == "AT+COPS=0");
+    CHECK(lastCfun == "AT+CFUN=1");
+    CHECK(attached);
+    CHECK(sara.getBootTimings().hinted);
+
+    SaraN200::AttachAttempt attempts[2];
+    CHECK(sara.getAttachAttempts(attempts, 2) == 1);
+    CHECK(attempts[0].hinted && attempts[0].success);
+
+    // the full search list survives for the next hint
+    CHECK(sara.getNetworkHint().searchBandCount == 2);
+}
+
+int main() {
+    testAutoconnectFallback();
+    testConnectFallback();
+    testHintUnlocks();
+
+    return TEST_RESULT();
+}
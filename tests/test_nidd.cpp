@@ -0,0 +1,95 @@
+#include <deque>
+#include <string>
+
+#include "SaraN200Nidd.h"
+#include "ModemStub.h"
+#include "TestSupport.h"
+
+// Messages buffered on the module for AT+NMGR, as "<length>,<hex>".
+static std::deque<std::string> buffered;
+static std::string lastSent;
+
+static std::string reply(const std::string& command) {
+    if (command.compare(0, 8, "AT+NMGS=") == 0) {
+        lastSent = command.substr(8);
+        return "\r\nOK\r\n";
+    }
+
+    if (command == "AT+NMGR") {
+        if (buffered.empty()) {
+            return "\r\nOK\r\n";
+        }
+
+        std::string answer = "\r\n" + buffered.front() + "\r\n\r\nOK\r\n";
+        buffered.pop_front();
+        return answer;
+    }
+
+    return "\r\nOK\r\n";
+}
+
+static void testSend() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+
+    SaraNIDD nidd(sara);
+    CHECK(nidd.begin(0) == 1);
+    CHECK(modem.count("AT+NNMI=2") == 1);
+
+    const uint8_t payload[3] = { 0x01, 0xAB, 0xFF };
+    CHECK(nidd.beginPacket(IPAddress(10, 0, 0, 1), 5683) == 1);
+    CHECK(nidd.write(payload, sizeof(payload)) == 3);
+    CHECK(nidd.endPacket() == 1);
+    CHECK(lastSent == "3,01ABFF");
+}
+
+// parsePacket() reads +NNMI itself and only sends AT+NMGR for messages the
+// module has announced.
+static void testReceive() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+
+    SaraNIDD nidd(sara);
+    CHECK(nidd.begin(0) == 1);
+
+    CHECK(nidd.parsePacket() == 0);
+    CHECK(modem.count("AT+NMGR") == 0);
+
+    buffered.push_back("2,C0DE");
+    buffered.push_back("1,7F");
+    modem.push("\r\n+NNMI\r\n\r\n+NNMI\r\n");
+
+    size_t received = 0;
+    while (nidd.parsePacket()) {
+        received++;
+        if (received == 1) {
+            CHECK(nidd.available() == 2);
+            CHECK(nidd.read() == 0xC0);
+            CHECK(nidd.read() == 0xDE);
+        } else {
+            CHECK(nidd.available() == 1);
+            CHECK(nidd.read() == 0x7F);
+        }
+    }
+
+    CHECK(received == 2);
+    CHECK(modem.count("AT+NMGR") == 2);
+    CHECK(sara.getPendingNonIpMessages() == 0);
+
+    // nothing announced, nothing asked
+    CHECK(nidd.parsePacket() == 0);
+    CHECK(modem.count("AT+NMGR") == 2);
+}
+
+int main() {
+    testSend();
+    testReceive();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,66 @@
+#include "PosixSerial.h"
+#include "TestSupport.h"
+
+// Reads `size` bytes from `from`, each within its read timeout.
+static bool receive(PosixSerial& from, const uint8_t* expected, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (from.read() != expected[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Bytes go through both ways untouched: no echo, no CR/LF translation, and
+// nothing read as a control character.
+static void testRoundTrip(PosixSerial& master, PosixSerial& port) {
+    const uint8_t command[] = { 'A', 'T', '\r', '\n', 0x00, 0x03, 0x11, 0xFF };
+    CHECK(port.write(command, sizeof(command)) == sizeof(command));
+    port.flush();
+    CHECK(receive(master, command, sizeof(command)));
+    CHECK(master.available() == 0);
+
+    const uint8_t response[] = { '\r', '\n', 'O', 'K', '\r', '\n', 0x13, 0x7F };
+    CHECK(master.write(response, sizeof(response)) == sizeof(response));
+    master.flush();
+    CHECK(receive(port, response, sizeof(response)));
+    CHECK(port.available() == 0);
+}
+
+// With nothing to read, read() waits about readTimeout and gives up.
+static void testReadTimeout(PosixSerial& port) {
+    port.setReadTimeout(100);
+
+    uint32_t start = millis();
+    CHECK(port.read() == -1);
+    uint32_t elapsed = millis() - start;
+    CHECK(elapsed >= 100 && elapsed < 500);
+
+    port.setReadTimeout(0);
+    start = millis();
+    CHECK(port.read() == -1);
+    CHECK(millis() - start < 50);
+}
+
+int main() {
+    PosixSerial master;
+    char slaveName[64];
+    CHECK(master.openPty(slaveName, sizeof(slaveName)));
+
+    PosixSerial port;
+    CHECK(!port.begin(slaveName, 12345));
+    CHECK(!port.isOpen());
+
+    CHECK(port.begin(slaveName, 115200));
+    CHECK(port.isOpen());
+
+    testRoundTrip(master, port);
+    testReadTimeout(port);
+
+    // a failed begin() does not leave the previous port open either
+    CHECK(!port.begin(slaveName, 0));
+    CHECK(!port.isOpen());
+
+    return TEST_RESULT();
+}
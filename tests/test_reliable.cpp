@@ -0,0 +1,248 @@
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "SaraN200Reliable.h"
+#include "ModemStub.h"
+#include "TestSupport.h"
+
+// One end of a link: a module whose AT+NSOST lands in the peer's inbox, where
+// the peer's AT+NSORF picks it up. `lose` decides which datagrams never make
+// it, by header type and sequence.
+class End {
+public:
+    ModemStub modem;
+    SaraN200Static<> sara;
+    SaraUDP udp;
+    SaraReliableUDPStatic<4, 32> reliable;
+
+    End* peer;
+    const char* address;
+    std::deque<std::string> inbox;
+    std::function<bool(uint8_t type, uint16_t sequence)> lose;
+    std::vector<uint8_t> delivered;
+
+    End(const char* address) : udp(sara), reliable(udp), peer(NULL), address(address) {
+        modem.reply = [this](const std::string& command) { return reply(command); };
+        sara.init(&modem);
+        // keeps poll() to the datagrams, so the retransmission timing holds
+        sara.setSignalRefreshInterval(0);
+        reliable.setReceiveCallback(onReceive, this);
+    }
+
+    std::string reply(const std::string& command) {
+        if (command.compare(0, 8, "AT+NSOCR") == 0) {
+            return "\r\n0\r\n\r\nOK\r\n";
+        }
+
+        if (command.compare(0, 9, "AT+NSOST=") == 0) {
+            size_t end = command.rfind('"');
+            size_t start = command.rfind('"', end - 1) + 1;
+            std::string hex = command.substr(start, end - start);
+
+            uint8_t type = strtoul(hex.substr(0, 2).c_str(), NULL, 16);
+            uint16_t sequence = strtoul(hex.substr(4, 4).c_str(), NULL, 16);
+            if (!lose || !lose(type, sequence)) {
+                peer->inbox.push_back(hex);
+            }
+
+            char answer[32];
+            snprintf(answer, sizeof(answer), "\r\n0,%u\r\n\r\nOK\r\n", static_cast<unsigned>(hex.size() / 2));
+            return answer;
+        }
+
+        if (command.compare(0, 9, "AT+NSORF=") == 0) {
+            if (inbox.empty()) {
+                return "\r\nOK\r\n";
+            }
+
+            std::string hex = inbox.front();
+            inbox.pop_front();
+
+            char header[64];
+            snprintf(header, sizeof(header), "\r\n0,\"%s\",5683,%u,\"", peer->address, static_cast<unsigned>(hex.size() / 2));
+            return header + hex + "\",0\r\n\r\nOK\r\n";
+        }
+
+        return "\r\nOK\r\n";
+    }
+
+    static void onReceive(const uint8_t* data, size_t size, void* param) {
+        static_cast<End*>(param)->delivered.push_back(data[0]);
+    }
+};
+
+static const uint8_t TYPE_DATA = 0x01;
+static const uint8_t TYPE_ACK = 0x02;
+
+static void connect(End& a, End& b) {
+    a.peer = &b;
+    b.peer = &a;
+    a.reliable.begin(IPAddress(10, 0, 0, 2), 5683);
+    b.reliable.begin(IPAddress(10, 0, 0, 1), 5683);
+}
+
+static bool send(End& end, uint8_t value) {
+    uint8_t payload[4] = { value, 0, 0, 0 };
+    return end.reliable.send(payload, sizeof(payload)) >= 0;
+}
+
+// Polls both ends until `a` has nothing in flight, at most `timeout` ms.
+static void settle(End& a, End& b, uint32_t timeout) {
+    uint32_t start = millis();
+    do {
+        a.reliable.poll();
+        b.reliable.poll();
+        delay(5);
+    } while (a.reliable.getInFlight() > 0 && millis() - start < timeout);
+}
+
+// A lost datagram is the only one sent again: the SACK bitmap covers those
+// received after it.
+static void testSackRetransmit() {
+    End a("10.0.0.1");
+    End b("10.0.0.2");
+    connect(a, b);
+
+    bool lost = false;
+    a.lose = [&lost](uint8_t type, uint16_t sequence) {
+        if (type == TYPE_DATA && sequence == 1 && !lost) {
+            lost = true;
+            return true;
+        }
+        return false;
+    };
+
+    for (uint8_t i = 0; i < 4; i++) {
+        CHECK(send(a, i));
+    }
+    CHECK(!a.reliable.canSend());
+
+    settle(a, b, 10000);
+
+    const uint8_t order[4] = { 0, 2, 3, 1 };
+    CHECK(b.delivered.size() == 4);
+    CHECK(b.delivered.size() == 4 && memcmp(b.delivered.data(), order, 4) == 0);
+    CHECK(a.reliable.getStats().delivered == 4);
+    CHECK(a.reliable.getStats().retransmitted == 1);
+    CHECK(a.modem.count("AT+NSOST") == 5);
+    CHECK(b.reliable.getStats().duplicates == 0);
+}
+
+// With the acknowledgement lost the datagram arrives twice but is delivered
+// once, and the second copy is acknowledged again.
+static void testDuplicate() {
+    End a("10.0.0.1");
+    End b("10.0.0.2");
+    connect(a, b);
+
+    bool lost = false;
+    b.lose = [&lost](uint8_t type, uint16_t sequence) {
+        if (type == TYPE_ACK && !lost) {
+            lost = true;
+            return true;
+        }
+        return false;
+    };
+
+    CHECK(send(a, 7));
+    settle(a, b, 10000);
+
+    CHECK(b.delivered.size() == 1);
+    CHECK(b.reliable.getStats().received == 1);
+    CHECK(b.reliable.getStats().duplicates == 1);
+    CHECK(b.reliable.getStats().acksSent == 2);
+    CHECK(a.reliable.getStats().delivered == 1);
+    CHECK(a.reliable.getStats().retransmitted == 1);
+}
+
+// A restarted sender begins at sequence 0 again; its new epoch keeps the
+// receiver from taking that for old datagrams.
+static void testEpochRestart() {
+    End a("10.0.0.1");
+    End b("10.0.0.2");
+    connect(a, b);
+
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK(send(a, i));
+    }
+    settle(a, b, 1000);
+    CHECK(b.delivered.size() == 3);
+
+    uint8_t epoch = a.reliable.getEpoch();
+    do {
+        delay(1);
+        a.reliable.begin(IPAddress(10, 0, 0, 2), 5683);
+    } while (a.reliable.getEpoch() == epoch);
+
+    CHECK(send(a, 9));
+    settle(a, b, 1000);
+
+    CHECK(b.delivered.size() == 4 && b.delivered.back() == 9);
+    CHECK(b.reliable.getStats().duplicates == 0);
+    CHECK(a.reliable.getStats().delivered == 4);
+    CHECK(a.reliable.getStats().retransmitted == 0);
+}
+
+static void countFailures(uint16_t sequence, bool delivered, void* param) {
+    if (!delivered) {
+        (*static_cast<unsigned*>(param))++;
+    }
+}
+
+// While a datagram is retried nothing is sent past what the receiver's SACK
+// bitmap covers, and once the sender gives up the receiver moves past it.
+static void testGiveUp() {
+    End a("10.0.0.1");
+    End b("10.0.0.2");
+    connect(a, b);
+
+    unsigned failures = 0;
+    a.reliable.setStatusCallback(countFailures, &failures);
+    a.reliable.setMaxRetries(1);
+    a.lose = [](uint8_t type, uint16_t sequence) {
+        return type == TYPE_DATA && sequence == 0;
+    };
+
+    CHECK(send(a, 0));
+
+    uint8_t sent = 1;
+    while (a.reliable.canSend()) {
+        CHECK(send(a, sent++));
+        a.reliable.poll();
+        b.reliable.poll();
+    }
+
+    CHECK(sent == SARA_RELIABLE_SACK_BITS);
+    a.reliable.poll();
+    CHECK(a.reliable.getInFlight() == 1);
+    CHECK(failures == 0);
+    CHECK(!a.reliable.canSend());
+
+    settle(a, b, 10000);
+    CHECK(failures == 1);
+    CHECK(a.reliable.canSend());
+    CHECK(b.delivered.size() == SARA_RELIABLE_SACK_BITS - 1);
+
+    // the next datagrams run past what the bitmap covers from sequence 0,
+    // and are still delivered
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK(send(a, sent + i));
+    }
+    settle(a, b, 1000);
+
+    CHECK(b.delivered.size() == SARA_RELIABLE_SACK_BITS + 2);
+    CHECK(b.delivered.back() == sent + 2);
+    CHECK(a.reliable.getStats().delivered == SARA_RELIABLE_SACK_BITS + 2);
+    CHECK(a.reliable.getStats().failed == 1);
+}
+
+int main() {
+    testSackRetransmit();
+    testDuplicate();
+    testEpochRestart();
+    testGiveUp();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,162 @@
+#include <deque>
+#include <string>
+
+#include "SaraN200.h"
+#include "ModemStub.h"
+#include "TestSupport.h"
+
+// How the datagrams read after the request look: who sends them and
+// whether they echo the request's transmit timestamp.
+typedef struct Answer {
+    const char* ip;
+    uint16_t port;
+    bool echo;
+} Answer;
+
+static std::deque<Answer> answers;
+static std::deque<std::string> downlink;
+static bool failFirstRead = false;
+
+static std::string hexByte(uint8_t value) {
+    char pair[3];
+    snprintf(pair, sizeof(pair), "%02X", value);
+    return pair;
+}
+
+// 2024-01-01T00:00:00Z from a stratum 2 server, answering `request`
+static std::string serverReply(const Answer& answer, const std::string& request) {
+    uint8_t packet[48] = { 0x24, 2 };
+    uint32_t seconds = 3913056000UL;
+    packet[40] = seconds >> 24;
+    packet[41] = seconds >> 16;
+    packet[42] = seconds >> 8;
+    packet[43] = seconds;
+
+    if (answer.echo) {
+        for (size_t i = 0; i < 8; i++) {
+            packet[24 + i] = strtoul(request.substr(80 + 2 * i, 2).c_str(), NULL, 16);
+        }
+    }
+
+    std::string hex;
+    for (size_t i = 0; i < sizeof(packet); i++) {
+        hex += hexByte(packet[i]);
+    }
+
+    char header[48];
+    snprintf(header, sizeof(header), "\r\n1,\"%s\",%u,48,\"", answer.ip, answer.port);
+    return header + hex + "\",0\r\n\r\nOK\r\n";
+}
+
+static std::string reply(const std::string& command) {
+    if (command.compare(0, 8, "AT+NSOCR") == 0) {
+        return "\r\n1\r\n\r\nOK\r\n";
+    }
+
+    if (command.compare(0, 8, "AT+NSOST") == 0) {
+        size_t end = command.rfind('"');
+        std::string request = command.substr(command.rfind('"', end - 1) + 1);
+
+        // the answers arrive straight away
+        std::string urcs;
+        while (!answers.empty()) {
+            downlink.push_back(serverReply(answers.front(), request));
+            answers.pop_front();
+            urcs += "\r\n+NSONMI: 1,48\r\n";
+        }
+
+        return "\r\n1,48\r\n\r\nOK\r\n" + urcs;
+    }
+
+    if (command.compare(0, 8, "AT+NSORF") == 0) {
+        if (failFirstRead) {
+            failFirstRead = false;
+            return "\r\nERROR\r\n";
+        }
+
+        if (downlink.empty()) {
+            return "\r\nOK\r\n";
+        }
+
+        std::string answer = downlink.front();
+        downlink.pop_front();
+        return answer;
+    }
+
+    return "\r\nOK\r\n";
+}
+
+static void expect(const char* ip, uint16_t port, bool echo) {
+    Answer answer = { ip, port, echo };
+    answers.push_back(answer);
+}
+
+// The wait for the reply reads only URCs: no signal refresh, and one
+// AT+NSORF per +NSONMI.
+static void testWaitsOnNotifications() {
+    ModemStub modem;
+    modem.reply = reply;
+    downlink.clear();
+    expect("1.2.3.4", 123, true);
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    sara.setSignalRefreshInterval(1);
+
+    CHECK(sara.syncTimeSntp(IPAddress(1, 2, 3, 4)));
+    CHECK(sara.getTimeSource() == SaraN200::TimeSourceSntp);
+
+    uint32_t epoch = 0;
+    CHECK(sara.getTime(&epoch) && epoch == 1704067200UL);
+    CHECK(modem.count("AT+NSORF") == 1);
+    CHECK(modem.count("AT+CSQ") == 0);
+}
+
+// A failed read waits for the next +NSONMI instead of asking again.
+static void testFailedReadWaits() {
+    ModemStub modem;
+    modem.reply = reply;
+    downlink.clear();
+    expect("1.2.3.4", 123, true);
+    failFirstRead = true;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+
+    CHECK(!sara.syncTimeSntp(IPAddress(1, 2, 3, 4), 300));
+    CHECK(modem.count("AT+NSORF") == 1);
+}
+
+// Replies from another address or port, or not echoing the request, are
+// read and ignored; the one that matches still sets the clock.
+static void testIgnoresOtherReplies() {
+    ModemStub modem;
+    modem.reply = reply;
+    downlink.clear();
+    expect("6.6.6.6", 123, true);
+    expect("1.2.3.4", 4000, true);
+    expect("1.2.3.4", 123, false);
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+
+    CHECK(!sara.syncTimeSntp(IPAddress(1, 2, 3, 4), 300));
+    CHECK(modem.count("AT+NSORF") == 3);
+    CHECK(sara.getTimeSource() == SaraN200::TimeSourceNone);
+
+    downlink.clear();
+    expect("6.6.6.6", 123, true);
+    expect("1.2.3.4", 123, true);
+
+    uint32_t epoch = 0;
+    CHECK(sara.syncTimeSntp(IPAddress(1, 2, 3, 4), 300));
+    CHECK(sara.getTime(&epoch) && epoch == 1704067200UL);
+}
+
+int main() {
+    testWaitsOnNotifications();
+    testFailedReadWaits();
+    testIgnoresOtherReplies();
+
+    return TEST_RESULT();
+}
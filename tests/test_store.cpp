@@ -0,0 +1,169 @@
+#include <string>
+#include <vector>
+
+#include "SaraN200Store.h"
+#include "ModemStub.h"
+#include "TestSupport.h"
+
+// A 20-byte datagram takes a 36-byte record, so 128 bytes hold three of
+// them and leave 20 bytes for the wrap marker.
+#define PAYLOAD_SIZE 20
+#define RECORD_BYTES 36
+
+// First payload byte of every AT+NSOST, in the order sent.
+static std::vector<uint8_t> sent;
+
+static std::string reply(const std::string& command) {
+    if (command.compare(0, 8, "AT+NSOCR") == 0) {
+        return "\r\n0\r\n\r\nOK\r\n";
+    }
+
+    if (command.compare(0, 9, "AT+NSOST=") == 0) {
+        size_t start = command.rfind(",\"") + 2;
+        sent.push_back(strtoul(command.substr(start, 2).c_str(), NULL, 16));
+        return "\r\n0,20\r\n\r\nOK\r\n";
+    }
+
+    return "\r\nOK\r\n";
+}
+
+static bool push(SaraN200Store& store, uint8_t value) {
+    uint8_t payload[PAYLOAD_SIZE];
+    memset(payload, value, sizeof(payload));
+
+    return store.push(IPAddress(10, 0, 0, 1), 5683, payload, sizeof(payload));
+}
+
+static bool sentWere(const char* expected) {
+    return sent == std::vector<uint8_t>(expected, expected + strlen(expected));
+}
+
+// After a reset begin() finds the pending records, oldest first, and new
+// records go behind them.
+static void testRebuild() {
+    ModemStub modem;
+    modem.reply = reply;
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    CHECK(sara.createSocket() == 0);
+
+    uint8_t buffer[256];
+    memset(buffer, 0, sizeof(buffer));
+    SaraN200RamStorage storage(buffer, sizeof(buffer));
+
+    SaraN200Store before(sara, storage);
+    CHECK(before.begin());
+    CHECK(push(before, 'a') && push(before, 'b') && push(before, 'c'));
+    sent.clear();
+    CHECK(before.flush(0, 1) == 1);
+
+    SaraN200Store after(sara, storage);
+    CHECK(after.begin());
+    CHECK(after.getCount() == 2);
+    CHECK(push(after, 'd'));
+    CHECK(after.getCount() == 3);
+
+    CHECK(after.flush(0) == 3);
+    CHECK(sentWere("abcd"));
+    CHECK(after.isEmpty());
+}
+
+// A power loss while the header was written leaves a record begin() skips;
+// the ones before it survive.
+static void testTornHeader() {
+    ModemStub modem;
+    modem.reply = reply;
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    CHECK(sara.createSocket() == 0);
+
+    uint8_t buffer[256];
+    memset(buffer, 0, sizeof(buffer));
+    SaraN200RamStorage storage(buffer, sizeof(buffer));
+
+    SaraN200Store before(sara, storage);
+    CHECK(before.begin());
+    CHECK(push(before, 'a') && push(before, 'b') && push(before, 'c'));
+
+    // only the first half of the third header made it
+    memset(buffer + 2 * RECORD_BYTES + 8, 0, 8);
+
+    SaraN200Store after(sara, storage);
+    CHECK(after.begin());
+    CHECK(after.getCount() == 2);
+    CHECK(push(after, 'd'));
+
+    sent.clear();
+    CHECK(after.flush(0) == 3);
+    CHECK(sentWere("abd"));
+}
+
+// A record that does not fit before the end goes to offset 0 behind a wrap
+// marker, and is still sent after the older ones, also after a reset.
+static void testWrap() {
+    ModemStub modem;
+    modem.reply = reply;
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    CHECK(sara.createSocket() == 0);
+
+    uint8_t buffer[128];
+    memset(buffer, 0, sizeof(buffer));
+    SaraN200RamStorage storage(buffer, sizeof(buffer));
+
+    SaraN200Store before(sara, storage);
+    CHECK(before.begin());
+    CHECK(push(before, 'a') && push(before, 'b') && push(before, 'c'));
+    sent.clear();
+    CHECK(before.flush(0, 2) == 2);
+
+    CHECK(push(before, 'd'));
+    CHECK(before.getDropped() == 0);
+    CHECK(buffer[3 * RECORD_BYTES] == 0xA5);
+    CHECK(buffer[3 * RECORD_BYTES + 2] == 0xFF && buffer[3 * RECORD_BYTES + 3] == 0xFF);
+    CHECK(buffer[0] == 0xA5 && buffer[16] == 'd');
+
+    SaraN200Store after(sara, storage);
+    CHECK(after.begin());
+    CHECK(after.getCount() == 2);
+
+    CHECK(after.flush(0) == 2);
+    CHECK(sentWere("abcd"));
+}
+
+// A full ring makes room by dropping the oldest datagram.
+static void testFullDropsOldest() {
+    ModemStub modem;
+    modem.reply = reply;
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    CHECK(sara.createSocket() == 0);
+
+    uint8_t buffer[128];
+    memset(buffer, 0, sizeof(buffer));
+    SaraN200RamStorage storage(buffer, sizeof(buffer));
+
+    SaraN200Store store(sara, storage);
+    CHECK(store.begin());
+    CHECK(push(store, 'a') && push(store, 'b') && push(store, 'c'));
+    CHECK(push(store, 'd'));
+    CHECK(store.getDropped() == 1);
+    CHECK(store.getCount() == 3);
+
+    SaraN200Store after(sara, storage);
+    CHECK(after.begin());
+    CHECK(after.getCount() == 3);
+
+    sent.clear();
+    CHECK(after.flush(0) == 3);
+    CHECK(sentWere("bcd"));
+}
+
+int main() {
+    testRebuild();
+    testTornHeader();
+    testWrap();
+    testFullDropsOldest();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,189 @@
+#include <deque>
+#include <string>
+
+#include "SaraN200.h"
+#include "SaraN200Accounting.h"
+#include "ModemStub.h"
+#include "TestSupport.h"
+
+typedef struct Datagram {
+    std::string ip;
+    uint16_t port;
+    std::string hex;
+} Datagram;
+
+// Queued downlink datagrams, handed out the way AT+NSORF does: at most the
+// requested length per response, followed by what is left of the datagram.
+static std::deque<Datagram> downlink;
+static size_t offset = 0;
+
+static std::string hexOf(size_t length, const char* pair) {
+    std::string hex;
+    for (size_t i = 0; i < length; i++) {
+        hex += pair;
+    }
+
+    return hex;
+}
+
+static std::string reply(const std::string& command) {
+    if (command.compare(0, 8, "AT+NSOCR") == 0) {
+        return "\r\n0\r\n\r\nOK\r\n";
+    }
+
+    unsigned socket;
+    unsigned length;
+    if (sscanf(command.c_str(), "AT+NSORF=%u,%u", &socket, &length) == 2) {
+        if (downlink.empty()) {
+            return "\r\nOK\r\n";
+        }
+
+        Datagram& datagram = downlink.front();
+        size_t total = datagram.hex.size() / 2;
+        size_t count = (total - offset > length) ? length : total - offset;
+        size_t left = total - offset - count;
+
+        char header[64];
+        snprintf(header, sizeof(header), "\r\n%u,\"%s\",%u,%u,\"", socket, datagram.ip.c_str(), datagram.port, static_cast<unsigned>(count));
+        std::string answer = header + datagram.hex.substr(offset * 2, count * 2);
+        snprintf(header, sizeof(header), "\",%u\r\n\r\nOK\r\n", static_cast<unsigned>(left));
+        answer += header;
+
+        offset += count;
+        if (left == 0) {
+            downlink.pop_front();
+            offset = 0;
+        }
+
+        return answer;
+    }
+
+    return "\r\nOK\r\n";
+}
+
+static void queue(const char* ip, uint16_t port, size_t length, const char* pair) {
+    Datagram datagram = { ip, port, hexOf(length, pair) };
+    downlink.push_back(datagram);
+}
+
+// A datagram the batch buffer runs out for comes back flagged, and the next
+// batch starts with the datagram after it instead of its tail.
+static void testBatchTruncates() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    CHECK(sara.createSocket(42000, false) == 0);
+
+    downlink.clear();
+    queue("10.0.0.1", 5683, 60, "11");
+    queue("10.0.0.2", 7, 80, "22");
+    queue("10.0.0.3", 9, 10, "33");
+
+    uint8_t buffer[100];
+    SaraN200::UdpPacket packets[4];
+    SaraN200::RecvBatchStats stats;
+
+    int count = sara.socketRecvBatch(0, buffer, sizeof(buffer), packets, 4, &stats);
+    CHECK(count == 2);
+    CHECK(packets[0].length == 60 && !packets[0].truncated);
+    CHECK(packets[1].length == 40 && packets[1].truncated);
+    CHECK(packets[1].data[0] == 0x22 && packets[1].remotePort == 7);
+    CHECK(stats.truncated == 1);
+    CHECK(stats.bytes == 100);
+    CHECK(stats.commands == 3);
+    CHECK(stats.morePending);
+
+    count = sara.socketRecvBatch(0, buffer, sizeof(buffer), packets, 4, &stats);
+    CHECK(count == 1);
+    CHECK(packets[0].length == 10 && !packets[0].truncated);
+    CHECK(packets[0].data[0] == 0x33 && packets[0].remotePort == 9);
+    CHECK(stats.truncated == 0);
+}
+
+// A datagram longer than one AT+NSORF comes back whole. One longer than the
+// buffer is cut there, and the next read starts with the datagram after it.
+static void testRecvFromWholeDatagrams() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+    CHECK(sara.createSocket(42000, false) == 0);
+
+    downlink.clear();
+    queue("10.0.0.1", 5683, 200, "44");
+    queue("10.0.0.2", 7, 300, "55");
+    queue("10.0.0.3", 9, 10, "66");
+
+    uint8_t buffer[512];
+    IPAddress ip;
+    uint16_t port = 0;
+    CHECK(sara.socketRecvFrom(0, buffer, sizeof(buffer), &ip, &port) == 200);
+    CHECK(buffer[0] == 0x44 && buffer[199] == 0x44);
+    CHECK(ip == IPAddress(10, 0, 0, 1) && port == 5683);
+    CHECK(modem.count("AT+NSORF") > 1);
+
+    CHECK(sara.socketRecvFrom(0, buffer, 150, &ip, &port) == 150);
+    CHECK(buffer[149] == 0x55 && port == 7);
+
+    CHECK(sara.socketRecvFrom(0, buffer, sizeof(buffer), &ip, &port) == 10);
+    CHECK(buffer[0] == 0x66 && port == 9);
+    CHECK(sara.socketRecvFrom(0, buffer, sizeof(buffer)) == -1);
+}
+
+// Takes at most 30 bytes per AT+NSORF.
+class SmallSink : public SaraN200RecvSink {
+public:
+    size_t bytes;
+
+    SmallSink() : bytes(0) {}
+
+    virtual size_t capacity() { return 30; }
+    virtual void write(const uint8_t* data, size_t size) { bytes += size; }
+};
+
+// A datagram read in several AT+NSORF chunks is accounted once, with its
+// full length and a single header overhead.
+static void testAccountsWholeDatagrams() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    // 32 bytes per AT+NSORF
+    SaraN200Accounting accounting;
+    SaraN200Static<SARA_N200_RECV_LINE_SIZE(32)> sara;
+    sara.init(&modem);
+    sara.setAccounting(&accounting);
+    CHECK(sara.createSocket(42000, false) == 0);
+
+    downlink.clear();
+    queue("10.0.0.1", 5683, 80, "44");
+    queue("10.0.0.1", 5683, 80, "55");
+
+    uint8_t buffer[80];
+    CHECK(sara.socketRecvFrom(0, buffer, sizeof(buffer)) == 80);
+    CHECK(modem.count("AT+NSORF") == 3);
+    CHECK(accounting.getTotal().datagramsReceived == 1);
+
+    SmallSink sink;
+    CHECK(sara.socketRecvStream(0, sink) == 80);
+    CHECK(sink.bytes == 80);
+
+    SaraN200Accounting expected;
+    expected.onReceive(0, 80);
+    expected.onReceive(0, 80);
+
+    CHECK(accounting.getTotal().datagramsReceived == 2);
+    CHECK(accounting.getTotal().bytesReceived == 160);
+    CHECK(accounting.getTotal().rxAirtime == expected.getTotal().rxAirtime);
+    CHECK(accounting.getSocket(0)->datagramsReceived == 2);
+}
+
+int main() {
+    testBatchTruncates();
+    testRecvFromWholeDatagrams();
+    testAccountsWholeDatagrams();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,80 @@
+#include <string>
+
+#include "SaraN200Peers.h"
+#include "SaraN200Udp.h"
+#include "ModemStub.h"
+#include "TestSupport.h"
+
+static std::string reply(const std::string& command) {
+    if (command.compare(0, 8, "AT+NSOCR") == 0) {
+        return "\r\n0\r\n\r\nOK\r\n";
+    }
+
+    if (command.compare(0, 8, "AT+NSORF") == 0) {
+        return "\r\n0,\"10.0.0.7\",4000,2,\"BEEF\",0\r\n\r\nOK\r\n";
+    }
+
+    return "\r\nOK\r\n";
+}
+
+// A listening socket is only read after +NSONMI, which parsePacket() picks
+// up by itself.
+static void testListening() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+
+    SaraUDP udp(sara);
+    CHECK(udp.begin(5683) == 1);
+
+    CHECK(udp.parsePacket() == 0);
+    CHECK(modem.count("AT+NSORF") == 0);
+
+    modem.push("\r\n+NSONMI: 0,2\r\n");
+    CHECK(udp.parsePacket() == 2);
+    CHECK(udp.read() == 0xBE);
+    CHECK(udp.read() == 0xEF);
+    CHECK(udp.remoteIP() == IPAddress(10, 0, 0, 7));
+    CHECK(udp.remotePort() == 4000);
+    CHECK(modem.count("AT+NSORF") == 1);
+
+    CHECK(udp.parsePacket() == 0);
+    CHECK(modem.count("AT+NSORF") == 1);
+}
+
+// Same through a peer queue: nothing pending, no AT+NSORF.
+static void testPeerQueue() {
+    ModemStub modem;
+    modem.reply = reply;
+
+    SaraN200Static<> sara;
+    sara.init(&modem);
+
+    SaraN200PeerQueue peers(sara);
+    SaraUDP udp(sara);
+    udp.setPeerQueue(&peers);
+    CHECK(udp.begin(5683) == 1);
+
+    CHECK(udp.parsePacket() == 0);
+    CHECK(udp.parsePacket() == 0);
+    CHECK(modem.count("AT+NSORF") == 0);
+
+    modem.push("\r\n+NSONMI: 0,2\r\n");
+    CHECK(udp.parsePacket() == 2);
+    CHECK(udp.remotePort() == 4000);
+    CHECK(peers.getStats().received == 1);
+
+    size_t reads = modem.count("AT+NSORF");
+    udp.flush();
+    CHECK(udp.parsePacket() == 0);
+    CHECK(modem.count("AT+NSORF") == reads);
+}
+
+int main() {
+    testListening();
+    testPeerQueue();
+
+    return TEST_RESULT();
+}
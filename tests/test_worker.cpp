@@ -0,0 +1,185 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "SaraN200Worker.h"
+#include "TestSupport.h"
+
+#define PRODUCERS 4
+#define CALLS_PER_PRODUCER 2000
+
+typedef struct Call {
+    std::atomic<int> runs;
+} Call;
+
+static std::atomic<bool> gateOpen(false);
+static std::atomic<bool> gateEntered(false);
+static std::atomic<unsigned> postsRun(0);
+
+static void idle(SaraN200& modem, void* context) {
+}
+
+static void gate(SaraN200& modem, void* context) {
+    gateEntered = true;
+    while (!gateOpen) {
+        std::this_thread::yield();
+    }
+}
+
+static void count(SaraN200& modem, void* context) {
+    static_cast<Call*>(context)->runs++;
+}
+
+static void countPost(SaraN200& modem, void* context) {
+    postsRun++;
+}
+
+// With the I/O task busy the queue takes exactly its depth minus the running
+// request, then rejects. A submit that timed out holds its slot until the I/O
+// task dequeues it, but never runs.
+static void testBounded() {
+    SaraN200 modem;
+    SaraN200Worker worker(modem);
+    worker.setIdleHandler(idle, NULL);
+    CHECK(worker.begin());
+
+    gateOpen = false;
+    gateEntered = false;
+    postsRun = 0;
+    CHECK(worker.post(gate, NULL));
+    while (!gateEntered) {
+        std::this_thread::yield();
+    }
+
+    Call call;
+    call.runs = 0;
+    CHECK(!worker.submit(count, &call, 10));
+
+    unsigned accepted = 0;
+    while (worker.post(countPost, NULL)) {
+        accepted++;
+    }
+
+    CHECK(accepted == SARA_N200_WORKER_QUEUE_DEPTH - 2);
+    CHECK(worker.getQueueDepth() == SARA_N200_WORKER_QUEUE_DEPTH - 1);
+    CHECK(worker.getRejectedCount() == 1);
+
+    gateOpen = true;
+    while (worker.getQueueDepth() > 0 || postsRun < accepted) {
+        std::this_thread::yield();
+    }
+
+    worker.end();
+
+    CHECK(postsRun == accepted);
+    CHECK(call.runs == 0);
+    CHECK(!worker.post(countPost, NULL));
+    CHECK(worker.getQueueDepth() == 0);
+}
+
+static void submitWaiting(SaraN200Worker* worker, Call* call, bool* result) {
+    *result = worker->submit(count, call, SARA_N200_WAIT_FOREVER);
+}
+
+static void endWorker(SaraN200Worker* worker) {
+    worker->end();
+}
+
+// end() lets the running request finish and fails the queued ones.
+static void testEndDrops() {
+    SaraN200 modem;
+    SaraN200Worker worker(modem);
+    worker.setIdleHandler(idle, NULL);
+    CHECK(worker.begin());
+
+    gateOpen = false;
+    gateEntered = false;
+    postsRun = 0;
+    CHECK(worker.post(gate, NULL));
+    while (!gateEntered) {
+        std::this_thread::yield();
+    }
+
+    Call call;
+    call.runs = 0;
+    bool result = true;
+    std::thread waiter(submitWaiting, &worker, &call, &result);
+    while (worker.getQueueDepth() == 0) {
+        std::this_thread::yield();
+    }
+
+    CHECK(worker.post(countPost, NULL));
+
+    std::thread ender(endWorker, &worker);
+    delay(50);
+    gateOpen = true;
+    ender.join();
+    waiter.join();
+
+    CHECK(!result);
+    CHECK(call.runs == 0);
+    CHECK(postsRun == 0);
+    CHECK(worker.getQueueDepth() == 0);
+}
+
+static void produce(SaraN200Worker* worker, unsigned seed, std::atomic<unsigned>* mismatches,
+        std::atomic<unsigned>* succeeded, std::atomic<unsigned>* ran) {
+    for (unsigned i = 0; i < CALLS_PER_PRODUCER; i++) {
+        Call call;
+        call.runs = 0;
+
+        // a mix of waiting forever, short timeouts and no wait at all
+        seed = seed * 1103515245 + 12345;
+        uint32_t timeout = (seed >> 16) % 3 == 0 ? SARA_N200_WAIT_FOREVER : (seed >> 16) % 2;
+        bool result = worker->submit(count, &call, timeout);
+
+        // true exactly when the operation ran, and then only once
+        if (call.runs > 1 || result != (call.runs == 1)) {
+            (*mismatches)++;
+        }
+
+        if (result) {
+            (*succeeded)++;
+        }
+
+        *ran += call.runs;
+    }
+}
+
+// Producers race each other and end(): every submit() must report whether
+// its operation ran, including those end() drops from the queue.
+static void testStress() {
+    SaraN200 modem;
+    SaraN200Worker worker(modem);
+    worker.setIdleHandler(idle, NULL);
+    CHECK(worker.begin());
+
+    std::atomic<unsigned> mismatches(0);
+    std::atomic<unsigned> succeeded(0);
+    std::atomic<unsigned> ran(0);
+
+    std::vector<std::thread> producers;
+    for (unsigned i = 0; i < PRODUCERS; i++) {
+        producers.push_back(std::thread(produce, &worker, i + 1, &mismatches, &succeeded, &ran));
+    }
+
+    delay(20);
+    worker.end();
+
+    for (size_t i = 0; i < producers.size(); i++) {
+        producers[i].join();
+    }
+
+    CHECK(mismatches == 0);
+    CHECK(succeeded == ran);
+    CHECK(succeeded > 0);
+    CHECK(worker.getQueueDepth() == 0);
+}
+
+int main() {
+    testBounded();
+    testEndDrops();
+    testStress();
+
+    return TEST_RESULT();
+}